@@ -0,0 +1,79 @@
+#ifndef GB_EMU_APU_H
+#define GB_EMU_APU_H
+
+#include <resampler.h>
+
+#define WAVE_RAM 0xFF30
+#define APU_LAST_REGISTER 0xFF3F
+#define APU_NATIVE_RATE 1048576     //one mixed sample per M-cycle
+#define APU_OUTPUT_RATE 48000       //default, apu_start_sound() takes any rate from APU_MIN_OUTPUT_RATE to APU_MAX_OUTPUT_RATE
+#define APU_MIN_OUTPUT_RATE 8000
+#define APU_MAX_OUTPUT_RATE 130419      //a block still resamples to at most APU_BLOCK_SIZE / 8 frames when raised by APU_MAX_RATE_ADJUST
+#define APU_MAX_RATE_ADJUST 0.005       //furthest apu_set_rate_ratio() moves the ratio from 1
+#define APU_BLOCK_SIZE 4096         //native samples mixed before they are resampled
+#define APU_MAX_SAMPLES 8192        //output frames kept until the frontend takes them, ~170 ms
+#define APU_FRAME_SEQUENCER_PERIOD 2048 //M-cycles per 512 Hz step
+
+enum APU_CHANNELS {
+    APU_SQUARE1,
+    APU_SQUARE2,
+    APU_WAVE,
+    APU_NOISE,
+    APU_NUM_CHANNELS
+};
+
+typedef struct APU_CHANNEL {
+    bool ENABLED;
+    bool DAC_ENABLED;
+    bool LENGTH_ENABLED;
+    uint16_t LENGTH;            //steps left before the channel turns off
+    uint8_t VOLUME;
+    uint8_t ENVELOPE_TIMER;
+    uint32_t TIMER;             //T-cycles until the next waveform step
+    uint8_t POSITION;           //duty step or wave RAM sample
+    uint16_t LFSR;              //noise only
+} APU_CHANNEL;
+
+/*
+ * The APU does not tick with the CPU. Register accesses and the end of every frame
+ * call apu_catch_up(), which runs everything since LAST_CYCLE in one go: waveforms
+ * only change on timer reloads, so the mixer emits runs of identical native samples
+ * and the frame sequencer is only stepped where its 512 Hz edges fall.
+ */
+typedef struct APU_STRUCT {
+    APU_CHANNEL CHANNELS[APU_NUM_CHANNELS];
+    bool POWERED;
+    bool SYNTHESIZE;            //set by apu_start_sound(), without it only lengths, sweep and envelopes run
+    uint64_t LAST_CYCLE;        //M-cycle the APU has been run up to
+    uint16_t FRAME_SEQUENCER_TIMER; //M-cycles until the next frame sequencer step
+    uint8_t FRAME_SEQUENCER_STEP;
+    //SWEEP
+    bool SWEEP_ENABLED;
+    uint8_t SWEEP_TIMER;
+    uint16_t SHADOW_FREQUENCY;
+    //NATIVE BLOCK, this and everything below is output, save states copy the fields above
+    float NATIVE[APU_BLOCK_SIZE][2];
+    uint32_t NATIVE_SIZE;
+    //RESAMPLING DOWN TO OUTPUT_RATE, set up by apu_start_sound()
+    RESAMPLER RESAMPLER;
+    uint32_t OUTPUT_RATE;
+    float HIGH_PASS_FACTOR;
+    float HIGH_PASS[2];
+    //OUTPUT
+    int16_t SAMPLES[APU_MAX_SAMPLES][2];
+    uint32_t NUM_SAMPLES;       //frames ready, the frontend resets this once it has taken them
+    uint64_t SAMPLES_DROPPED;
+} APU_STRUCT;
+
+APU_STRUCT* APU;
+
+void apu_init();
+void apu_free();
+void apu_catch_up();
+void apu_end_frame();
+uint8_t apu_read(uint16_t address);
+void apu_write(uint16_t address, uint8_t value);
+void apu_start_sound(uint32_t rate, enum RESAMPLE_QUALITY quality);
+void apu_set_rate_ratio(double ratio);
+
+#endif //GB_EMU_APU_H
@@ -0,0 +1,56 @@
+#ifndef GB_EMU_AUDIO_H
+#define GB_EMU_AUDIO_H
+
+#include <stdatomic.h>
+
+#define AUDIO_RING_SIZE 16384       //sample frames, a power of two, ~340 ms
+#define AUDIO_TARGET_MS 50          //queue fill the rate control steers to
+
+/*
+ * SYNC_TIMER paces frames with the pacer. SYNC_AUDIO waits for the audio queue
+ * to drain down to its target instead, so emulation runs on the sound card clock.
+ */
+enum AUDIO_SYNC {
+    SYNC_TIMER,
+    SYNC_AUDIO
+};
+
+/*
+ * Single producer, single consumer ring of stereo frames at RATE. The emulation
+ * thread pushes every frame's samples and the SDL audio callback pulls them, HEAD
+ * and TAIL are only ever written by one side each. With SYNC_TIMER the APU's
+ * resampling ratio follows the fill level within APU_MAX_RATE_ADJUST so the queue
+ * neither drains nor grows when the two clocks drift apart. SYNC_AUDIO needs no
+ * steering as emulation itself waits for the sound card.
+ */
+typedef struct AUDIO_STRUCT {
+    int16_t RING[AUDIO_RING_SIZE][2];
+    _Atomic uint64_t HEAD;          //frames pushed, written by the emulation thread
+    _Atomic uint64_t TAIL;          //frames played, written by the audio callback
+    atomic_bool PRIMED;             //the ring reached its target once, playback has started
+    SDL_AudioStream* STREAM;
+    enum AUDIO_SYNC SYNC;
+    uint32_t RATE;                  //frames per second the device plays
+    uint32_t TARGET_FRAMES;
+    double RATIO;
+    double FILL_AVERAGE;            //smoothed over frames so the ratio does not follow callback bursts
+    //STATS
+    _Atomic uint64_t UNDERRUNS;     //callbacks that found the ring short and played silence
+    _Atomic uint64_t SILENT_FRAMES;
+    uint64_t OVERRUNS;              //pushes that found the ring full
+    uint64_t DROPPED_FRAMES;
+    double LATENCY_SUM_MS;          //ring plus device queue, sampled at every push
+    uint64_t LATENCY_SAMPLES;
+    double RATIO_MIN;
+    double RATIO_MAX;
+} AUDIO_STRUCT;
+
+AUDIO_STRUCT* AUDIO;
+
+bool audio_init(enum AUDIO_SYNC sync, uint32_t rate);
+void audio_free();
+void audio_push();
+void audio_wait();
+void audio_print_stats();
+
+#endif //GB_EMU_AUDIO_H
@@ -0,0 +1,58 @@
+#ifndef GB_EMU_CAPTURE_H
+#define GB_EMU_CAPTURE_H
+
+#include <stdatomic.h>
+
+#define CAPTURE_RING_SIZE 64 //~1 second of frames
+
+/*
+ * Y4M writes 4:4:4 YUV video at the exact Game Boy frame rate. RAW writes every
+ * frame as its 160x144 indexed pixels followed by the 144x3 latched palettes.
+ */
+enum CAPTURE_FORMAT {
+    CAPTURE_Y4M,
+    CAPTURE_RAW
+};
+
+/*
+ * What the emulation thread does when the ring is full, DROP loses the frame
+ * and BLOCK waits for the writer thread
+ */
+enum CAPTURE_BACKPRESSURE {
+    CAPTURE_DROP,
+    CAPTURE_BLOCK
+};
+
+/*
+ * Single producer, single consumer ring of finished frames. The emulation thread
+ * copies each frame in and the writer thread encodes and writes it out, FREE_SLOTS
+ * and QUEUED_FRAMES count the empty and full slots.
+ */
+typedef struct CAPTURE_STRUCT {
+    INDEXED_FRAME RING[CAPTURE_RING_SIZE];
+    _Atomic uint64_t HEAD;  //frames pushed, written by the emulation thread
+    uint64_t TAIL;          //frames consumed, only used by the writer thread
+    SDL_Semaphore* FREE_SLOTS;
+    SDL_Semaphore* QUEUED_FRAMES;
+    SDL_Thread* WRITER;
+    FILE* OUTPUT;
+    enum CAPTURE_FORMAT FORMAT;
+    enum CAPTURE_BACKPRESSURE BACKPRESSURE;
+    atomic_bool WRITE_FAILED;
+    //STATS
+    _Atomic uint64_t FRAMES_CAPTURED;
+    _Atomic uint64_t FRAMES_WRITTEN;
+    _Atomic uint64_t FRAMES_DROPPED;
+    _Atomic uint64_t BLOCKS;        //times the emulation thread waited on a full ring
+    _Atomic uint64_t BLOCKED_NS;
+} CAPTURE_STRUCT;
+
+CAPTURE_STRUCT* CAPTURE;
+
+void capture_init(const char* path, enum CAPTURE_FORMAT format, enum CAPTURE_BACKPRESSURE backpressure);
+void capture_finish();
+void capture_free();
+void capture_push(const INDEXED_FRAME* frame);
+void capture_print_stats();
+
+#endif //GB_EMU_CAPTURE_H
@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 
 #define WINDOW_WIDTH 160
 #define WINDOW_HEIGHT 144
@@ -93,11 +94,13 @@ typedef struct PIXEL_DATA {
     bool x_flip;
 } PIXEL_DATA;
 
+#define PIXEL_FIFO_CAPACITY 8
+
 typedef struct PIXEL_FIFO {
     int8_t front;
     int8_t back;
     uint8_t size;
-    PIXEL_DATA** pixel_data;
+    PIXEL_DATA pixel_data[PIXEL_FIFO_CAPACITY];
 } PIXEL_FIFO;
 
 typedef struct OAM_STRUCT {
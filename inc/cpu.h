@@ -48,8 +48,12 @@ typedef struct CPU_STRUCT {
     uint8_t IME;
     uint8_t DATA_BUS;
     uint16_t ADDRESS_BUS;
+    uint16_t INSTRUCTION_PC;    //address of the opcode being executed
     uint8_t DMA_CYCLE;
     enum CPU_STATES STATE;
+    //joypad lines P1 reads, active low, changed through input_set_joypad()
+    uint8_t BUTTONS;
+    uint8_t D_PAD;
 } CPU_STRUCT;
 
 CPU_STRUCT* CPU;
@@ -0,0 +1,75 @@
+#ifndef GB_EMU_FRAMEBUFFER_H
+#define GB_EMU_FRAMEBUFFER_H
+
+#define FRAMEBUFFER_PITCH (WINDOW_WIDTH * sizeof(uint32_t))
+#define DIRTY_LINE_WORDS ((WINDOW_HEIGHT + 63) / 64)
+
+/*
+ * Palette a pixel was drawn with, stored in bits 2-3 of a framebuffer pixel
+ */
+enum PALETTE_ID {
+    PALETTE_BGP,
+    PALETTE_OBP0,
+    PALETTE_OBP1,
+    PALETTE_OFF
+};
+
+enum FRAME_STATUS {
+    FRAME_RENDERED,
+    FRAME_SKIPPED
+};
+
+/*
+ * OFF renders every frame, FIXED renders one frame out of every SKIP_INTERVAL + 1,
+ * AUTO skips frames while the host is behind its frame-time budget, ALL never renders
+ */
+enum FRAME_SKIP_MODE {
+    FRAME_SKIP_OFF,
+    FRAME_SKIP_FIXED,
+    FRAME_SKIP_AUTO,
+    FRAME_SKIP_ALL
+};
+
+/*
+ * Native resolution frame. Each pixel is one byte holding its shade (0 white
+ * to 3 black) in bits 0-1 and its PALETTE_ID in bits 2-3. The shade is looked
+ * up in the palette register when the pixel is pushed, so palette writes in
+ * the middle of a line show up at the right pixel.
+ * DIRTY_LINES marks the lines that changed since the previous rendered frame.
+ */
+typedef struct INDEXED_FRAME {
+    uint8_t PIXELS[WINDOW_HEIGHT][WINDOW_WIDTH];
+    uint64_t DIRTY_LINES[DIRTY_LINE_WORDS];
+    uint8_t NUM_DIRTY_LINES;
+    uint64_t FRAME_NUMBER;
+} INDEXED_FRAME;
+
+/*
+ * Lines are drawn into LINE and only copied into FRAME when they differ from
+ * the last rendered frame. The damage is reset when the next frame starts.
+ */
+typedef struct FRAMEBUFFER_STRUCT {
+    INDEXED_FRAME FRAME;
+    uint8_t LINE[WINDOW_WIDTH];
+    enum FRAME_STATUS STATUS;   //status of the frame currently being drawn
+    //FRAME SKIP DATA
+    enum FRAME_SKIP_MODE SKIP_MODE;
+    uint8_t SKIP_INTERVAL;
+    uint8_t SKIPPED_IN_ROW;
+    double LAG_MS;
+} FRAMEBUFFER_STRUCT;
+
+FRAMEBUFFER_STRUCT* FRAMEBUFFER;
+
+void framebuffer_init();
+void framebuffer_commit_line();
+bool framebuffer_frame_dirty();
+bool frame_line_dirty(const INDEXED_FRAME* frame, uint8_t line);
+void frame_mark_all_dirty(INDEXED_FRAME* frame);
+void frame_merge_damage(INDEXED_FRAME* frame, const INDEXED_FRAME* older);
+void frame_to_rgba(const INDEXED_FRAME* frame, uint32_t (*rgba)[WINDOW_WIDTH]);
+uint64_t frame_hash(const INDEXED_FRAME* frame);
+void framebuffer_set_frame_skip(enum FRAME_SKIP_MODE mode, uint8_t interval);
+enum FRAME_STATUS framebuffer_next_frame(double work_ms, double budget_ms);
+
+#endif //GB_EMU_FRAMEBUFFER_H
@@ -1,8 +1,47 @@
 #ifndef GB_EMU_GB_H
 #define GB_EMU_GB_H
 
+#define CLOCK_FREQ 4194304.0
+#define CYCLES_PER_FRAME 70224
+#define FRAME_TIME_MS    (1000.0 * CYCLES_PER_FRAME / CLOCK_FREQ) // ~16.74 ms
+
 unsigned long long CYCLE_COUNT;
 
+/*
+ * Everything the emulator core keeps in globals. Saving it and loading
+ * another lets several Game Boys share one process, one at a time.
+ * Frontend state and the debugging recorders stay process-wide.
+ */
+typedef struct GB_INSTANCE {
+    struct GB_MACHINE* MACHINE;
+    struct CPU_STRUCT* CPU;
+    struct PPU_STRUCT* PPU;
+    uint8_t* MEMORY;
+    struct CARTRIDGE_STRUCT* CARTRIDGE;
+    struct SERIAL_STRUCT* SERIAL;
+    struct APU_STRUCT* APU;
+    struct func_queue* INSTR_QUEUE;
+    struct object_min_heap* OBJ_HEAP;
+    struct FRAMEBUFFER_STRUCT* FRAMEBUFFER;
+    struct MOVIE_STRUCT* MOVIE;
+    struct PROFILER_STRUCT* PROFILER;  //GB_PROFILE builds only
+    unsigned long long CYCLE_COUNT;
+    uint16_t TIMER_COUNTER;
+    uint16_t DIV_COUNTER;
+    uint16_t TIMER_PERIOD;
+    uint8_t PPU_CYCLES;
+    bool REFRESH;
+} GB_INSTANCE;
+
+void gb_init(const char* file_name);
+void gb_init_rom(const uint8_t* rom, uint32_t size);
+void memory_init(const uint8_t* rom, uint32_t size);
+void run_frame();
+bool gb_run_until(unsigned long long limit);
+void gb_end_slice();
+void gb_reschedule();
+void gb_save_instance(GB_INSTANCE* instance);
+void gb_load_instance(const GB_INSTANCE* instance);
 void free_resources();
 void OAM_DMA();
 void set_refresh();
@@ -0,0 +1,55 @@
+#ifndef GB_EMU_HEATMAP_H
+#define GB_EMU_HEATMAP_H
+
+#define HEATMAP_NUM_PAGES 256       //256-byte pages
+#define HEATMAP_MAX_ROM_BANKS 512
+#define HEATMAP_MAX_RAM_BANKS 16
+#define HEATMAP_TOP_PAGES 16        //pages listed in the summary
+
+enum HEATMAP_SOURCE {
+    HEAT_CPU,
+    HEAT_DMA,                       //OAM DMA
+    HEAT_PPU,                       //OAM search and fetcher reads of VRAM and OAM
+    HEATMAP_NUM_SOURCES
+};
+
+enum HEATMAP_ACCESS {
+    HEAT_READ,
+    HEAT_WRITE,
+    HEATMAP_NUM_ACCESSES
+};
+
+/*
+ * Access counts for the frame in progress, added to the totals and written out
+ * at the end of every frame. ROM banks count reads of 0x0000-0x7FFF, RAM banks
+ * count reads and writes of 0xA000-0xBFFF.
+ */
+typedef struct HEATMAP_STRUCT {
+    uint32_t PAGES[HEATMAP_NUM_SOURCES][HEATMAP_NUM_ACCESSES][HEATMAP_NUM_PAGES];
+    uint32_t ROM_BANKS[HEATMAP_NUM_SOURCES][HEATMAP_MAX_ROM_BANKS];
+    uint32_t RAM_BANKS[HEATMAP_NUM_SOURCES][HEATMAP_MAX_RAM_BANKS];
+    uint64_t TOTAL_PAGES[HEATMAP_NUM_SOURCES][HEATMAP_NUM_ACCESSES][HEATMAP_NUM_PAGES];
+    uint64_t TOTAL_ROM_BANKS[HEATMAP_NUM_SOURCES][HEATMAP_MAX_ROM_BANKS];
+    uint64_t TOTAL_RAM_BANKS[HEATMAP_NUM_SOURCES][HEATMAP_MAX_RAM_BANKS];
+    uint64_t FRAMES;
+    FILE* OUTPUT;                   //per-frame heatmap, nullptr to only keep totals
+} HEATMAP_STRUCT;
+
+HEATMAP_STRUCT* HEATMAP;
+
+void heatmap_init(const char* path);
+void heatmap_free();
+void heatmap_access(enum HEATMAP_SOURCE source, enum HEATMAP_ACCESS access, uint16_t address);
+void heatmap_frame();
+void heatmap_print_summary();
+
+//the hooks only count once gb_emu --heatmap has created HEATMAP
+#ifdef GB_HEATMAP
+#define HEATMAP_ACCESS(source, access, address) do { if (HEATMAP) heatmap_access(source, access, address); } while (0)
+#define HEATMAP_FRAME() do { if (HEATMAP) heatmap_frame(); } while (0)
+#else
+#define HEATMAP_ACCESS(source, access, address) ((void) 0)
+#define HEATMAP_FRAME() ((void) 0)
+#endif
+
+#endif //GB_EMU_HEATMAP_H
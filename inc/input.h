@@ -0,0 +1,58 @@
+#ifndef GB_EMU_INPUT_H
+#define GB_EMU_INPUT_H
+
+#include <stdatomic.h>
+
+#define INPUT_QUEUE_SIZE 256        //events, a power of two
+
+typedef struct INPUT_EVENT {
+    uint64_t HOST_NS;               //SDL event timestamp, same clock as SDL_GetTicksNS()
+    uint8_t BUTTONS;                //joypad state after the event, active low like P1
+    uint8_t D_PAD;
+} INPUT_EVENT;
+
+/*
+ * Single producer, single consumer queue of timestamped joypad changes. The
+ * render thread, which owns SDL events, pushes them as they arrive. Frame N
+ * replays the host time between the starts of frames N - 1 and N: every event
+ * in that span is given the M-cycle at the same fraction of the frame, and the
+ * emulation thread applies it once CYCLE_COUNT reaches that cycle, when the
+ * game reads P1 or at the end of the frame at the latest. Presses keep the
+ * spacing they had on the host instead of all landing on a frame boundary.
+ */
+typedef struct INPUT_STRUCT {
+    INPUT_EVENT QUEUE[INPUT_QUEUE_SIZE];
+    _Atomic uint64_t HEAD;          //events pushed, written by the render thread
+    _Atomic uint64_t TAIL;          //events applied, written by the emulation thread
+    //RENDER THREAD
+    uint8_t BUTTONS;                //state as of the last pushed event
+    uint8_t D_PAD;
+    _Atomic uint64_t DROPPED;       //events that found the queue full
+    //EMULATION THREAD
+    uint64_t WINDOW_START_NS;       //host span the current frame replays
+    uint64_t WINDOW_END_NS;
+    uint64_t FRAME_CYCLE;           //CYCLE_COUNT when the current frame started
+    uint64_t UNSEEN_NS;             //timestamp of the oldest applied event no P1 read has seen yet, 0 if none
+    uint8_t POLLED_BUTTONS;         //state as of the last event input_poll() took
+    uint8_t POLLED_D_PAD;
+    //STATS
+    uint64_t EVENTS;
+    uint64_t LATE;                  //events older than the window, applied at the start of the frame
+    uint64_t OBSERVED;              //applied changes a P1 read returned
+    uint64_t LATENCY_SUM_NS;        //event timestamp to that P1 read
+    uint64_t LATENCY_MAX_NS;
+} INPUT_STRUCT;
+
+INPUT_STRUCT* INPUT;
+
+void input_init();
+void input_free();
+void input_push(uint64_t host_ns, bool d_pad, uint8_t bit, bool pressed);
+void input_set_joypad(uint8_t buttons, uint8_t d_pad);
+void input_begin_frame();
+void input_catch_up();
+void input_end_frame();
+void input_poll(uint8_t* buttons, uint8_t* d_pad);
+void input_print_stats();
+
+#endif //GB_EMU_INPUT_H
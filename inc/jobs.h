@@ -0,0 +1,28 @@
+#ifndef GB_EMU_JOBS_H
+#define GB_EMU_JOBS_H
+
+#include <SDL3/SDL.h>
+
+#define JOB_MAX_ARGS 32
+
+/*
+ * One emulator run started by a test tool. Every emulator instance keeps its
+ * state in globals, so runs are parallelized across processes.
+ */
+typedef struct JOB {
+    char* NAME;
+    char* ARGS[JOB_MAX_ARGS + 1];   //nullptr terminated
+    uint8_t NUM_ARGS;
+    SDL_Process* PROCESS;
+    uint64_t START_NS;
+    int EXIT_CODE;
+    double WALL_MS;
+} JOB;
+
+void job_init(JOB* job, const char* name);
+void job_free(JOB* job);
+void job_add_arg(JOB* job, const char* fmt, ...);
+void jobs_run(JOB* jobs, uint32_t num_jobs, uint32_t max_parallel);
+char* jobs_emulator_path();
+
+#endif //GB_EMU_JOBS_H
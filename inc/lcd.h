@@ -3,24 +3,26 @@
 
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_main.h>
+#include <stdatomic.h>
 
 typedef struct GameBoy_Display {
     SDL_Window* window;
     SDL_Renderer* renderer;
-    SDL_Surface* surface;
     SDL_Texture* texture;
+    uint32_t (*rgba)[WINDOW_WIDTH];
     SDL_Event event;
-    bool is_running;
-    uint8_t buttons;
-    uint8_t d_pad;
+    atomic_bool is_running;
+    bool redraw;    //present even if the frame has no damage
 } GameBoy_Display;
 
 struct GameBoy_Display* LCD;
+struct INDEXED_FRAME;
 
-void lcd_init();
+void lcd_init(bool headless);
 void lcd_free();
+bool lcd_display_sync(uint64_t* period_num, uint64_t* period_den);
 void process_events();
-void lcd_update_screen();
+void lcd_update_screen(const struct INDEXED_FRAME* frame);
+void lcd_render_loop();
 void lcd_update_pixel(const PIXEL_DATA* pixel_data);
-void lcd_update_screen();
 #endif //GB_EMU_SCREEN_H
@@ -0,0 +1,39 @@
+#ifndef GB_EMU_LINK_H
+#define GB_EMU_LINK_H
+
+#include <gb.h>
+
+#define LINK_PLAYERS 2
+
+/*
+ * Link cable between two Game Boys in one process. Both run on the calling
+ * thread, the link swaps their GB_INSTANCE in and out and always resumes the
+ * one whose CYCLE_COUNT is behind. While neither serial port is busy each
+ * runs a whole frame at a time. The instances only meet around transfers:
+ *  - a write to SC ends the writer's slice, so the other one is caught up to
+ *    it before anything depends on the new port state
+ *  - a transfer on the internal clock ends at a meeting point both instances
+ *    stop at, the bytes are swapped there and the peer only takes part if it
+ *    was waiting on the external clock at that cycle
+ *  - a port waiting on SC bit 7 stays within SERIAL_TRANSFER_CYCLES of its
+ *    peer, so no transfer the peer starts later can end in its past
+ * Transfers therefore complete at the exact cycles two real units would see.
+ */
+typedef struct LINK_STRUCT {
+    GB_INSTANCE PLAYERS[LINK_PLAYERS];
+    uint8_t CURRENT;                        //instance loaded into the globals
+    uint32_t PENDING_FRAMES[LINK_PLAYERS];  //finished but not yet returned by link_run_frame()
+    //STATS
+    uint64_t SLICES;                        //times an instance was resumed
+    uint64_t MEETINGS;                      //transfers ended with both instances at the same cycle
+    uint64_t EXCHANGES;                     //of those, bytes that went both ways
+} LINK_STRUCT;
+
+LINK_STRUCT* LINK;
+
+void link_init(const char* rom_a, const char* rom_b);
+void link_free();
+void link_select(uint8_t player);
+void link_run_frame();
+
+#endif //GB_EMU_LINK_H
@@ -0,0 +1,46 @@
+#ifndef GB_EMU_MACHINE_H
+#define GB_EMU_MACHINE_H
+
+#include <stdalign.h>
+#include <cpu.h>
+#include <ppu.h>
+#include <queue.h>
+#include <min_heap.h>
+#include <memory.h>
+#include <framebuffer.h>
+#include <serial.h>
+#include <apu.h>
+
+#define CACHE_LINE_SIZE 64
+
+/*
+ * The state of one emulated Game Boy in a single cache line aligned block,
+ * instead of a malloc per struct scattered over the heap. What the CPU and PPU
+ * touch every dot or memory access comes first so it shares as few lines and
+ * pages as possible, then the address space, then what is written once per
+ * sample or line, and last what is only looked at on a serial transfer. The
+ * globals of the core point into it, ROM, cartridge RAM, serial output and
+ * the resampler's buffers stay separate allocations as their size depends on
+ * the cartridge or the host.
+ */
+typedef struct GB_MACHINE {
+    //HOT, every dot or M-cycle
+    alignas(CACHE_LINE_SIZE) CPU_STRUCT CPU;
+    alignas(CACHE_LINE_SIZE) func_queue INSTR_QUEUE;
+    alignas(CACHE_LINE_SIZE) PPU_STRUCT PPU;
+    alignas(CACHE_LINE_SIZE) object_min_heap OBJ_HEAP;
+    alignas(CACHE_LINE_SIZE) CARTRIDGE_STRUCT CARTRIDGE;   //bus handlers and bank registers
+    alignas(CACHE_LINE_SIZE) uint8_t MEMORY[0x10000];
+    //WARM, every line or audio sample
+    alignas(CACHE_LINE_SIZE) FRAMEBUFFER_STRUCT FRAMEBUFFER;
+    alignas(CACHE_LINE_SIZE) APU_STRUCT APU;
+    //COLD, serial transfers
+    alignas(CACHE_LINE_SIZE) SERIAL_STRUCT SERIAL;
+} GB_MACHINE;
+
+GB_MACHINE* MACHINE;
+
+void machine_init();
+void machine_free();
+
+#endif //GB_EMU_MACHINE_H
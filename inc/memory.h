@@ -1,27 +1,67 @@
 #ifndef GB_EMU_MEMORY_H
 #define GB_EMU_MEMORY_H
 
+#define ROM_BANK_SIZE 0x4000 //16KiB
+#define RAM_BANK_SIZE 0x2000 //8KiB
+#define MBC2_RAM_SIZE 0x200  //512 half bytes built into the mapper
+#define RTC_NUM_REGISTERS 5
+
 enum CARTRIDGES {
     MBC0,
-    MBC1
+    MBC1,
+    MBC2,
+    MBC3,
+    MBC5
 };
 
+typedef void (*bus_handler)(uint8_t UNUSED);
+
+/*
+ * MBC3 real-time clock. It is not ticked: SECONDS is the time at emulated
+ * cycle CYCLE and the registers are worked out from the cycles since when the
+ * game latches or writes them, so the clock follows emulated time and stays
+ * deterministic for movies and netplay.
+ */
+typedef struct RTC_STRUCT {
+    uint64_t SECONDS;               //days included, below 512 days
+    unsigned long long CYCLE;       //M-cycle SECONDS was current at
+    bool HALT;
+    bool DAY_CARRY;
+    uint8_t LATCHED[RTC_NUM_REGISTERS];     //seconds, minutes, hours, day low, day high/halt/carry
+    uint8_t LATCH_WRITE;            //last byte written to 0x6000-0x7FFF, latching takes 0x00 then 0x01
+} RTC_STRUCT;
+
+/*
+ * ROM_MAP and RAM_MAP point at the banks currently visible to the CPU and
+ * only change when a bank register is written, so a read is one indexed load
+ * whatever the mapper
+ */
 typedef struct CARTRIDGE_STRUCT {
+    uint8_t* ROM_MAP[2];            //16 KiB windows at 0x0000 and 0x4000
+    uint8_t* RAM_MAP;               //window at 0xA000, nullptr while unmapped, which reads 0xFF
+    uint16_t RAM_MASK;              //offsets into RAM_MAP, below 8 KiB for MBC2, small RAM and RTC registers
+    bus_handler WRITE_MEMORY;       //write_memory() for this mapper, picked by cartridge_remap()
     enum CARTRIDGES CART_TYPE;
     uint8_t* ROM;
     uint8_t* RAM;
     uint32_t ROM_SIZE;
     uint32_t RAM_SIZE;
-    uint8_t CART_ROM_BANK;
+    uint16_t CART_ROM_BANK;         //ROM bank register, 9 bits on MBC5
     uint8_t RAM_UPPER_ROM;
-    uint8_t RAM_BANK;
+    uint8_t RAM_BANK;               //RAM bank register, also the RTC register select on MBC3
     bool BANK_MODE;
     bool RAM_ENABLE;
     uint16_t NUM_ROM_BANKS;
+    bool HAS_RTC;
+    RTC_STRUCT RTC;
 } CARTRIDGE_STRUCT;
 
 uint8_t* MEMORY;
 CARTRIDGE_STRUCT* CARTRIDGE;
 void read_memory(uint8_t UNUSED);
+void fetch_memory();
 void write_memory(uint8_t UNUSED);
+void cartridge_remap();
+uint16_t mapped_rom_bank(uint16_t address);
+uint8_t mapped_ram_bank();
 #endif //GB_EMU_MEMORY_H
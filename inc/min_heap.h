@@ -1,16 +1,17 @@
 #ifndef GB_EMU_MIN_HEAP_H
 #define GB_EMU_MIN_HEAP_H
 
+#define OBJ_HEAP_CAPACITY 10
+
 typedef struct object_min_heap {
     int8_t size;
     int8_t capacity;
-    struct OAM_STRUCT** objects;
+    OAM_STRUCT objects[OBJ_HEAP_CAPACITY];
 } object_min_heap;
 
 object_min_heap* OBJ_HEAP;
 
 void heap_init();
-void heap_free();
 void heap_insert(const OAM_STRUCT* object);
 OAM_STRUCT* heap_peek();
 void heap_delete_min();
@@ -0,0 +1,54 @@
+#ifndef GB_EMU_MOVIE_H
+#define GB_EMU_MOVIE_H
+
+#define MOVIE_MAGIC "GBMV"
+#define MOVIE_VERSION 1
+#define MOVIE_HEADER_SIZE 48
+
+enum MOVIE_MODE {
+    MOVIE_RECORD,
+    MOVIE_PLAY
+};
+
+enum MOVIE_START {
+    MOVIE_START_POWER_ON            //the state gb_init() leaves, the only one so far
+};
+
+/*
+ * Joypad changes keyed by the M-cycle they were applied at. The file starts with
+ * a little-endian header: magic, version, start state, ROM hash, start cycle,
+ * frames, changes and end cycle. The counts are filled in when recording stops.
+ * Each change follows as the LEB128 cycle delta from the one before, then one
+ * byte with the buttons in the high and the d-pad in the low nibble. The core
+ * is deterministic from power-on, so replaying the changes at the same cycles
+ * reproduces the run exactly.
+ */
+typedef struct MOVIE_STRUCT {
+    enum MOVIE_MODE MODE;
+    FILE* FILE;                     //recording only
+    uint64_t ROM_HASH;
+    uint64_t START_CYCLE;
+    uint64_t FRAMES;                //recorded so far, or in the file when playing
+    uint64_t CHANGES;
+    uint64_t LAST_CYCLE;            //of the previous change, deltas are relative to it
+    //PLAYBACK
+    uint8_t* DATA;                  //change stream of the file
+    size_t SIZE;
+    size_t OFFSET;
+    bool HAS_NEXT;
+    uint64_t NEXT_CYCLE;
+    uint8_t NEXT_JOYPAD;
+    uint64_t FRAMES_PLAYED;
+} MOVIE_STRUCT;
+
+MOVIE_STRUCT* MOVIE;
+
+void movie_init(const char* path, enum MOVIE_MODE mode);
+void movie_free();
+void movie_record(uint8_t buttons, uint8_t d_pad);
+void movie_catch_up();
+void movie_end_frame();
+bool movie_finished();
+uint64_t movie_rom_hash();
+
+#endif //GB_EMU_MOVIE_H
@@ -0,0 +1,105 @@
+#ifndef GB_EMU_NETPLAY_H
+#define GB_EMU_NETPLAY_H
+
+#include <netinet/in.h>
+#include <savestate.h>
+#include <link.h>
+
+#define NETPLAY_DEFAULT_PORT 7845
+#define NETPLAY_MAX_ROLLBACK 8      //frames a player may run ahead of the last input it has from the other
+#define NETPLAY_STATES (NETPLAY_MAX_ROLLBACK + 1)
+#define NETPLAY_HISTORY 64          //frames of inputs kept, a power of two above the rollback window
+#define NETPLAY_OUTBOX_SIZE 256     //packets held back by the artificial delay
+#define NETPLAY_MAX_PACKET 128
+
+/*
+ * Start of frame state of both linked instances, what a rollback restores
+ */
+typedef struct NETPLAY_FRAME_STATE {
+    SAVESTATE PLAYERS[LINK_PLAYERS];
+    uint32_t PENDING_FRAMES[LINK_PLAYERS];
+} NETPLAY_FRAME_STATE;
+
+typedef struct NETPLAY_PACKET {
+    uint64_t RELEASE_NS;            //when the artificial delay lets it go out
+    uint16_t SIZE;
+    uint8_t DATA[NETPLAY_MAX_PACKET];
+} NETPLAY_PACKET;
+
+/*
+ * Two player rollback netplay between two processes over UDP. Both processes
+ * run the same pair of linked instances, player 1 drives the first and player
+ * 2 the second. Every frame each side sends the inputs the other has not
+ * acknowledged yet, so a lost packet is covered by the next one. Frames run
+ * without waiting for the remote input: it is predicted to stay what it was
+ * last. Once it arrives and differs, the pair is restored to the start of the
+ * first mispredicted frame and the frames since are simulated again with the
+ * real input, only the result of the last one is shown. A player never gets
+ * more than NETPLAY_MAX_ROLLBACK frames past the remote input it has, it
+ * stalls instead, and the player running ahead of the other waits a frame
+ * now and then so neither keeps rolling back for both. A hash of the
+ * confirmed state goes along with the inputs to catch desyncs.
+ */
+typedef struct NETPLAY_STRUCT {
+    int SOCKET;
+    struct sockaddr_in PEER;
+    uint8_t LOCAL_PLAYER;
+    uint64_t SESSION;               //hash of both ROMs, packets of other sessions are ignored
+    uint64_t FRAME;                 //next frame to run
+    uint8_t LOCAL_INPUTS[NETPLAY_HISTORY];      //by frame, buttons in the high and the d-pad in the low nibble
+    uint8_t REMOTE_INPUTS[NETPLAY_HISTORY];     //received, or the prediction for frames past REMOTE_FRAMES
+    uint64_t REMOTE_FRAMES;         //remote inputs are known for all frames below
+    uint64_t REMOTE_FRAME;          //frame the peer was at when it sent its last packet
+    uint64_t ACKED_FRAMES;          //the peer has our inputs for all frames below
+    uint64_t ROLLBACK_FRAME;        //first frame that ran on a wrong prediction, UINT64_MAX if none
+    NETPLAY_FRAME_STATE STATES[NETPLAY_STATES];  //by frame, back to NETPLAY_MAX_ROLLBACK frames ago
+    uint64_t CHECK_FRAME;           //latest frame start we hashed with every input before it final
+    uint64_t CHECKSUMS[NETPLAY_HISTORY];
+    uint64_t CHECKSUM_FRAMES[NETPLAY_HISTORY];  //frame each checksum is of, confirmation can skip frames
+    uint64_t PEER_CHECK_FRAME;      //and the peer's, compared once we got that far too
+    uint64_t PEER_CHECKSUM;
+    uint64_t COMPARED_FRAME;        //latest frame compared
+    uint64_t LAST_SYNC_FRAME;       //frame of the last time sync wait, they are spaced out
+    //ECHO, round trip of our send time through the peer's next packet
+    uint64_t ECHO_NS;               //send time of the peer's last packet
+    uint64_t ECHO_RECEIVED_NS;      //and when it arrived
+    //ARTIFICIAL NETWORK CONDITIONS
+    uint64_t DELAY_NS;              //added to every packet we send
+    uint8_t LOSS_PERCENT;           //of packets we drop instead
+    uint32_t RANDOM;
+    NETPLAY_PACKET OUTBOX[NETPLAY_OUTBOX_SIZE];
+    uint32_t OUTBOX_HEAD;
+    uint32_t OUTBOX_SIZE;
+    //STATS
+    uint64_t PACKETS_SENT;
+    uint64_t PACKETS_RECEIVED;
+    uint64_t PACKETS_DROPPED;       //by the artificial loss or a full outbox
+    uint64_t RTT_SUM_NS;
+    uint64_t RTT_MAX_NS;
+    uint64_t RTT_SAMPLES;
+    uint64_t REMOTE_INPUTS_LATE;    //remote inputs that arrived after their frame ran
+    uint64_t REMOTE_LAG_SUM;        //frames they were late by
+    uint64_t STALLS;                //host frames spent waiting on the remote input
+    uint64_t SYNC_WAITS;            //host frames spent waiting for the peer to catch up
+    uint64_t ROLLBACKS;
+    uint64_t ROLLBACK_DEPTH_MAX;
+    uint64_t RESIM_FRAMES;          //frames simulated again
+    uint64_t RESIM_NS;              //restoring and simulating them again
+    uint64_t RESIM_MAX_NS;          //longest single rollback
+    uint64_t CHECKS;
+    uint64_t DESYNCS;
+} NETPLAY_STRUCT;
+
+NETPLAY_STRUCT* NETPLAY;
+
+void netplay_init(uint8_t local_player, uint16_t port, const char* peer);
+void netplay_free();
+void netplay_simulate(uint32_t delay_ms, uint8_t loss_percent);
+bool netplay_connect(uint32_t timeout_ms);
+bool netplay_run_frame(uint8_t buttons, uint8_t d_pad);
+void netplay_poll();
+bool netplay_finish(uint32_t timeout_ms);
+uint64_t netplay_state_hash();
+void netplay_print_stats();
+
+#endif //GB_EMU_NETPLAY_H
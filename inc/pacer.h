@@ -0,0 +1,33 @@
+#ifndef GB_EMU_PACER_H
+#define GB_EMU_PACER_H
+
+/*
+ * Frame pacing against an absolute timeline. Deadlines are kept as an exact
+ * rational number of nanoseconds so no rounding error builds up, and each wait
+ * sleeps until SPIN_THRESHOLD_NS before the deadline and spins for the rest.
+ */
+typedef struct PACER_STRUCT {
+    uint64_t PERIOD_NUM;        //frame period in ns is PERIOD_NUM / PERIOD_DEN
+    uint64_t PERIOD_DEN;
+    uint64_t DEADLINE_NS;
+    uint64_t DEADLINE_REMAINDER;
+    uint64_t SPIN_THRESHOLD_NS; //adapts to how much the host oversleeps
+    uint64_t OVERSLEEP_AVG_NS;
+    //STATS
+    uint64_t START_NS;
+    uint64_t FRAMES;
+    uint64_t LATE_FRAMES;       //work alone took longer than the deadline
+    uint64_t RESYNCS;           //fell too far behind and restarted the timeline
+    double JITTER_SUM_NS;
+    double JITTER_SQUARE_SUM_NS;
+    uint64_t JITTER_MAX_NS;
+} PACER_STRUCT;
+
+PACER_STRUCT* PACER;
+
+void pacer_init(uint64_t period_num, uint64_t period_den);
+void pacer_free();
+void pacer_wait_next_frame();
+void pacer_print_stats();
+
+#endif //GB_EMU_PACER_H
@@ -1,6 +1,8 @@
 #ifndef GB_EMU_PPU_H
 #define GB_EMU_PPU_H
 
+#define PIXELS_PER_TILE 8
+
 enum PPU_STATE {
     OAM_SEARCH,
     PIXEL_TRANSFER,
@@ -22,8 +24,8 @@ typedef struct PPU_STRUCT {
     uint16_t RENDER_LINE_CYCLE;
     uint8_t RENDER_X;   //incremented per pixel pushed
     bool FIRST_TILE_DONE;
-    PIXEL_FIFO* BACKGROUND_FIFO;
-    PIXEL_FIFO* SPRITE_FIFO;
+    PIXEL_FIFO BACKGROUND_FIFO;
+    PIXEL_FIFO SPRITE_FIFO;
     enum FETCH_SOURCE FETCH_TYPE;
     uint8_t NUM_SCROLL_PIXELS;
     uint8_t PENALTY;
@@ -35,17 +37,18 @@ typedef struct PPU_STRUCT {
     uint16_t TILE_ADDRESS;
     uint8_t DATA_LOW;
     uint8_t DATA_HIGH;
-    PIXEL_DATA* PIXEL_DATA; //8 pixels
+    PIXEL_DATA PIXEL_DATA[PIXELS_PER_TILE];
     //OBJECT DATA
-    struct OAM_STRUCT* CURRENT_OBJ;
+    OAM_STRUCT CURRENT_OBJ;
     bool VALID_OAM;
+    //FRAME SKIP
+    bool SKIP_RENDER;   //keeps mode timing but generates no pixels, only changed between frames
 } PPU_STRUCT;
 
 
 PPU_STRUCT* PPU;
 
 void ppu_init();
-void ppu_free();
 void execute_next_PPU_cycle();
 
 #endif //GB_EMU_PPU_H
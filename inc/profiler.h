@@ -0,0 +1,85 @@
+#ifndef GB_EMU_PROFILER_H
+#define GB_EMU_PROFILER_H
+
+/*
+ * Hot-path profiler, only built with -DGB_PROFILE=ON
+ */
+
+#define PROFILE_NUM_OPCODES 512     //0x100 and up are CB prefixed
+#define PROFILE_NUM_PPU_STATES 4
+#define PROFILE_NUM_INTERRUPTS 5
+#define PROFILE_MAX_DEPTH 64
+
+#ifdef GB_PROFILE
+
+//one node per distinct emulated call stack, its children are the functions it called
+typedef struct PROFILE_NODE {
+    uint16_t ADDRESS;
+    uint16_t BANK;              //ROM bank of ADDRESS, UINT16_MAX outside of ROM
+    uint32_t PARENT;
+    uint32_t FIRST_CHILD;       //0 is the root, which is never a child
+    uint32_t NEXT_SIBLING;
+    uint64_t CYCLES;            //M-cycles spent in this function, callees excluded
+    uint64_t HALTED_CYCLES;
+} PROFILE_NODE;
+
+typedef struct PROFILE_FRAME {
+    uint32_t NODE;
+    uint16_t RETURN_SP;         //SP once the call has returned
+} PROFILE_FRAME;
+
+typedef struct PROFILER_STRUCT {
+    uint64_t OPCODES[PROFILE_NUM_OPCODES];
+    uint64_t PPU_DOTS[PROFILE_NUM_PPU_STATES];
+    uint64_t INTERRUPTS[PROFILE_NUM_INTERRUPTS];
+    uint64_t DMA_CYCLES;
+    uint64_t INSTRUCTIONS;
+    uint64_t START_NS;
+    //instruction count per address, one 16KiB slot per ROM bank then 0x8000-0xFFFF
+    uint32_t* PC_COUNTS;
+    uint32_t NUM_PC_COUNTS;
+    //call tree for the folded stack output
+    PROFILE_NODE* NODES;
+    uint32_t NUM_NODES;
+    uint32_t NODE_CAPACITY;
+    PROFILE_FRAME STACK[PROFILE_MAX_DEPTH];
+    uint8_t DEPTH;
+    uint32_t CURRENT;
+} PROFILER_STRUCT;
+
+PROFILER_STRUCT* PROFILER;
+
+void profiler_init();
+void profiler_free();
+void profile_instruction(uint16_t pc, uint8_t opcode);
+void profile_call();
+void profile_return();
+void profiler_write_report(const char* prefix);
+
+#define PROFILE_INIT() profiler_init()
+#define PROFILE_FREE() profiler_free()
+#define PROFILE_INSTRUCTION(pc, opcode) profile_instruction(pc, opcode)
+#define PROFILE_CB_OPCODE(opcode) (PROFILER->OPCODES[0x100 | (opcode)]++)
+#define PROFILE_CPU_CYCLE(halted) ((halted) ? PROFILER->NODES[PROFILER->CURRENT].HALTED_CYCLES++ : PROFILER->NODES[PROFILER->CURRENT].CYCLES++)
+#define PROFILE_PPU_DOT(state) (PROFILER->PPU_DOTS[state]++)
+#define PROFILE_INTERRUPT(vector) (PROFILER->INTERRUPTS[((vector) - 0x40) / 8]++)
+#define PROFILE_DMA_CYCLE() (PROFILER->DMA_CYCLES++)
+#define PROFILE_CALL() profile_call()
+#define PROFILE_RETURN() profile_return()
+
+#else
+
+#define PROFILE_INIT() ((void) 0)
+#define PROFILE_FREE() ((void) 0)
+#define PROFILE_INSTRUCTION(pc, opcode) ((void) 0)
+#define PROFILE_CB_OPCODE(opcode) ((void) 0)
+#define PROFILE_CPU_CYCLE(halted) ((void) 0)
+#define PROFILE_PPU_DOT(state) ((void) 0)
+#define PROFILE_INTERRUPT(vector) ((void) 0)
+#define PROFILE_DMA_CYCLE() ((void) 0)
+#define PROFILE_CALL() ((void) 0)
+#define PROFILE_RETURN() ((void) 0)
+
+#endif //GB_PROFILE
+
+#endif //GB_EMU_PROFILER_H
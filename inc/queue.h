@@ -1,6 +1,8 @@
 #ifndef GB_EMU_QUEUE_H
 #define GB_EMU_QUEUE_H
 
+#define QUEUE_CAPACITY 10
+
 typedef void (*execute_func)(uint8_t);
 
 typedef struct func_and_parm_wrapper {
@@ -11,14 +13,13 @@ typedef struct func_and_parm_wrapper {
 typedef struct func_queue {
     int8_t front;
     int8_t back;
-    func_and_param_wrapper* functions;
+    func_and_param_wrapper functions[QUEUE_CAPACITY];
 } func_queue;
 
 func_queue* INSTR_QUEUE;
 
 
 void queue_init();
-void queue_free();
 bool is_empty(const func_queue* queue);
 void pixel_fifo_clear(PIXEL_FIFO* PIXEL_FIFO);
 void instr_queue_push(execute_func func, uint8_t parameter);
@@ -27,4 +28,6 @@ void sprite_fifo_push(const PIXEL_DATA* pixel_data);
 func_and_param_wrapper* instr_queue_pop();
 void pixel_fifo_pop(PIXEL_FIFO* PIXEL_FIFO, PIXEL_DATA* ret);
 bool pixel_fifo_is_empty(const PIXEL_FIFO* PIXEL_FIFO);
+void pixel_fifo_skip_push(PIXEL_FIFO* PIXEL_FIFO);
+void pixel_fifo_skip_pop(PIXEL_FIFO* PIXEL_FIFO);
 #endif //GB_EMU_QUEUE_H
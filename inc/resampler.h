@@ -0,0 +1,56 @@
+#ifndef GB_EMU_RESAMPLER_H
+#define GB_EMU_RESAMPLER_H
+
+#define RESAMPLER_PHASES 256        //fractional positions between two input frames with their own kernel
+#define RESAMPLER_TAP_ALIGN 8       //taps per phase are padded to whole AVX2 iterations
+
+enum RESAMPLE_QUALITY {
+    RESAMPLE_BOX,                   //averages the input over one output period
+    RESAMPLE_LOW,                   //windowed sinc, 4 zero crossings per side
+    RESAMPLE_MEDIUM,                //8 zero crossings
+    RESAMPLE_HIGH,                  //16 zero crossings
+    RESAMPLE_NUM_QUALITIES
+};
+
+enum RESAMPLE_KERNEL {
+    KERNEL_AUTO,                    //the widest the host supports
+    KERNEL_SCALAR,                  //reference
+    KERNEL_SSE2,
+    KERNEL_AVX2,
+    RESAMPLE_NUM_KERNELS
+};
+
+typedef void (*RESAMPLE_DOT)(const float* taps, const float (*input)[2], uint32_t num_taps, float* output);
+
+/*
+ * Polyphase FIR resampler for interleaved stereo floats. The kernel is designed
+ * once for the nominal ratio and tabulated at RESAMPLER_PHASES offsets; every
+ * output frame is a dot product of the nearest phase with the input frames
+ * around its position, so the ratio can be nudged while running.
+ */
+typedef struct RESAMPLER {
+    enum RESAMPLE_QUALITY QUALITY;
+    enum RESAMPLE_KERNEL KERNEL;    //resolved, never KERNEL_AUTO
+    RESAMPLE_DOT DOT;
+    uint32_t HALF;                  //frames before and including the output position
+    uint32_t TAPS;                  //per phase, 2 * HALF rounded up to RESAMPLER_TAP_ALIGN
+    float* PHASES;                  //RESAMPLER_PHASES * TAPS
+    float (*BUFFER)[2];             //input frames still needed by upcoming outputs
+    uint32_t BUFFER_SIZE;
+    uint32_t BUFFER_CAPACITY;
+    double POSITION;                //of the next output frame, in input frames from BUFFER[0]
+    double STEP;                    //input frames per output frame
+} RESAMPLER;
+
+void resampler_init(RESAMPLER* resampler, double ratio, enum RESAMPLE_QUALITY quality,
+                    enum RESAMPLE_KERNEL kernel, uint32_t max_input);
+void resampler_free(RESAMPLER* resampler);
+void resampler_set_step(RESAMPLER* resampler, double step);
+uint32_t resampler_process(RESAMPLER* resampler, const float (*input)[2], uint32_t count,
+                           float (*output)[2], uint32_t max_output);
+bool resampler_kernel_supported(enum RESAMPLE_KERNEL kernel);
+const char* resampler_quality_name(enum RESAMPLE_QUALITY quality);
+const char* resampler_kernel_name(enum RESAMPLE_KERNEL kernel);
+bool resampler_parse_quality(const char* name, enum RESAMPLE_QUALITY* quality);
+
+#endif //GB_EMU_RESAMPLER_H
@@ -0,0 +1,42 @@
+#ifndef GB_EMU_SAVESTATE_H
+#define GB_EMU_SAVESTATE_H
+
+#include <stddef.h>
+#include <cpu.h>
+#include <ppu.h>
+#include <queue.h>
+#include <min_heap.h>
+#include <memory.h>
+#include <apu.h>
+#include <gb.h>
+
+/*
+ * Everything the emulated machine's future depends on, copied by value so a
+ * state can be kept per frame and restored into the same instance. The FIFOs,
+ * fetcher pixels and object heap live inside their structs, only the
+ * cartridge's ROM and RAM pointers are kept from the live instance and its
+ * bank windows are rebuilt from the restored registers. Output that does not
+ * feed back into emulation is left out: the framebuffer, the APU's native
+ * block, resampler and samples, and captured serial output.
+ */
+typedef struct SAVESTATE {
+    GB_INSTANCE INSTANCE;           //CYCLE_COUNT and the timer and dot counters of gb.c
+    CPU_STRUCT CPU;
+    func_queue INSTR_QUEUE;
+    PPU_STRUCT PPU;
+    object_min_heap OBJ_HEAP;
+    uint8_t MEMORY[0x10000];
+    CARTRIDGE_STRUCT CARTRIDGE;     //bank registers
+    uint8_t* RAM;                   //CARTRIDGE->RAM_SIZE bytes, allocated by savestate_init()
+    uint8_t APU[offsetof(APU_STRUCT, NATIVE)];
+    uint64_t SERIAL_TRANSFER_END;
+    uint64_t SERIAL_TRANSFERS;
+} SAVESTATE;
+
+void savestate_init(SAVESTATE* state);
+void savestate_free(SAVESTATE* state);
+void savestate_save(SAVESTATE* state);
+void savestate_load(const SAVESTATE* state);
+uint64_t savestate_hash(const SAVESTATE* state, uint64_t hash);
+
+#endif //GB_EMU_SAVESTATE_H
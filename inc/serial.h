@@ -0,0 +1,53 @@
+#ifndef GB_EMU_SERIAL_H
+#define GB_EMU_SERIAL_H
+
+#define SERIAL_TRANSFER_START 0x80      //SC bits
+#define SERIAL_INTERNAL_CLOCK 0x01
+#define SERIAL_TRANSFER_CYCLES 1024     //M-cycles for 8 bits at 8192 Hz
+#define SERIAL_NO_TRANSFER UINT64_MAX
+#define SERIAL_DISCONNECTED 0xFF        //shifted in when nothing drives the line
+#define SERIAL_EXIT_PASSED 0            //gb_emu --serial-out exit codes, kept apart from exit(1) on errors
+#define SERIAL_EXIT_FAILED 10
+#define SERIAL_EXIT_TIMEOUT 11
+
+/*
+ * Result reported by a test ROM over the serial port. Blargg's tests print
+ * "Passed" or "Failed", Mooneye's send the bytes 3 5 8 13 21 34 on success
+ * and six 0x42 bytes on failure.
+ */
+enum SERIAL_RESULT {
+    SERIAL_RUNNING,
+    SERIAL_PASSED,
+    SERIAL_FAILED
+};
+
+/*
+ * Serial port. SB is shifted out MSB first while the peer's byte is shifted
+ * in, SC bit 7 starts a transfer and bit 0 selects the internal 8192 Hz clock.
+ * The exchange is applied whole when the last bit is clocked: SB gets the
+ * incoming byte, SC bit 7 clears and the serial interrupt is requested. On
+ * the internal clock without a cable 0xFF comes in after 1024 M-cycles, on the
+ * external clock the port waits for a peer that never clocks it. With a link
+ * cable attached the link decides when transfers end, see link.h.
+ */
+typedef struct SERIAL_STRUCT {
+    char* OUTPUT;           //bytes sent on the internal clock so far, only kept when CAPTURE is set
+    uint32_t SIZE;
+    uint32_t CAPACITY;
+    bool CAPTURE;           //keep output in memory instead of printing it
+    enum SERIAL_RESULT RESULT;
+    bool STOP_ON_RESULT;    //end the run slice at the M-cycle RESULT becomes known
+    uint64_t TRANSFER_END;  //CYCLE_COUNT the internal clock shifts the last bit at, SERIAL_NO_TRANSFER otherwise
+    bool LINKED;            //a link cable is attached and completes the transfers
+    uint64_t TRANSFERS;     //completed, either clock
+} SERIAL_STRUCT;
+
+SERIAL_STRUCT* SERIAL;
+
+void serial_init(bool capture);
+void serial_free();
+void serial_write_control();
+void serial_finish_transfer(uint8_t incoming);
+bool serial_save(const char* path);
+
+#endif //GB_EMU_SERIAL_H
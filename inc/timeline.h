@@ -0,0 +1,80 @@
+#ifndef GB_EMU_TIMELINE_H
+#define GB_EMU_TIMELINE_H
+
+#define TIMELINE_MAX_EVENTS (1 << 22)   //per track, later events are dropped
+
+/*
+ * Emulated tracks are timed in dots of the 4194304 Hz clock, host tracks in
+ * host nanoseconds. Each track is only written by one thread.
+ */
+enum TIMELINE_TRACK {
+    TRACK_PPU,
+    TRACK_CPU,
+    TRACK_INTERRUPTS,
+    TRACK_DMA,
+    TRACK_FRAMES,
+    TRACK_EMULATION_THREAD,
+    TRACK_RENDER_THREAD,
+    TIMELINE_NUM_TRACKS
+};
+
+typedef struct TIMELINE_EVENT {
+    const char* NAME;
+    uint64_t START;
+    uint64_t END;
+} TIMELINE_EVENT;
+
+typedef struct TIMELINE_TRACK_STRUCT {
+    TIMELINE_EVENT* EVENTS;
+    uint32_t SIZE;
+    uint32_t CAPACITY;
+    uint64_t DROPPED;
+    const char* OPEN_NAME;  //span begun but not ended yet, nullptr if none
+    uint64_t OPEN_START;
+} TIMELINE_TRACK_STRUCT;
+
+typedef struct TIMELINE_STRUCT {
+    TIMELINE_TRACK_STRUCT TRACKS[TIMELINE_NUM_TRACKS];
+    uint64_t DOTS;          //emulated clock, advanced by the PPU
+    uint64_t START_NS;
+    uint64_t FRAMES;
+    uint8_t PPU_STATE;
+    bool HALTED;
+} TIMELINE_STRUCT;
+
+TIMELINE_STRUCT* TIMELINE;
+
+void timeline_init();
+void timeline_free();
+void timeline_begin(enum TIMELINE_TRACK track, const char* name, uint64_t time);
+void timeline_end(enum TIMELINE_TRACK track, uint64_t time);
+void timeline_span(enum TIMELINE_TRACK track, const char* name, uint64_t start, uint64_t end);
+void timeline_ppu_dot(uint8_t state);
+void timeline_cpu_cycle(bool halted);
+void timeline_interrupt(uint8_t vector);
+void timeline_dma(uint8_t dma_cycle);
+void timeline_frame();
+void timeline_host_begin(enum TIMELINE_TRACK track, const char* name);
+void timeline_host_end(enum TIMELINE_TRACK track);
+bool timeline_write(const char* path);
+
+//the hooks only record once gb_emu --timeline has created TIMELINE
+#ifdef GB_TIMELINE
+#define TIMELINE_PPU_DOT(state) do { if (TIMELINE) timeline_ppu_dot(state); } while (0)
+#define TIMELINE_CPU_CYCLE(halted) do { if (TIMELINE) timeline_cpu_cycle(halted); } while (0)
+#define TIMELINE_INTERRUPT(vector) do { if (TIMELINE) timeline_interrupt(vector); } while (0)
+#define TIMELINE_DMA(dma_cycle) do { if (TIMELINE) timeline_dma(dma_cycle); } while (0)
+#define TIMELINE_FRAME() do { if (TIMELINE) timeline_frame(); } while (0)
+#define TIMELINE_HOST_BEGIN(track, name) do { if (TIMELINE) timeline_host_begin(track, name); } while (0)
+#define TIMELINE_HOST_END(track) do { if (TIMELINE) timeline_host_end(track); } while (0)
+#else
+#define TIMELINE_PPU_DOT(state) ((void) 0)
+#define TIMELINE_CPU_CYCLE(halted) ((void) 0)
+#define TIMELINE_INTERRUPT(vector) ((void) 0)
+#define TIMELINE_DMA(dma_cycle) ((void) 0)
+#define TIMELINE_FRAME() ((void) 0)
+#define TIMELINE_HOST_BEGIN(track, name) ((void) 0)
+#define TIMELINE_HOST_END(track) ((void) 0)
+#endif
+
+#endif //GB_EMU_TIMELINE_H
@@ -0,0 +1,69 @@
+#ifndef GB_EMU_TRACE_H
+#define GB_EMU_TRACE_H
+
+#define TRACE_RING_SIZE (1 << 16)   //records
+#define TRACE_BLOCK_SIZE 4096       //records handed to the writer at a time
+#define TRACE_NUM_BLOCKS (TRACE_RING_SIZE / TRACE_BLOCK_SIZE)
+#define TRACE_MAGIC "GBTRACE1"
+
+/*
+ * CPU state at the fetch of one instruction, before it executes. REGS follows
+ * CPU->REGS, A F B C D E H L.
+ */
+typedef struct TRACE_RECORD {
+    uint64_t CYCLE;
+    uint16_t PC;
+    uint16_t SP;
+    uint8_t REGS[8];
+    uint8_t OPCODE;
+    uint8_t IME;
+    uint8_t SCANLINE;   //LY
+} TRACE_RECORD;
+
+/*
+ * Single producer, single consumer ring of records. The emulation thread fills
+ * one block at a time and the writer thread delta encodes whole blocks to disk,
+ * FREE_BLOCKS and FULL_BLOCKS count the empty and filled blocks. HEAD and TAIL
+ * are only read across threads after a semaphore wait, which orders them.
+ */
+typedef struct TRACE_STRUCT {
+    TRACE_RECORD RING[TRACE_RING_SIZE];
+    uint64_t HEAD;          //records pushed, written by the emulation thread
+    uint64_t TAIL;          //records written out, only used by the writer thread
+    SDL_Semaphore* FREE_BLOCKS;
+    SDL_Semaphore* FULL_BLOCKS;
+    SDL_Thread* WRITER;
+    FILE* OUTPUT;
+    TRACE_RECORD PREVIOUS;  //last record encoded, records are stored as changes from it
+    //STATS
+    uint64_t BYTES_WRITTEN;
+    uint64_t BLOCKS;        //times the emulation thread waited on a full ring
+    uint64_t BLOCKED_NS;
+} TRACE_STRUCT;
+
+typedef struct TRACE_READER {
+    FILE* INPUT;
+    TRACE_RECORD RECORD;    //last record read
+    uint64_t INDEX;         //records read so far
+} TRACE_READER;
+
+TRACE_STRUCT* TRACE;
+
+void trace_init(const char* path);
+void trace_finish();
+void trace_free();
+void trace_push();
+void trace_print_stats();
+bool trace_reader_open(TRACE_READER* reader, const char* path);
+bool trace_read_next(TRACE_READER* reader);
+void trace_reader_close(TRACE_READER* reader);
+void trace_format_record(const TRACE_RECORD* record, char* text, size_t size);
+
+//the hook only records once gb_emu --trace has created TRACE
+#ifdef GB_TRACE
+#define TRACE_INSTRUCTION() do { if (TRACE) trace_push(); } while (0)
+#else
+#define TRACE_INSTRUCTION() ((void) 0)
+#endif
+
+#endif //GB_EMU_TRACE_H
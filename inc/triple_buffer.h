@@ -0,0 +1,41 @@
+#ifndef GB_EMU_TRIPLE_BUFFER_H
+#define GB_EMU_TRIPLE_BUFFER_H
+
+#include <stdatomic.h>
+
+typedef struct FRAME_SLOT {
+    INDEXED_FRAME FRAME;
+    uint64_t PUBLISH_TIME_NS;
+} FRAME_SLOT;
+
+/*
+ * Lock-free handoff of completed frames from the emulation thread to the render thread.
+ * Each side owns one slot and the third is swapped atomically through MIDDLE, so the
+ * emulation thread never waits on the render thread and the render thread always gets
+ * the newest frame. Frames that are overwritten before being read pass on their damage.
+ */
+typedef struct TRIPLE_BUFFER_STRUCT {
+    FRAME_SLOT SLOTS[3];
+    uint8_t WRITE_INDEX;    //only used by the emulation thread
+    uint8_t READ_INDEX;     //only used by the render thread
+    _Atomic uint8_t MIDDLE; //index of the shared slot, FRESH_FRAME is set until it is read
+    //STATS
+    _Atomic uint64_t FRAMES_PUBLISHED;
+    _Atomic uint64_t FRAMES_PRESENTED;
+    _Atomic uint64_t FRAMES_DROPPED;    //overwritten before the render thread read them
+    _Atomic uint64_t PRESENT_STALLS;    //presents that blocked for longer than a frame
+    _Atomic uint64_t PRESENT_STALL_NS;
+    _Atomic uint64_t LATENCY_TOTAL_NS;  //publish to end of present
+    _Atomic uint64_t LATENCY_MAX_NS;
+} TRIPLE_BUFFER_STRUCT;
+
+TRIPLE_BUFFER_STRUCT* FRAME_HANDOFF;
+
+void triple_buffer_init();
+void triple_buffer_free();
+void triple_buffer_publish(const INDEXED_FRAME* frame);
+const FRAME_SLOT* triple_buffer_acquire(int32_t timeout_ms);
+void triple_buffer_presented(const FRAME_SLOT* slot, uint64_t present_start_ns);
+void triple_buffer_print_stats();
+
+#endif //GB_EMU_TRIPLE_BUFFER_H
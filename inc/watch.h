@@ -0,0 +1,47 @@
+#ifndef GB_EMU_WATCH_H
+#define GB_EMU_WATCH_H
+
+#define WATCH_MAX 64
+#define WATCH_NUM_PAGES 256     //256-byte pages
+
+enum WATCH_TYPE {
+    WATCH_READ = 0x01,
+    WATCH_WRITE = 0x02,
+    WATCH_EXECUTE = 0x04
+};
+
+typedef struct WATCH_HIT {
+    uint64_t CYCLE;
+    uint16_t PC;            //instruction that made the access
+    uint16_t ADDRESS;
+    uint8_t VALUE;          //byte read, written or fetched
+    enum WATCH_TYPE TYPE;
+} WATCH_HIT;
+
+typedef void (*watch_callback)(const WATCH_HIT* hit, void* user_data);
+
+typedef struct WATCHPOINT {
+    uint16_t START;
+    uint16_t END;           //inclusive
+    uint8_t TYPES;          //WATCH_TYPE bits
+    watch_callback CALLBACK;
+    void* USER_DATA;
+    uint64_t HITS;
+    bool ACTIVE;
+} WATCHPOINT;
+
+/*
+ * Trap bits per 256-byte page, the OR of the types of every watchpoint touching
+ * the page. read_memory(), write_memory() and the opcode fetch only look at this
+ * table, so pages without a watch keep the fast path and no watch costs one load.
+ * Only CPU accesses are watched, OAM DMA and the PPU read MEMORY directly.
+ */
+uint8_t WATCH_PAGES[WATCH_NUM_PAGES];
+WATCHPOINT WATCHPOINTS[WATCH_MAX];
+
+int watch_add(uint16_t start, uint16_t end, uint8_t types, watch_callback callback, void* user_data);
+void watch_remove(int id);
+void watch_clear();
+void watch_hit(enum WATCH_TYPE type, uint16_t address, uint8_t value);
+
+#endif //GB_EMU_WATCH_H
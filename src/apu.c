@@ -0,0 +1,525 @@
+#include <common.h>
+#include <SDL3/SDL.h>
+#include <gb.h>
+#include <memory.h>
+#include <apu.h>
+
+#define REGISTER(channel, index) MEMORY[NR10 + 5 * (channel) + (index)]
+#define CYCLES_PER_M_CYCLE 4
+#define HIGH_PASS_CHARGE 0.999958   //per T-cycle, the DMG output capacitor
+#define SAMPLE_SCALE 32767.0f
+#define RESAMPLE_CHUNK (APU_BLOCK_SIZE / 8 + 1)    //output frames per resampler_process() call, a whole block at APU_MAX_OUTPUT_RATE
+
+static const uint8_t DUTY_PATTERNS[4] = {0x01, 0x81, 0x87, 0x7E};  //12.5%, 25%, 50%, 75%
+static const uint8_t NOISE_DIVISORS[8] = {8, 16, 32, 48, 64, 80, 96, 112};
+static const uint8_t WAVE_SHIFTS[4] = {4, 0, 1, 2};                //mute, 100%, 50%, 25%
+
+//bits of NR10-NR52 that always read back as 1
+static const uint8_t READ_MASKS[NR52 - NR10 + 1] = {
+    0x80, 0x3F, 0x00, 0xFF, 0xBF,
+    0xFF, 0x3F, 0x00, 0xFF, 0xBF,
+    0x7F, 0xFF, 0x9F, 0xFF, 0xBF,
+    0xFF, 0xFF, 0x00, 0x00, 0xBF,
+    0x00, 0x00, 0x70
+};
+
+static uint16_t channel_frequency(uint8_t channel) {
+    return ((REGISTER(channel, 4) & 0x07) << 8) | REGISTER(channel, 3);
+}
+
+/*
+ * T-cycles between two steps of CHANNEL's waveform
+ */
+static uint32_t channel_period(uint8_t channel) {
+    switch (channel) {
+        case APU_SQUARE1:
+        case APU_SQUARE2:
+            return (2048 - channel_frequency(channel)) * 4;
+        case APU_WAVE:
+            return (2048 - channel_frequency(channel)) * 2;
+        default:
+            return NOISE_DIVISORS[MEMORY[NR43] & 0x07] << (MEMORY[NR43] >> 4);
+    }
+}
+
+void apu_init() {
+    APU->POWERED = MEMORY[NR52] & 0x80;
+    for (uint8_t channel = 0; channel < APU_NUM_CHANNELS; channel++) {
+        APU_CHANNEL* state = &APU->CHANNELS[channel];
+        state->DAC_ENABLED = channel == APU_WAVE ? MEMORY[NR30] & 0x80 : REGISTER(channel, 2) & 0xF8;
+        state->TIMER = channel_period(channel);
+        state->LFSR = 0x7FFF;
+    }
+    //the boot ROM leaves channel 1 on, its chime has faded out so VOLUME stays 0
+    APU->CHANNELS[APU_SQUARE1].ENABLED = MEMORY[NR52] & 0x01;
+    APU->FRAME_SEQUENCER_TIMER = APU_FRAME_SEQUENCER_PERIOD;
+    APU->LAST_CYCLE = CYCLE_COUNT;
+}
+
+void apu_free() {
+    resampler_free(&APU->RESAMPLER);
+}
+
+///////////////////////////////////////// FRAME SEQUENCER /////////////////////////////////////////
+
+/*
+ * Computes the next sweep frequency, turning channel 1 off when it overflows
+ */
+static uint16_t sweep_calculate() {
+    uint16_t delta = APU->SHADOW_FREQUENCY >> (MEMORY[NR10] & 0x07);
+    uint16_t frequency = MEMORY[NR10] & 0x08 ? APU->SHADOW_FREQUENCY - delta : APU->SHADOW_FREQUENCY + delta;
+    if (frequency > 2047) {
+        APU->CHANNELS[APU_SQUARE1].ENABLED = false;
+    }
+    return frequency;
+}
+
+static void clock_sweep() {
+    if (APU->SWEEP_TIMER) {
+        APU->SWEEP_TIMER--;
+    }
+    if (APU->SWEEP_TIMER) {
+        return;
+    }
+    uint8_t period = (MEMORY[NR10] >> 4) & 0x07;
+    APU->SWEEP_TIMER = period ? period : 8;
+    if (!APU->SWEEP_ENABLED || !period) {
+        return;
+    }
+    uint16_t frequency = sweep_calculate();
+    if (frequency <= 2047 && (MEMORY[NR10] & 0x07)) {
+        APU->SHADOW_FREQUENCY = frequency;
+        MEMORY[NR13] = frequency & 0xFF;
+        MEMORY[NR14] = (MEMORY[NR14] & 0xF8) | (frequency >> 8);
+        sweep_calculate();
+    }
+}
+
+static void clock_lengths() {
+    for (uint8_t channel = 0; channel < APU_NUM_CHANNELS; channel++) {
+        APU_CHANNEL* state = &APU->CHANNELS[channel];
+        if (state->LENGTH_ENABLED && state->LENGTH) {
+            state->LENGTH--;
+            if (!state->LENGTH) {
+                state->ENABLED = false;
+            }
+        }
+    }
+}
+
+static void clock_envelopes() {
+    for (uint8_t channel = 0; channel < APU_NUM_CHANNELS; channel++) {
+        uint8_t envelope = REGISTER(channel, 2);
+        APU_CHANNEL* state = &APU->CHANNELS[channel];
+        if (channel == APU_WAVE || !(envelope & 0x07)) {
+            continue;
+        }
+        if (state->ENVELOPE_TIMER) {
+            state->ENVELOPE_TIMER--;
+        }
+        if (state->ENVELOPE_TIMER) {
+            continue;
+        }
+        state->ENVELOPE_TIMER = envelope & 0x07;
+        if ((envelope & 0x08) && state->VOLUME < 15) {
+            state->VOLUME++;
+        }
+        else if (!(envelope & 0x08) && state->VOLUME > 0) {
+            state->VOLUME--;
+        }
+    }
+}
+
+/*
+ * 512 Hz: lengths on even steps, sweep on steps 2 and 6, envelopes on step 7
+ */
+static void step_frame_sequencer() {
+    uint8_t step = APU->FRAME_SEQUENCER_STEP;
+    if (!(step & 0x01)) {
+        clock_lengths();
+    }
+    if (step == 2 || step == 6) {
+        clock_sweep();
+    }
+    if (step == 7) {
+        clock_envelopes();
+    }
+    APU->FRAME_SEQUENCER_STEP = (step + 1) & 0x07;
+}
+
+///////////////////////////////////////// SYNTHESIS /////////////////////////////////////////
+
+/*
+ * Digital output of CHANNEL, 0-15
+ */
+static uint8_t channel_output(uint8_t channel) {
+    const APU_CHANNEL* state = &APU->CHANNELS[channel];
+    if (!state->ENABLED) {
+        return 0;
+    }
+    switch (channel) {
+        case APU_SQUARE1:
+        case APU_SQUARE2:
+            return (DUTY_PATTERNS[REGISTER(channel, 1) >> 6] >> state->POSITION) & 0x01 ? state->VOLUME : 0;
+        case APU_WAVE: {
+            uint8_t sample = MEMORY[WAVE_RAM + state->POSITION / 2];
+            sample = state->POSITION & 0x01 ? sample & 0x0F : sample >> 4;
+            return sample >> WAVE_SHIFTS[(MEMORY[NR32] >> 5) & 0x03];
+        }
+        default:
+            return state->LFSR & 0x01 ? 0 : state->VOLUME;
+    }
+}
+
+/*
+ * Sums the channels through their DACs, NR51 panning and NR50 master volume into -1.0-1.0
+ */
+static void mix(float* left, float* right) {
+    float left_sum = 0.0f;
+    float right_sum = 0.0f;
+    uint8_t panning = MEMORY[NR51];
+    for (uint8_t channel = 0; channel < APU_NUM_CHANNELS; channel++) {
+        if (!APU->CHANNELS[channel].DAC_ENABLED) {
+            continue;
+        }
+        float analog = channel_output(channel) / 7.5f - 1.0f;
+        if (panning & (0x10 << channel)) {
+            left_sum += analog;
+        }
+        if (panning & (0x01 << channel)) {
+            right_sum += analog;
+        }
+    }
+    *left = left_sum * (((MEMORY[NR50] >> 4) & 0x07) + 1) / 32.0f;
+    *right = right_sum * ((MEMORY[NR50] & 0x07) + 1) / 32.0f;
+}
+
+static void step_noise(APU_CHANNEL* state) {
+    uint16_t bit = (state->LFSR ^ (state->LFSR >> 1)) & 0x01;
+    state->LFSR = (state->LFSR >> 1) | (bit << 14);
+    if (MEMORY[NR43] & 0x08) {
+        state->LFSR = (state->LFSR & ~0x40) | (bit << 6);
+    }
+}
+
+/*
+ * Runs every waveform CYCLES T-cycles ahead, squares and waves in one step
+ */
+static void advance_waveforms(uint32_t cycles) {
+    for (uint8_t channel = 0; channel < APU_NUM_CHANNELS; channel++) {
+        APU_CHANNEL* state = &APU->CHANNELS[channel];
+        if (!state->ENABLED) {
+            continue;
+        }
+        if (state->TIMER > cycles) {
+            state->TIMER -= cycles;
+            continue;
+        }
+        uint32_t period = channel_period(channel);
+        uint32_t past = cycles - state->TIMER;
+        if (channel == APU_NOISE) {
+            step_noise(state);
+            for (; past >= period; past -= period) {
+                step_noise(state);
+            }
+        }
+        else {
+            uint8_t mask = channel == APU_WAVE ? 0x1F : 0x07;
+            state->POSITION = (state->POSITION + 1 + past / period) & mask;
+            past %= period;
+        }
+        state->TIMER = period - past;
+    }
+}
+
+/*
+ * True when CHANNEL outputs the same level whatever its waveform position
+ */
+static bool channel_silent(uint8_t channel) {
+    const APU_CHANNEL* state = &APU->CHANNELS[channel];
+    if (!state->ENABLED || !state->DAC_ENABLED) {
+        return true;
+    }
+    return channel == APU_WAVE ? !(MEMORY[NR32] & 0x60) : !state->VOLUME;
+}
+
+/*
+ * M-cycles the mixed output stays the same for, at least 1
+ */
+static uint32_t steady_cycles(uint32_t limit) {
+    for (uint8_t channel = 0; channel < APU_NUM_CHANNELS; channel++) {
+        if (channel_silent(channel)) {
+            continue;
+        }
+        uint32_t cycles = (APU->CHANNELS[channel].TIMER + CYCLES_PER_M_CYCLE - 1) / CYCLES_PER_M_CYCLE;
+        if (cycles < limit) {
+            limit = cycles;
+        }
+    }
+    return limit;
+}
+
+static void output_sample(float left, float right) {
+    if (APU->NUM_SAMPLES == APU_MAX_SAMPLES) {
+        APU->SAMPLES_DROPPED++;
+        return;
+    }
+    float input[2] = {left, right};
+    for (uint8_t side = 0; side < 2; side++) {
+        float output = input[side] - APU->HIGH_PASS[side];
+        APU->HIGH_PASS[side] = input[side] - output * APU->HIGH_PASS_FACTOR;
+        float scaled = output * SAMPLE_SCALE;
+        if (scaled > SAMPLE_SCALE) {
+            scaled = SAMPLE_SCALE;
+        }
+        else if (scaled < -SAMPLE_SCALE) {
+            scaled = -SAMPLE_SCALE;
+        }
+        APU->SAMPLES[APU->NUM_SAMPLES][side] = (int16_t) scaled;
+    }
+    APU->NUM_SAMPLES++;
+}
+
+/*
+ * Resamples the native block down to OUTPUT_RATE. A block fits in one pass at
+ * any allowed rate and ratio, the loop only drains what a full chunk leaves
+ * behind so input never backs up in the resampler.
+ */
+static void resample_block() {
+    float resampled[RESAMPLE_CHUNK][2];
+    uint32_t input = APU->NATIVE_SIZE;
+    uint32_t count;
+    do {
+        count = resampler_process(&APU->RESAMPLER, APU->NATIVE, input, resampled, RESAMPLE_CHUNK);
+        for (uint32_t i = 0; i < count; i++) {
+            output_sample(resampled[i][0], resampled[i][1]);
+        }
+        input = 0;
+    } while (count == RESAMPLE_CHUNK);
+    APU->NATIVE_SIZE = 0;
+}
+
+/*
+ * Appends COUNT native samples of the same value to the block
+ */
+static void emit(float left, float right, uint32_t count) {
+    while (count) {
+        uint32_t run = APU_BLOCK_SIZE - APU->NATIVE_SIZE;
+        if (run > count) {
+            run = count;
+        }
+        float (*native)[2] = &APU->NATIVE[APU->NATIVE_SIZE];
+        for (uint32_t i = 0; i < run; i++) {
+            native[i][0] = left;
+            native[i][1] = right;
+        }
+        APU->NATIVE_SIZE += run;
+        count -= run;
+        if (APU->NATIVE_SIZE == APU_BLOCK_SIZE) {
+            resample_block();
+        }
+    }
+}
+
+static void synthesize(uint32_t cycles) {
+    while (cycles) {
+        uint32_t run = steady_cycles(cycles);
+        float left;
+        float right;
+        mix(&left, &right);
+        emit(left, right, run);
+        advance_waveforms(run * CYCLES_PER_M_CYCLE);
+        cycles -= run;
+    }
+}
+
+/*
+ * Runs the APU from LAST_CYCLE up to CYCLE_COUNT, split at frame sequencer steps
+ */
+void apu_catch_up() {
+    uint64_t cycles = CYCLE_COUNT - APU->LAST_CYCLE;
+    APU->LAST_CYCLE = CYCLE_COUNT;
+    while (cycles) {
+        uint32_t run = cycles < APU->FRAME_SEQUENCER_TIMER ? (uint32_t) cycles : APU->FRAME_SEQUENCER_TIMER;
+        if (APU->SYNTHESIZE) {
+            synthesize(run);
+        }
+        cycles -= run;
+        APU->FRAME_SEQUENCER_TIMER -= run;
+        if (!APU->FRAME_SEQUENCER_TIMER) {
+            APU->FRAME_SEQUENCER_TIMER = APU_FRAME_SEQUENCER_PERIOD;
+            if (APU->POWERED) {
+                step_frame_sequencer();
+            }
+        }
+    }
+}
+
+/*
+ * Called once per frame, leaves every sample of the frame in APU->SAMPLES
+ */
+void apu_end_frame() {
+    apu_catch_up();
+    if (APU->SYNTHESIZE) {
+        resample_block();
+    }
+}
+
+/*
+ * Starts mixing samples and resampling them to RATE with a kernel of the given
+ * QUALITY, using the widest SIMD dot product the host supports
+ */
+void apu_start_sound(uint32_t rate, enum RESAMPLE_QUALITY quality) {
+    resampler_free(&APU->RESAMPLER);
+    APU->OUTPUT_RATE = rate;
+    APU->HIGH_PASS_FACTOR = (float) SDL_pow(HIGH_PASS_CHARGE, CLOCK_FREQ / rate);
+    resampler_init(&APU->RESAMPLER, (double) APU_NATIVE_RATE / rate, quality, KERNEL_AUTO, APU_BLOCK_SIZE);
+    APU->SYNTHESIZE = true;
+}
+
+/*
+ * Produces RATIO times OUTPUT_RATE samples per emulated second, the frontend
+ * nudges this to keep its audio queue from draining or filling up. RATIO is
+ * kept within APU_MAX_RATE_ADJUST of 1.
+ */
+void apu_set_rate_ratio(double ratio) {
+    if (ratio > 1.0 + APU_MAX_RATE_ADJUST) {
+        ratio = 1.0 + APU_MAX_RATE_ADJUST;
+    }
+    else if (ratio < 1.0 - APU_MAX_RATE_ADJUST) {
+        ratio = 1.0 - APU_MAX_RATE_ADJUST;
+    }
+    resampler_set_step(&APU->RESAMPLER, APU_NATIVE_RATE / (APU->OUTPUT_RATE * ratio));
+}
+
+///////////////////////////////////////// REGISTERS /////////////////////////////////////////
+
+static void trigger(uint8_t channel) {
+    APU_CHANNEL* state = &APU->CHANNELS[channel];
+    state->ENABLED = state->DAC_ENABLED;
+    if (!state->LENGTH) {
+        state->LENGTH = channel == APU_WAVE ? 256 : 64;
+    }
+    state->TIMER = channel_period(channel);
+    if (channel == APU_WAVE) {
+        state->POSITION = 0;
+    }
+    else {
+        uint8_t envelope = REGISTER(channel, 2);
+        state->VOLUME = envelope >> 4;
+        state->ENVELOPE_TIMER = envelope & 0x07 ? envelope & 0x07 : 8;
+    }
+    if (channel == APU_NOISE) {
+        state->LFSR = 0x7FFF;
+    }
+    if (channel == APU_SQUARE1) {
+        uint8_t period = (MEMORY[NR10] >> 4) & 0x07;
+        uint8_t shift = MEMORY[NR10] & 0x07;
+        APU->SHADOW_FREQUENCY = channel_frequency(APU_SQUARE1);
+        APU->SWEEP_TIMER = period ? period : 8;
+        APU->SWEEP_ENABLED = period || shift;
+        if (shift) {
+            sweep_calculate();
+        }
+    }
+}
+
+static void power_off() {
+    memset(&MEMORY[NR10], 0, NR52 - NR10);
+    for (uint8_t channel = 0; channel < APU_NUM_CHANNELS; channel++) {
+        APU->CHANNELS[channel].ENABLED = false;
+        APU->CHANNELS[channel].DAC_ENABLED = false;
+    }
+}
+
+/*
+ * CPU read of 0xFF10-0xFF3F, only NR52 depends on the APU having caught up
+ */
+uint8_t apu_read(uint16_t address) {
+    if (address >= WAVE_RAM) {
+        return MEMORY[address];
+    }
+    if (address == NR52) {
+        apu_catch_up();
+        uint8_t status = APU->POWERED ? 0xF0 : 0x70;
+        for (uint8_t channel = 0; channel < APU_NUM_CHANNELS; channel++) {
+            if (APU->CHANNELS[channel].ENABLED) {
+                status |= 1 << channel;
+            }
+        }
+        return status;
+    }
+    if (address > NR52) {
+        return 0xFF;
+    }
+    return MEMORY[address] | READ_MASKS[address - NR10];
+}
+
+/*
+ * CPU write of 0xFF10-0xFF3F, the APU runs up to now with the old value first
+ */
+void apu_write(uint16_t address, uint8_t value) {
+    apu_catch_up();
+    if (address >= WAVE_RAM) {
+        MEMORY[address] = value;
+        return;
+    }
+    if (address == NR52) {
+        bool powered = value & 0x80;
+        if (APU->POWERED && !powered) {
+            power_off();
+        }
+        else if (!APU->POWERED && powered) {
+            APU->FRAME_SEQUENCER_STEP = 0;
+        }
+        APU->POWERED = powered;
+        MEMORY[NR52] = value & 0x80;
+        return;
+    }
+    if (address > NR52) {
+        return;
+    }
+    uint8_t channel = (address - NR10) / 5;
+    uint8_t reg = (address - NR10) % 5;
+    if (!APU->POWERED) {
+        //a DMG powered off still takes the length half of NRx1, the duty bits stay cleared
+        if (channel < APU_NUM_CHANNELS && reg == 1) {
+            if (channel != APU_WAVE) {
+                value &= 0x3F;
+            }
+            MEMORY[address] = value;
+            APU->CHANNELS[channel].LENGTH = channel == APU_WAVE ? 256 - value : 64 - value;
+        }
+        return;
+    }
+    MEMORY[address] = value;
+    if (channel >= APU_NUM_CHANNELS) {
+        return;
+    }
+    APU_CHANNEL* state = &APU->CHANNELS[channel];
+    switch (reg) {
+        case 0:
+            if (channel == APU_WAVE) {
+                state->DAC_ENABLED = value & 0x80;
+                state->ENABLED &= state->DAC_ENABLED;
+            }
+            break;
+        case 1:
+            state->LENGTH = channel == APU_WAVE ? 256 - value : 64 - (value & 0x3F);
+            break;
+        case 2:
+            if (channel != APU_WAVE) {
+                state->DAC_ENABLED = value & 0xF8;
+                state->ENABLED &= state->DAC_ENABLED;
+            }
+            break;
+        case 4:
+            state->LENGTH_ENABLED = value & 0x40;
+            if (value & 0x80) {
+                trigger(channel);
+            }
+            break;
+        default:
+            break;
+    }
+}
@@ -0,0 +1,172 @@
+#include <common.h>
+#include <SDL3/SDL.h>
+#include <apu.h>
+#include <audio.h>
+
+#define BYTES_PER_FRAME (2 * sizeof(int16_t))
+#define RING_MASK (AUDIO_RING_SIZE - 1)
+#define CALLBACK_CHUNK 1024         //frames handed to SDL at a time
+#define FILL_SMOOTHING 0.1
+
+static void audio_callback(void* UNUSED, SDL_AudioStream* stream, int additional_amount, int total_amount);
+
+/*
+ * Opens the default playback device, returns false and leaves AUDIO unset
+ * when there is none so the emulator runs silent
+ */
+bool audio_init(enum AUDIO_SYNC sync, uint32_t rate) {
+    if (!SDL_Init(SDL_INIT_AUDIO)) {
+        fprintf(stderr, "Error initializing SDL3 audio, running without sound: %s\n", SDL_GetError());
+        return false;
+    }
+    AUDIO = (AUDIO_STRUCT*) calloc(1, sizeof(AUDIO_STRUCT));
+    AUDIO->SYNC = sync;
+    AUDIO->RATE = rate;
+    AUDIO->TARGET_FRAMES = rate * AUDIO_TARGET_MS / 1000;
+    AUDIO->RATIO = 1.0;
+    AUDIO->RATIO_MIN = 1.0;
+    AUDIO->RATIO_MAX = 1.0;
+    //the callback can run as soon as the stream exists, AUDIO has to be ready by then
+    SDL_AudioSpec spec = {.format = SDL_AUDIO_S16, .channels = 2, .freq = (int) rate};
+    AUDIO->STREAM = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec, audio_callback, nullptr);
+    if (!AUDIO->STREAM) {
+        fprintf(stderr, "Error opening audio device, running without sound: %s\n", SDL_GetError());
+        free(AUDIO);
+        AUDIO = nullptr;
+        return false;
+    }
+    SDL_ResumeAudioStreamDevice(AUDIO->STREAM);
+    return true;
+}
+
+void audio_free() {
+    if (!AUDIO) {
+        return;
+    }
+    SDL_DestroyAudioStream(AUDIO->STREAM);
+    free(AUDIO);
+    AUDIO = nullptr;
+}
+
+/*
+ * Runs on SDL's audio thread whenever the device needs ADDITIONAL_AMOUNT more
+ * bytes. Plays silence until the ring first reaches its target, and counts an
+ * underrun whenever it runs dry after that.
+ */
+static void audio_callback(void* UNUSED, SDL_AudioStream* stream, int additional_amount, int total_amount) {
+    (void)UNUSED;
+    (void)total_amount;
+    int16_t chunk[CALLBACK_CHUNK][2];
+    uint64_t tail = atomic_load_explicit(&AUDIO->TAIL, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&AUDIO->HEAD, memory_order_acquire);
+    if (!atomic_load(&AUDIO->PRIMED) && head - tail >= AUDIO->TARGET_FRAMES) {
+        atomic_store(&AUDIO->PRIMED, true);
+    }
+    bool primed = atomic_load(&AUDIO->PRIMED);
+    uint32_t wanted = additional_amount / BYTES_PER_FRAME;
+    uint32_t silent = 0;
+    while (wanted) {
+        uint32_t count = wanted < CALLBACK_CHUNK ? wanted : CALLBACK_CHUNK;
+        uint32_t copied = primed ? (uint32_t) (head - tail) : 0;
+        if (copied > count) {
+            copied = count;
+        }
+        for (uint32_t i = 0; i < copied; i++) {
+            chunk[i][0] = AUDIO->RING[(tail + i) & RING_MASK][0];
+            chunk[i][1] = AUDIO->RING[(tail + i) & RING_MASK][1];
+        }
+        memset(chunk[copied], 0, (count - copied) * BYTES_PER_FRAME);
+        silent += count - copied;
+        tail += copied;
+        //hand the space back before SDL converts the chunk
+        atomic_store_explicit(&AUDIO->TAIL, tail, memory_order_release);
+        SDL_PutAudioStreamData(stream, chunk, (int) (count * BYTES_PER_FRAME));
+        wanted -= count;
+    }
+    if (silent && primed) {
+        atomic_fetch_add(&AUDIO->UNDERRUNS, 1);
+        atomic_fetch_add(&AUDIO->SILENT_FRAMES, silent);
+    }
+}
+
+/*
+ * Steers the APU's output rate so the ring settles at TARGET_FRAMES, producing
+ * up to APU_MAX_RATE_ADJUST more samples when it runs low and fewer when it fills up.
+ * SYNC_AUDIO keeps the ratio at 1, audio_wait() already holds the ring at its
+ * target and steering on top of it would only make emulation run fast.
+ */
+static void update_rate(uint64_t fill) {
+    uint64_t queued = fill + SDL_GetAudioStreamQueued(AUDIO->STREAM) / BYTES_PER_FRAME;
+    AUDIO->LATENCY_SUM_MS += queued * 1000.0 / AUDIO->RATE;
+    AUDIO->LATENCY_SAMPLES++;
+    if (AUDIO->SYNC == SYNC_AUDIO) {
+        return;
+    }
+    AUDIO->FILL_AVERAGE += (fill - AUDIO->FILL_AVERAGE) * FILL_SMOOTHING;
+    double error = (AUDIO->TARGET_FRAMES - AUDIO->FILL_AVERAGE) / AUDIO->TARGET_FRAMES;
+    if (error > 1.0) {
+        error = 1.0;
+    }
+    else if (error < -1.0) {
+        error = -1.0;
+    }
+    AUDIO->RATIO = 1.0 + APU_MAX_RATE_ADJUST * error;
+    apu_set_rate_ratio(AUDIO->RATIO);
+    if (AUDIO->RATIO < AUDIO->RATIO_MIN) {
+        AUDIO->RATIO_MIN = AUDIO->RATIO;
+    }
+    if (AUDIO->RATIO > AUDIO->RATIO_MAX) {
+        AUDIO->RATIO_MAX = AUDIO->RATIO;
+    }
+}
+
+/*
+ * Moves the samples of the frame that just finished into the ring and hands the
+ * buffer back to the APU
+ */
+void audio_push() {
+    uint32_t frames = APU->NUM_SAMPLES;
+    APU->NUM_SAMPLES = 0;
+    uint64_t head = atomic_load_explicit(&AUDIO->HEAD, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&AUDIO->TAIL, memory_order_acquire);
+    uint32_t space = AUDIO_RING_SIZE - (uint32_t) (head - tail);
+    if (frames > space) {
+        AUDIO->OVERRUNS++;
+        AUDIO->DROPPED_FRAMES += frames - space;
+        frames = space;
+    }
+    for (uint32_t i = 0; i < frames; i++) {
+        AUDIO->RING[(head + i) & RING_MASK][0] = APU->SAMPLES[i][0];
+        AUDIO->RING[(head + i) & RING_MASK][1] = APU->SAMPLES[i][1];
+    }
+    atomic_store_explicit(&AUDIO->HEAD, head + frames, memory_order_release);
+    update_rate(head + frames - tail);
+}
+
+/*
+ * SYNC_AUDIO frame limiter, sleeps until the callback has played the ring down
+ * to its target. A device that stops pulling only holds emulation up for
+ * AUDIO_TARGET_MS.
+ */
+void audio_wait() {
+    uint64_t give_up = SDL_GetTicksNS() + AUDIO_TARGET_MS * 1000000ULL;
+    while (true) {
+        uint64_t fill = atomic_load_explicit(&AUDIO->HEAD, memory_order_relaxed) -
+                        atomic_load_explicit(&AUDIO->TAIL, memory_order_acquire);
+        uint64_t now = SDL_GetTicksNS();
+        if (fill <= AUDIO->TARGET_FRAMES || now >= give_up) {
+            return;
+        }
+        uint64_t excess_ns = (fill - AUDIO->TARGET_FRAMES) * 1000000000ULL / AUDIO->RATE;
+        SDL_DelayNS(excess_ns < give_up - now ? excess_ns : give_up - now);
+    }
+}
+
+void audio_print_stats() {
+    printf("Audio: %llu underruns (%llu frames of silence), %llu overruns (%llu frames dropped)\n",
+           (unsigned long long) atomic_load(&AUDIO->UNDERRUNS), (unsigned long long) atomic_load(&AUDIO->SILENT_FRAMES),
+           (unsigned long long) AUDIO->OVERRUNS, (unsigned long long) AUDIO->DROPPED_FRAMES);
+    printf("Audio latency average: %.1f ms, resampling ratio %.4f-%.4f\n",
+           AUDIO->LATENCY_SAMPLES ? AUDIO->LATENCY_SUM_MS / AUDIO->LATENCY_SAMPLES : 0.0,
+           AUDIO->RATIO_MIN, AUDIO->RATIO_MAX);
+}
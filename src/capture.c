@@ -0,0 +1,161 @@
+#include <common.h>
+#include <SDL3/SDL.h>
+#include <framebuffer.h>
+#include <capture.h>
+
+#define Y4M_FRAME_HEADER "FRAME\n"
+#define Y4M_FRAME_HEADER_SIZE (sizeof(Y4M_FRAME_HEADER) - 1)
+#define PLANE_SIZE (WINDOW_WIDTH * WINDOW_HEIGHT)
+
+static int writer_thread(void* UNUSED);
+
+void capture_init(const char* path, enum CAPTURE_FORMAT format, enum CAPTURE_BACKPRESSURE backpressure) {
+    CAPTURE = (CAPTURE_STRUCT*) calloc(1, sizeof(CAPTURE_STRUCT));
+    //a named pipe blocks here until a reader opens it
+    CAPTURE->OUTPUT = fopen(path, "wb");
+    if (!CAPTURE->OUTPUT) {
+        perror("Couldn't open capture file");
+        exit(1);
+    }
+    CAPTURE->FORMAT = format;
+    CAPTURE->BACKPRESSURE = backpressure;
+    CAPTURE->HEAD = 0;
+    CAPTURE->TAIL = 0;
+    CAPTURE->WRITE_FAILED = false;
+    if (format == CAPTURE_Y4M) {
+        //frame rate is the exact 4194304 / 70224 Hz
+        fprintf(CAPTURE->OUTPUT, "YUV4MPEG2 W%d H%d F4194304:70224 Ip A1:1 C444\n", WINDOW_WIDTH, WINDOW_HEIGHT);
+    }
+
+    CAPTURE->FREE_SLOTS = SDL_CreateSemaphore(CAPTURE_RING_SIZE);
+    CAPTURE->QUEUED_FRAMES = SDL_CreateSemaphore(0);
+    CAPTURE->WRITER = SDL_CreateThread(writer_thread, "capture", nullptr);
+    if (!CAPTURE->FREE_SLOTS || !CAPTURE->QUEUED_FRAMES || !CAPTURE->WRITER) {
+        fprintf(stderr, "Error starting capture: %s\n", SDL_GetError());
+        exit(1);
+    }
+}
+
+/*
+ * Stops the writer thread once every queued frame has been written and closes
+ * the output, must be called after the emulation thread has finished
+ */
+void capture_finish() {
+    if (!CAPTURE->WRITER) {
+        return;
+    }
+    //one extra signal with nothing queued tells the writer to stop
+    SDL_SignalSemaphore(CAPTURE->QUEUED_FRAMES);
+    SDL_WaitThread(CAPTURE->WRITER, nullptr);
+    CAPTURE->WRITER = nullptr;
+    fclose(CAPTURE->OUTPUT);
+}
+
+void capture_free() {
+    if (!CAPTURE) {
+        return;
+    }
+    capture_finish();
+    SDL_DestroySemaphore(CAPTURE->FREE_SLOTS);
+    SDL_DestroySemaphore(CAPTURE->QUEUED_FRAMES);
+    free(CAPTURE);
+    CAPTURE = nullptr;
+}
+
+/*
+ * Emulation thread side, copies the finished FRAME into the ring. Skipped
+ * frames are pushed as well so the capture keeps a constant frame rate.
+ */
+void capture_push(const INDEXED_FRAME* frame) {
+    CAPTURE->FRAMES_CAPTURED++;
+    if (!SDL_TryWaitSemaphore(CAPTURE->FREE_SLOTS)) {
+        if (CAPTURE->BACKPRESSURE == CAPTURE_DROP) {
+            CAPTURE->FRAMES_DROPPED++;
+            return;
+        }
+        uint64_t block_start = SDL_GetTicksNS();
+        SDL_WaitSemaphore(CAPTURE->FREE_SLOTS);
+        CAPTURE->BLOCKS++;
+        CAPTURE->BLOCKED_NS += SDL_GetTicksNS() - block_start;
+    }
+    INDEXED_FRAME* slot = &CAPTURE->RING[CAPTURE->HEAD % CAPTURE_RING_SIZE];
+    memcpy(slot->PIXELS, frame->PIXELS, sizeof(frame->PIXELS));
+    slot->FRAME_NUMBER = frame->FRAME_NUMBER;
+    CAPTURE->HEAD++;
+    SDL_SignalSemaphore(CAPTURE->QUEUED_FRAMES);
+}
+
+/*
+ * Converts FRAME to BT.601 studio range YUV planes following the frame header
+ */
+static void encode_y4m(INDEXED_FRAME* frame, uint8_t* out, uint32_t (*rgba)[WINDOW_WIDTH]) {
+    memcpy(out, Y4M_FRAME_HEADER, Y4M_FRAME_HEADER_SIZE);
+    uint8_t* y_plane = out + Y4M_FRAME_HEADER_SIZE;
+    uint8_t* u_plane = y_plane + PLANE_SIZE;
+    uint8_t* v_plane = u_plane + PLANE_SIZE;
+
+    frame_mark_all_dirty(frame);
+    frame_to_rgba(frame, rgba);
+    for (uint32_t i = 0; i < PLANE_SIZE; i++) {
+        uint32_t pixel = rgba[i / WINDOW_WIDTH][i % WINDOW_WIDTH];
+        int32_t r = (pixel >> 24) & 0xFF;
+        int32_t g = (pixel >> 16) & 0xFF;
+        int32_t b = (pixel >> 8) & 0xFF;
+        y_plane[i] = (uint8_t) (((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        u_plane[i] = (uint8_t) (((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+        v_plane[i] = (uint8_t) (((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+}
+
+/*
+ * Writer thread, encodes queued frames until capture_free() is called and the ring is empty
+ */
+static int writer_thread(void* UNUSED) {
+    (void)UNUSED;
+    uint8_t* out = malloc(Y4M_FRAME_HEADER_SIZE + 3 * PLANE_SIZE);
+    uint32_t (*rgba)[WINDOW_WIDTH] = calloc(WINDOW_HEIGHT, sizeof(*rgba));
+    while (true) {
+        SDL_WaitSemaphore(CAPTURE->QUEUED_FRAMES);
+        if (CAPTURE->TAIL == CAPTURE->HEAD) {
+            //woken up by capture_free() with nothing left to write
+            break;
+        }
+        INDEXED_FRAME* frame = &CAPTURE->RING[CAPTURE->TAIL % CAPTURE_RING_SIZE];
+        //after a write error frames are still consumed so a blocking producer never hangs
+        if (!CAPTURE->WRITE_FAILED) {
+            size_t size;
+            const void* data;
+            if (CAPTURE->FORMAT == CAPTURE_Y4M) {
+                encode_y4m(frame, out, rgba);
+                data = out;
+                size = Y4M_FRAME_HEADER_SIZE + 3 * PLANE_SIZE;
+            }
+            else {
+                data = frame->PIXELS;
+                size = sizeof(frame->PIXELS);
+            }
+            bool ok = fwrite(data, 1, size, CAPTURE->OUTPUT) == size;
+            if (ok) {
+                CAPTURE->FRAMES_WRITTEN++;
+            }
+            else {
+                perror("Error writing capture");
+                CAPTURE->WRITE_FAILED = true;
+            }
+        }
+        CAPTURE->TAIL++;
+        SDL_SignalSemaphore(CAPTURE->FREE_SLOTS);
+    }
+    fflush(CAPTURE->OUTPUT);
+    free(rgba);
+    free(out);
+    return 0;
+}
+
+void capture_print_stats() {
+    printf("Capture frames: %llu, written: %llu, dropped: %llu\n",
+           (unsigned long long) CAPTURE->FRAMES_CAPTURED, (unsigned long long) CAPTURE->FRAMES_WRITTEN,
+           (unsigned long long) CAPTURE->FRAMES_DROPPED);
+    printf("Capture blocks: %llu (%.3f ms)\n",
+           (unsigned long long) CAPTURE->BLOCKS, (double) CAPTURE->BLOCKED_NS / 1e6);
+}
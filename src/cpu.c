@@ -1,10 +1,15 @@
 #include <common.h>
+#include <SDL3/SDL.h>
 #include <gb.h>
 #include <memory.h>
 #include <decode.h>
 #include <queue.h>
 #include <ppu.h>
 #include <cpu.h>
+#include <profiler.h>
+#include <trace.h>
+#include <watch.h>
+#include <timeline.h>
 
 #define ZERO_FLAG(f) (f & 0x80)
 #define SUBTRACTION_FLAG(f) (f & 0x40)
@@ -30,7 +35,6 @@
 static bool check_interrupts();
 
 void cpu_init() {
-    CPU = (CPU_STRUCT*) malloc(sizeof(CPU_STRUCT));
     write_16bit_reg(AF, 0x01B0);
     write_16bit_reg(BC, 0x0013);
     write_16bit_reg(DE, 0x00D8);
@@ -40,6 +44,9 @@ void cpu_init() {
     CPU->STATE = RUNNING;
     CPU->IME = false;
     CPU->DMA_CYCLE = 0;
+    CPU->INSTRUCTION_PC = 0x0100;
+    CPU->BUTTONS = 0xFF;
+    CPU->D_PAD = 0xFF;
     CYCLE_COUNT = 0;
 }
 
@@ -52,11 +59,14 @@ void cpu_init() {
 void execute_next_CPU_cycle() {
     if (is_empty(INSTR_QUEUE)) {
         if (!check_interrupts() && CPU->STATE == RUNNING) {
-            if (read_16bit_reg(PC) == 0xc302) {
-                0+0;
-            }
             //fetch
+            CPU->INSTRUCTION_PC = read_16bit_reg(PC);
             read_next_byte();
+            if (WATCH_PAGES[CPU->ADDRESS_BUS >> 8] & WATCH_EXECUTE) {
+                watch_hit(WATCH_EXECUTE, CPU->ADDRESS_BUS, CPU->DATA_BUS);
+            }
+            PROFILE_INSTRUCTION(CPU->ADDRESS_BUS, CPU->DATA_BUS);
+            TRACE_INSTRUCTION();
             decode();
         }
     }
@@ -67,6 +77,8 @@ void execute_next_CPU_cycle() {
     if (CPU->STATE == OAM_DMA_TRANSFER) {
         OAM_DMA();
     }
+    PROFILE_CPU_CYCLE(CPU->STATE == HALTED);
+    TIMELINE_CPU_CYCLE(CPU->STATE == HALTED);
     CYCLE_COUNT++;
 }
 
@@ -110,6 +122,8 @@ static bool check_interrupts() {
         CPU->DATA_BUS = JOYPAD_VEC;
         MEMORY[IF] = CLEAR_BIT(JOYPAD_BIT, interrupt_flag);
     }
+    PROFILE_INTERRUPT(CPU->DATA_BUS);
+    TIMELINE_INTERRUPT(CPU->DATA_BUS);
     instr_queue_push(nop, UNUSED_VAL);
     instr_queue_push(rst, 2);
     instr_queue_push(rst, 3);
@@ -139,7 +153,7 @@ void write_16bit_reg(uint8_t reg_pair, uint16_t value) {
  */
 void read_next_byte() {
     CPU->ADDRESS_BUS = read_16bit_reg(PC);
-    read_memory(UNUSED_VAL);
+    fetch_memory();
     write_16bit_reg(PC, read_16bit_reg(PC) + 1);
 }
 
@@ -978,6 +992,7 @@ void call_writes(uint8_t cycle_num) {
         CPU->DATA_BUS = CPU->REGS[PC0];
         write_memory(UNUSED_VAL);
         write_16bit_reg(PC, read_16bit_reg(WZ));
+        PROFILE_CALL();
     }
 }
 
@@ -1070,6 +1085,7 @@ void ret(uint8_t cycle) {
             break;
         case 2:
             write_16bit_reg(PC, read_16bit_reg(WZ));
+            PROFILE_RETURN();
             break;
         default:
             perror("Invalid cycle number passed into ret");
@@ -1098,6 +1114,7 @@ void reti(uint8_t cycle) {
         case 4:
             write_16bit_reg(PC, read_16bit_reg(WZ));
             CPU->IME = 1;
+            PROFILE_RETURN();
             break;
         default:
             perror("Invalid cycle number passed into reti");
@@ -1127,6 +1144,7 @@ void rst(uint8_t cycle) {
             write_memory(UNUSED_VAL);
             CPU->REGS[PC0] = CPU->REGS[Z];
             CPU->REGS[PC1] = 0x00;
+            PROFILE_CALL();
             return;
         default:
             perror("Invalid cycle number passed into rst");
@@ -0,0 +1,378 @@
+#include <common.h>
+#include <SDL3/SDL.h>
+#include <cpu.h>
+#include <queue.h>
+#include <memory.h>
+#include <gb.h>
+
+#define ROM_SIZE 0x8000
+#define COPIES 512              //instructions laid out back to back per pass
+#define CODE_START 0xC000
+#define DATA_ADDRESS 0xD400     //target of (HL), (BC), (DE) and (n16) operands
+#define STACK_TOP 0xDFFE
+#define HRAM_OFFSET 0x80        //LDH operand and C register, points into HRAM
+#define DEFAULT_ITERATIONS 1000000
+#define CB_PREFIX 0xCB
+#define RET_OPCODE 0xC9
+#define ZERO_BIT 0x80
+#define CARRY_BIT 0x10
+
+/*
+ * Per-opcode micro-benchmark for the SM83 core. Every opcode is laid out COPIES
+ * times in WRAM with operands that keep control flow falling through to the next
+ * copy, then run through a CPU core for millions of instructions.
+ * Conditional branches are measured with the condition both taken and not taken.
+ */
+
+typedef struct CPU_CORE {
+    const char* NAME;
+    void (*STEP)();     //runs one M-cycle
+} CPU_CORE;
+
+static const CPU_CORE CORES[] = {
+    {"fifo", execute_next_CPU_cycle},
+};
+
+enum BRANCH_VARIANT {
+    BRANCH_NONE,
+    BRANCH_TAKEN,
+    BRANCH_UNTAKEN
+};
+
+typedef struct BENCH_RESULT {
+    uint16_t OPCODE;            //0x100 and up are CB prefixed
+    enum BRANCH_VARIANT VARIANT;
+    double CYCLES_PER_INSTR;
+    double NS_PER_INSTR;
+    double NS_PER_CYCLE;
+} BENCH_RESULT;
+
+//instruction length in bytes as decoded by this core, 0 marks opcodes that don't exist
+//STOP is 1: the core fetches no operand, so the next copy starts right after it
+static const uint8_t OPCODE_LENGTHS[256] = {
+    1, 3, 1, 1, 1, 1, 2, 1, 3, 1, 1, 1, 1, 1, 2, 1,
+    1, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 3, 3, 3, 1, 2, 1, 1, 1, 3, 2, 3, 3, 2, 1,
+    1, 1, 3, 0, 3, 1, 2, 1, 1, 1, 3, 0, 3, 0, 2, 1,
+    2, 1, 1, 0, 0, 1, 2, 1, 2, 1, 3, 0, 0, 0, 2, 1,
+    2, 1, 1, 1, 0, 1, 2, 1, 2, 1, 3, 1, 0, 0, 2, 1
+};
+
+static const char* MNEMONICS[256] = {
+    "NOP", "LD BC,n16", "LD [BC],A", "INC BC", "INC B", "DEC B", "LD B,n8", "RLCA",
+    "LD [n16],SP", "ADD HL,BC", "LD A,[BC]", "DEC BC", "INC C", "DEC C", "LD C,n8", "RRCA",
+    "STOP", "LD DE,n16", "LD [DE],A", "INC DE", "INC D", "DEC D", "LD D,n8", "RLA",
+    "JR e8", "ADD HL,DE", "LD A,[DE]", "DEC DE", "INC E", "DEC E", "LD E,n8", "RRA",
+    "JR NZ,e8", "LD HL,n16", "LD [HL+],A", "INC HL", "INC H", "DEC H", "LD H,n8", "DAA",
+    "JR Z,e8", "ADD HL,HL", "LD A,[HL+]", "DEC HL", "INC L", "DEC L", "LD L,n8", "CPL",
+    "JR NC,e8", "LD SP,n16", "LD [HL-],A", "INC SP", "INC [HL]", "DEC [HL]", "LD [HL],n8", "SCF",
+    "JR C,e8", "ADD HL,SP", "LD A,[HL-]", "DEC SP", "INC A", "DEC A", "LD A,n8", "CCF",
+    "LD B,B", "LD B,C", "LD B,D", "LD B,E", "LD B,H", "LD B,L", "LD B,[HL]", "LD B,A",
+    "LD C,B", "LD C,C", "LD C,D", "LD C,E", "LD C,H", "LD C,L", "LD C,[HL]", "LD C,A",
+    "LD D,B", "LD D,C", "LD D,D", "LD D,E", "LD D,H", "LD D,L", "LD D,[HL]", "LD D,A",
+    "LD E,B", "LD E,C", "LD E,D", "LD E,E", "LD E,H", "LD E,L", "LD E,[HL]", "LD E,A",
+    "LD H,B", "LD H,C", "LD H,D", "LD H,E", "LD H,H", "LD H,L", "LD H,[HL]", "LD H,A",
+    "LD L,B", "LD L,C", "LD L,D", "LD L,E", "LD L,H", "LD L,L", "LD L,[HL]", "LD L,A",
+    "LD [HL],B", "LD [HL],C", "LD [HL],D", "LD [HL],E", "LD [HL],H", "LD [HL],L", "HALT", "LD [HL],A",
+    "LD A,B", "LD A,C", "LD A,D", "LD A,E", "LD A,H", "LD A,L", "LD A,[HL]", "LD A,A",
+    "ADD A,B", "ADD A,C", "ADD A,D", "ADD A,E", "ADD A,H", "ADD A,L", "ADD A,[HL]", "ADD A,A",
+    "ADC A,B", "ADC A,C", "ADC A,D", "ADC A,E", "ADC A,H", "ADC A,L", "ADC A,[HL]", "ADC A,A",
+    "SUB A,B", "SUB A,C", "SUB A,D", "SUB A,E", "SUB A,H", "SUB A,L", "SUB A,[HL]", "SUB A,A",
+    "SBC A,B", "SBC A,C", "SBC A,D", "SBC A,E", "SBC A,H", "SBC A,L", "SBC A,[HL]", "SBC A,A",
+    "AND A,B", "AND A,C", "AND A,D", "AND A,E", "AND A,H", "AND A,L", "AND A,[HL]", "AND A,A",
+    "XOR A,B", "XOR A,C", "XOR A,D", "XOR A,E", "XOR A,H", "XOR A,L", "XOR A,[HL]", "XOR A,A",
+    "OR A,B", "OR A,C", "OR A,D", "OR A,E", "OR A,H", "OR A,L", "OR A,[HL]", "OR A,A",
+    "CP A,B", "CP A,C", "CP A,D", "CP A,E", "CP A,H", "CP A,L", "CP A,[HL]", "CP A,A",
+    "RET NZ", "POP BC", "JP NZ,n16", "JP n16", "CALL NZ,n16", "PUSH BC", "ADD A,n8", "RST $00",
+    "RET Z", "RET", "JP Z,n16", "PREFIX", "CALL Z,n16", "CALL n16", "ADC A,n8", "RST $08",
+    "RET NC", "POP DE", "JP NC,n16", "-", "CALL NC,n16", "PUSH DE", "SUB A,n8", "RST $10",
+    "RET C", "RETI", "JP C,n16", "-", "CALL C,n16", "-", "SBC A,n8", "RST $18",
+    "LDH [n8],A", "POP HL", "LDH [C],A", "-", "-", "PUSH HL", "AND A,n8", "RST $20",
+    "ADD SP,e8", "JP HL", "LD [n16],A", "-", "-", "-", "XOR A,n8", "RST $28",
+    "LDH A,[n8]", "POP AF", "LDH A,[C]", "DI", "-", "PUSH AF", "OR A,n8", "RST $30",
+    "LD HL,SP+e8", "LD SP,HL", "LD A,[n16]", "EI", "-", "-", "CP A,n8", "RST $38"
+};
+
+static const char* CB_OPS[] = {"RLC", "RRC", "RL", "RR", "SLA", "SRA", "SWAP", "SRL"};
+static const char* CB_REGS[] = {"B", "C", "D", "E", "H", "L", "[HL]", "A"};
+
+static bool is_conditional(uint8_t opcode) {
+    switch (opcode) {
+        case 0x20: case 0x28: case 0x30: case 0x38:
+        case 0xC0: case 0xC8: case 0xD0: case 0xD8:
+        case 0xC2: case 0xCA: case 0xD2: case 0xDA:
+        case 0xC4: case 0xCC: case 0xD4: case 0xDC:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool is_return(uint8_t opcode) {
+    return opcode == 0xC9 || opcode == 0xD9 || (opcode & 0xE7) == 0xC0;
+}
+
+static bool is_rst(uint8_t opcode) {
+    return (opcode & 0xC7) == 0xC7;
+}
+
+/*
+ * Flags that make the condition of OPCODE true or false
+ */
+static uint8_t branch_flags(uint8_t opcode, bool taken) {
+    switch ((opcode >> 3) & 0x03) {
+        case 0: //NZ
+            return taken ? 0 : ZERO_BIT;
+        case 1: //Z
+            return taken ? ZERO_BIT : 0;
+        case 2: //NC
+            return taken ? 0 : CARRY_BIT;
+        default: //C
+            return taken ? CARRY_BIT : 0;
+    }
+}
+
+/*
+ * Writes COPIES instances of OPCODE into WRAM, jumps and calls target the next copy
+ */
+static void layout_code(uint16_t opcode) {
+    bool cb = opcode > 0xFF;
+    uint8_t length = cb ? 2 : OPCODE_LENGTHS[opcode];
+    for (uint16_t i = 0; i < COPIES; i++) {
+        uint16_t address = CODE_START + i * length;
+        uint16_t next = address + length;
+        if (cb) {
+            MEMORY[address] = CB_PREFIX;
+            MEMORY[address + 1] = (uint8_t) opcode;
+            continue;
+        }
+        MEMORY[address] = (uint8_t) opcode;
+        bool relative_jump = opcode == 0x18 || (opcode & 0xE7) == 0x20;
+        if (length == 2) {
+            MEMORY[address + 1] = relative_jump ? 0x00 : HRAM_OFFSET;
+        }
+        else if (length == 3) {
+            //only jumps and calls use the operand as a code address
+            bool jump_or_call = (opcode & 0xE7) == 0xC2 || (opcode & 0xE7) == 0xC4 || opcode == 0xC3 || opcode == 0xCD;
+            uint16_t operand = jump_or_call ? next : DATA_ADDRESS;
+            MEMORY[address + 1] = (uint8_t) operand;
+            MEMORY[address + 2] = (uint8_t) (operand >> 8);
+        }
+    }
+}
+
+/*
+ * Puts the CPU back at the first copy with the same registers for every pass
+ */
+static void reset_state(uint16_t opcode, enum BRANCH_VARIANT variant) {
+    uint8_t base_opcode = (uint8_t) opcode;
+    bool cb = opcode > 0xFF;
+    write_16bit_reg(AF, 0x1200);
+    write_16bit_reg(BC, DATA_ADDRESS + HRAM_OFFSET);
+    write_16bit_reg(DE, DATA_ADDRESS + 0x100);
+    write_16bit_reg(HL, DATA_ADDRESS);
+    write_16bit_reg(PC, CODE_START);
+    write_16bit_reg(SP, STACK_TOP);
+    if (variant != BRANCH_NONE) {
+        CPU->REGS[F] = branch_flags(base_opcode, variant == BRANCH_TAKEN);
+    }
+    if (!cb && base_opcode == 0xE9) {
+        //JP HL loops on the first copy
+        write_16bit_reg(HL, CODE_START);
+    }
+    if (!cb && (is_return(base_opcode) || (base_opcode & 0xCF) == 0xC1)) {
+        //returns and pops take the address of the next copy off the stack
+        uint16_t sp = STACK_TOP - 2 * COPIES;
+        write_16bit_reg(SP, sp);
+        for (uint16_t i = 0; i < COPIES; i++) {
+            uint16_t next = CODE_START + (i + 1) * OPCODE_LENGTHS[base_opcode];
+            MEMORY[sp + 2 * i] = (uint8_t) next;
+            MEMORY[sp + 2 * i + 1] = (uint8_t) (next >> 8);
+        }
+    }
+    //HALT and STOP only fall through when an interrupt is pending with IME off
+    bool halts = !cb && (base_opcode == 0x76 || base_opcode == 0x10);
+    MEMORY[IE] = halts ? 0x01 : 0x00;
+    MEMORY[IF] = halts ? 0x01 : 0x00;
+    CPU->IME = false;
+    CPU->STATE = RUNNING;
+}
+
+/*
+ * Steps CORE until INSTRUCTIONS instructions have completed, returns the M-cycles taken
+ */
+static uint64_t run_pass(const CPU_CORE* core, uint32_t instructions) {
+    uint32_t started = 0;
+    uint64_t cycles = 0;
+    while (true) {
+        //an empty queue means the next M-cycle fetches a new instruction
+        if (is_empty(INSTR_QUEUE)) {
+            if (started == instructions) {
+                break;
+            }
+            started++;
+        }
+        core->STEP();
+        cycles++;
+    }
+    return cycles;
+}
+
+static BENCH_RESULT bench_opcode(const CPU_CORE* core, uint16_t opcode, enum BRANCH_VARIANT variant, uint64_t iterations) {
+    layout_code(opcode);
+    //RST runs the RET placed at its vector as well
+    uint32_t instructions = COPIES * (opcode <= 0xFF && is_rst((uint8_t) opcode) ? 2 : 1);
+    uint64_t passes = (iterations + COPIES - 1) / COPIES;
+    uint64_t cycles = 0;
+    uint64_t elapsed_ns = 0;
+    for (uint64_t pass = 0; pass < passes; pass++) {
+        reset_state(opcode, variant);
+        uint64_t start = SDL_GetTicksNS();
+        cycles += run_pass(core, instructions);
+        elapsed_ns += SDL_GetTicksNS() - start;
+    }
+    double total_instructions = (double) passes * COPIES;
+    BENCH_RESULT result = {
+        .OPCODE = opcode,
+        .VARIANT = variant,
+        .CYCLES_PER_INSTR = cycles / total_instructions,
+        .NS_PER_INSTR = elapsed_ns / total_instructions,
+        .NS_PER_CYCLE = cycles ? (double) elapsed_ns / cycles : 0.0
+    };
+    return result;
+}
+
+static void opcode_name(uint16_t opcode, char* name, size_t size) {
+    if (opcode > 0xFF) {
+        uint8_t cb = (uint8_t) opcode;
+        uint8_t group = cb >> 6;
+        if (group == 0) {
+            snprintf(name, size, "%s %s", CB_OPS[(cb >> 3) & 0x07], CB_REGS[cb & 0x07]);
+        }
+        else {
+            static const char* BIT_OPS[] = {"", "BIT", "RES", "SET"};
+            snprintf(name, size, "%s %d,%s", BIT_OPS[group], (cb >> 3) & 0x07, CB_REGS[cb & 0x07]);
+        }
+    }
+    else {
+        snprintf(name, size, "%s%s", MNEMONICS[opcode], is_rst((uint8_t) opcode) ? " (+RET)" : "");
+    }
+}
+
+static int compare_ns(const void* a, const void* b) {
+    double difference = ((const BENCH_RESULT*) b)->NS_PER_INSTR - ((const BENCH_RESULT*) a)->NS_PER_INSTR;
+    return (difference > 0) - (difference < 0);
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr, "Usage: %s [options]\n", program);
+    fprintf(stderr, "  --iterations <N>   instructions to run per opcode (default %d)\n", DEFAULT_ITERATIONS);
+    fprintf(stderr, "  --opcode <XX>      only run one opcode, CB prefixed opcodes are CBXX\n");
+    fprintf(stderr, "  --core <name>      CPU core to run (default %s)\n", CORES[0].NAME);
+    fprintf(stderr, "  --sort             sort by ns per instruction, slowest first\n");
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t iterations = DEFAULT_ITERATIONS;
+    int32_t only_opcode = -1;
+    const CPU_CORE* core = &CORES[0];
+    bool sort = false;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--iterations") && i + 1 < argc) {
+            iterations = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--opcode") && i + 1 < argc) {
+            only_opcode = (int32_t) strtol(argv[++i], nullptr, 16);
+            if (only_opcode > 0xCBFF || (only_opcode > 0xFF && only_opcode < 0xCB00)) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            if (only_opcode > 0xFF) {
+                only_opcode = 0x100 | (only_opcode & 0xFF);
+            }
+        }
+        else if (!strcmp(argv[i], "--core") && i + 1 < argc) {
+            const char* name = argv[++i];
+            core = nullptr;
+            for (size_t c = 0; c < sizeof(CORES) / sizeof(CORES[0]); c++) {
+                if (!strcmp(CORES[c].NAME, name)) {
+                    core = &CORES[c];
+                }
+            }
+            if (!core) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--sort")) {
+            sort = true;
+        }
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    //synthetic cartridge, the RST vectors return straight away
+    uint8_t* rom = calloc(ROM_SIZE, sizeof(uint8_t));
+    for (uint16_t vector = 0; vector <= 0x38; vector += 8) {
+        rom[vector] = RET_OPCODE;
+    }
+    gb_init_rom(rom, ROM_SIZE);
+    free(rom);
+
+    //every opcode plus a second run for the untaken side of conditional branches
+    BENCH_RESULT* results = calloc(512 + 16, sizeof(BENCH_RESULT));
+    uint32_t num_results = 0;
+    for (uint16_t opcode = 0; opcode < 512; opcode++) {
+        bool cb = opcode > 0xFF;
+        if (only_opcode >= 0 && opcode != only_opcode) {
+            continue;
+        }
+        if (!cb && (!OPCODE_LENGTHS[opcode] || opcode == CB_PREFIX)) {
+            continue;
+        }
+        if (!cb && is_conditional((uint8_t) opcode)) {
+            results[num_results++] = bench_opcode(core, opcode, BRANCH_TAKEN, iterations);
+            results[num_results++] = bench_opcode(core, opcode, BRANCH_UNTAKEN, iterations);
+        }
+        else {
+            results[num_results++] = bench_opcode(core, opcode, BRANCH_NONE, iterations);
+        }
+    }
+    if (sort) {
+        qsort(results, num_results, sizeof(BENCH_RESULT), compare_ns);
+    }
+
+    static const char* VARIANT_NAMES[] = {"", "taken", "untaken"};
+    printf("core: %s, %llu instructions per opcode\n", core->NAME, (unsigned long long) iterations);
+    printf("%-6s %-20s %-8s %8s %10s %12s\n", "OPCODE", "INSTRUCTION", "BRANCH", "M-CYCLES", "NS/INSTR", "NS/M-CYCLE");
+    for (uint32_t i = 0; i < num_results; i++) {
+        const BENCH_RESULT* result = &results[i];
+        char name[32];
+        char code[8];
+        opcode_name(result->OPCODE, name, sizeof(name));
+        if (result->OPCODE > 0xFF) {
+            snprintf(code, sizeof(code), "CB%02X", result->OPCODE & 0xFF);
+        }
+        else {
+            snprintf(code, sizeof(code), "%02X", result->OPCODE);
+        }
+        printf("%-6s %-20s %-8s %8.2f %10.2f %12.2f\n", code, name, VARIANT_NAMES[result->VARIANT],
+               result->CYCLES_PER_INSTR, result->NS_PER_INSTR, result->NS_PER_CYCLE);
+    }
+
+    free(results);
+    free_resources();
+    return 0;
+}
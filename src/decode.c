@@ -3,6 +3,7 @@
 #include <queue.h>
 #include <memory.h>
 #include <decode.h>
+#include <profiler.h>
 
 #define PREFIX 0xCB
 #define GET_FIRST_OCTAL_DIGIT(byte) ((byte & 0xC0) >> 6)
@@ -558,6 +559,7 @@ static void rst_instr(uint8_t opcode) {
 static void cb_prefixed_ops(uint8_t opcode) {
     read_next_byte();
     opcode = CPU->DATA_BUS;
+    PROFILE_CB_OPCODE(opcode);
     uint8_t first_octal_dig = GET_FIRST_OCTAL_DIGIT(opcode);
     uint8_t second_octal_dig = GET_SECOND_OCTAL_DIGIT(opcode);
     uint8_t bit_num = second_octal_dig;
@@ -0,0 +1,154 @@
+#include <common.h>
+#include <memory.h>
+#include <framebuffer.h>
+
+#define MAX_AUTO_SKIP 4
+#define HASH_SEED 0x9E3779B97F4A7C15ULL
+#define HASH_MULTIPLIER 0xFF51AFD7ED558CCDULL
+#define PIXELS_PER_HASH_WORD 32
+
+static const uint32_t COLORS_RGB[4] = {
+        0xFFFFFFFF, // White
+        0xAAAAAAFF, // Light Gray
+        0x555555FF, // Dark Gray
+        0x000000FF  // Black
+};
+
+void framebuffer_init() {
+    FRAMEBUFFER->STATUS = FRAME_RENDERED;
+    FRAMEBUFFER->SKIP_MODE = FRAME_SKIP_OFF;
+    //nothing has been displayed yet
+    frame_mark_all_dirty(&FRAMEBUFFER->FRAME);
+}
+
+static void mark_line_dirty(INDEXED_FRAME* frame, uint8_t line) {
+    uint64_t bit = 1ULL << (line % 64);
+    if (!(frame->DIRTY_LINES[line / 64] & bit)) {
+        frame->DIRTY_LINES[line / 64] |= bit;
+        frame->NUM_DIRTY_LINES++;
+    }
+}
+
+/*
+ * Called once line LY is fully drawn, copies it into the frame if it changed
+ */
+void framebuffer_commit_line() {
+    INDEXED_FRAME* frame = &FRAMEBUFFER->FRAME;
+    uint8_t line = MEMORY[LY];
+    if (memcmp(frame->PIXELS[line], FRAMEBUFFER->LINE, WINDOW_WIDTH) != 0) {
+        memcpy(frame->PIXELS[line], FRAMEBUFFER->LINE, WINDOW_WIDTH);
+        mark_line_dirty(frame, line);
+    }
+}
+
+/*
+ * Returns whether any line differs from the last rendered frame
+ */
+bool framebuffer_frame_dirty() {
+    return FRAMEBUFFER->FRAME.NUM_DIRTY_LINES != 0;
+}
+
+bool frame_line_dirty(const INDEXED_FRAME* frame, uint8_t line) {
+    return frame->DIRTY_LINES[line / 64] & (1ULL << (line % 64));
+}
+
+void frame_mark_all_dirty(INDEXED_FRAME* frame) {
+    for (uint8_t line = 0; line < WINDOW_HEIGHT; line++) {
+        mark_line_dirty(frame, line);
+    }
+}
+
+/*
+ * Adds the damage of an OLDER frame that was never displayed to FRAME
+ */
+void frame_merge_damage(INDEXED_FRAME* frame, const INDEXED_FRAME* older) {
+    for (uint8_t line = 0; line < WINDOW_HEIGHT; line++) {
+        if (frame_line_dirty(older, line)) {
+            mark_line_dirty(frame, line);
+        }
+    }
+}
+
+/*
+ * Converts the dirty lines of FRAME into RGBA
+ */
+void frame_to_rgba(const INDEXED_FRAME* frame, uint32_t (*rgba)[WINDOW_WIDTH]) {
+    for (uint8_t y = 0; y < WINDOW_HEIGHT; y++) {
+        if (!frame_line_dirty(frame, y)) {
+            continue;
+        }
+        const uint8_t* pixels = frame->PIXELS[y];
+        for (uint8_t x = 0; x < WINDOW_WIDTH; x++) {
+            rgba[y][x] = COLORS_RGB[pixels[x] & 0x03];
+        }
+    }
+}
+
+/*
+ * 64-bit hash of the picture FRAME shows. Pixels are reduced to their final shade
+ * and packed 2 bits each into words, so any renderer drawing the same image gets
+ * the same hash on any host.
+ */
+uint64_t frame_hash(const INDEXED_FRAME* frame) {
+    uint64_t hash = HASH_SEED;
+    for (uint8_t y = 0; y < WINDOW_HEIGHT; y++) {
+        const uint8_t* pixels = frame->PIXELS[y];
+        for (uint8_t x = 0; x < WINDOW_WIDTH; x += PIXELS_PER_HASH_WORD) {
+            uint64_t word = 0;
+            for (uint8_t i = 0; i < PIXELS_PER_HASH_WORD; i++) {
+                word |= (uint64_t) (pixels[x + i] & 0x03) << (i * 2);
+            }
+            hash = (hash ^ word) * HASH_MULTIPLIER;
+            hash ^= hash >> 31;
+        }
+    }
+    //murmur3 finalizer
+    hash ^= hash >> 33;
+    hash *= HASH_MULTIPLIER;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+void framebuffer_set_frame_skip(enum FRAME_SKIP_MODE mode, uint8_t interval) {
+    FRAMEBUFFER->SKIP_MODE = mode;
+    FRAMEBUFFER->SKIP_INTERVAL = interval;
+    FRAMEBUFFER->SKIPPED_IN_ROW = 0;
+    FRAMEBUFFER->LAG_MS = 0;
+}
+
+/*
+ * Called between frames with the host time WORK_MS spent on the frame that just
+ * finished, decides whether the next frame is rendered or skipped
+ */
+enum FRAME_STATUS framebuffer_next_frame(double work_ms, double budget_ms) {
+    bool skip;
+    switch (FRAMEBUFFER->SKIP_MODE) {
+        case FRAME_SKIP_FIXED:
+            skip = FRAMEBUFFER->SKIPPED_IN_ROW < FRAMEBUFFER->SKIP_INTERVAL;
+            break;
+        case FRAME_SKIP_AUTO:
+            //accumulate how far behind the budget the host is, skipped frames pay it back
+            FRAMEBUFFER->LAG_MS += work_ms - budget_ms;
+            if (FRAMEBUFFER->LAG_MS < 0) {
+                FRAMEBUFFER->LAG_MS = 0;
+            }
+            else if (FRAMEBUFFER->LAG_MS > budget_ms * MAX_AUTO_SKIP) {
+                FRAMEBUFFER->LAG_MS = budget_ms * MAX_AUTO_SKIP;
+            }
+            skip = FRAMEBUFFER->LAG_MS > 0 && FRAMEBUFFER->SKIPPED_IN_ROW < MAX_AUTO_SKIP;
+            break;
+        case FRAME_SKIP_ALL:
+            skip = true;
+            break;
+        default:
+            skip = false;
+    }
+    FRAMEBUFFER->SKIPPED_IN_ROW = skip ? FRAMEBUFFER->SKIPPED_IN_ROW + 1 : 0;
+    memset(FRAMEBUFFER->FRAME.DIRTY_LINES, 0, sizeof(FRAMEBUFFER->FRAME.DIRTY_LINES));
+    FRAMEBUFFER->FRAME.NUM_DIRTY_LINES = 0;
+    FRAMEBUFFER->STATUS = skip ? FRAME_SKIPPED : FRAME_RENDERED;
+    FRAMEBUFFER->FRAME.FRAME_NUMBER++;
+    return FRAMEBUFFER->STATUS;
+}
@@ -1,89 +1,206 @@
 #include <common.h>
+#include <limits.h>
 #include <cpu.h>
 #include <ppu.h>
 #include <min_heap.h>
-#include <lcd.h>
 #include <queue.h>
 #include <memory.h>
+#include <framebuffer.h>
+#include <serial.h>
+#include <apu.h>
+#include <profiler.h>
+#include <timeline.h>
+#include <heatmap.h>
+#include <movie.h>
+#include <machine.h>
 #include <gb.h>
-#define ROM_BANK_SIZE 0x4000 //16KiB
-#define RAM_BANK_SIZE 0x2000 //8KiB
 #define TAC_ENABlE(tac) (tac & 0x04)
 #define TAC_CLOCK_SELECT(tac) (tac & 0x03)
 #define DIV_INCREMENT 256
-#define CLOCK_FREQ 4194304.0
-#define CYCLES_PER_FRAME 70224
-#define FRAME_TIME_MS    (1000.0 * CYCLES_PER_FRAME / CLOCK_FREQ) // ~16.74 ms
+#define CART_TYPE_ADDRESS 0x0147
+#define ROM_SIZE_ADDRESS 0x0148
+#define RAM_SIZE_ADDRESS 0x0149
 
-static void memory_init(const char* file_name);
 static void io_ports_init();
-static void check_sp();
 static void increment_timers();
 
 static uint16_t timer_internal_counter;
 static uint16_t div_internal_counter;
 static uint16_t cycles_to_increment_timer;
+static uint8_t ppu_cycles;
 static bool refresh;
+static unsigned long long run_limit;
+static unsigned long long next_stop;   //earliest of run_limit and the serial transfer end
 
 
+/*
+ * Frees the emulator core
+ */
 void free_resources() {
     printf("Freeing resources\n");
-    free(CPU);
-    free(MEMORY);
     free(CARTRIDGE->ROM);
     if (CARTRIDGE->RAM) {
         free(CARTRIDGE->RAM);
     }
-    queue_free();
-    ppu_free();
-    heap_free();
-    lcd_free();
+    serial_free();
+    apu_free();
+    machine_free();
+    PROFILE_FREE();
+}
+
+/*
+ * Initializes every part of the emulator core from the ROM file FILE_NAME
+ */
+void gb_init(const char* file_name) {
+    FILE* gb_file =  fopen(file_name, "rb");
+    if (!gb_file) {
+        perror("Couldn't open .gb file");
+        exit(1);
+    }
+    fseek(gb_file, 0, SEEK_END);
+    long file_size = ftell(gb_file);
+    fseek(gb_file, 0, SEEK_SET);
+    if (file_size <= RAM_SIZE_ADDRESS) {
+        fprintf(stderr, "%s is too small to be a .gb file\n", file_name);
+        exit(1);
+    }
+    uint8_t* file = malloc(file_size);
+    fread(file, sizeof(uint8_t), file_size, gb_file);
+    fclose(gb_file);
+    gb_init_rom(file, file_size);
+    free(file);
 }
 
 /*
- * Main function loop
- * Initializes memory and CPU then continually executes instructions
+ * Initializes every part of the emulator core from a ROM image in memory,
+ * used directly by the benchmarks to run synthetic ROMs
  */
-int main(int argc, char* argv[]) {
-    memory_init(argv[1]);
+void gb_init_rom(const uint8_t* rom, uint32_t size) {
+    machine_init();
+    memory_init(rom, size);
+    PROFILE_INIT();
+    serial_init(false);
     heap_init();
     cpu_init();
+    apu_init();
     ppu_init();
     queue_init();
-    lcd_init();
-    uint8_t ppu_cycles = 0;
+    framebuffer_init();
+    ppu_cycles = 0;
     refresh = false;
-    while (LCD->is_running) {
-        uint64_t frame_start = SDL_GetPerformanceCounter();
+}
 
-        while (!refresh) {
-            execute_next_PPU_cycle();
-            ppu_cycles++;
-            if (ppu_cycles == 4) {
-                execute_next_CPU_cycle();
-                increment_timers();
-                check_sp();
-                ppu_cycles = 0;
+/*
+ * Runs the PPU dot by dot and the CPU every 4 dots until the PPU finishes a frame
+ */
+void run_frame() {
+    gb_run_until(ULLONG_MAX);
+}
+
+/*
+ * Runs until the PPU finishes a frame or CYCLE_COUNT reaches LIMIT, whichever
+ * comes first, and returns whether the frame was finished. Stops always fall
+ * between M-cycles so the instance can be resumed or swapped out there.
+ */
+bool gb_run_until(unsigned long long limit) {
+    run_limit = limit;
+    gb_reschedule();
+    while (!refresh) {
+        execute_next_PPU_cycle();
+        ppu_cycles++;
+        if (ppu_cycles == 4) {
+            execute_next_CPU_cycle();
+            increment_timers();
+            ppu_cycles = 0;
+            if (CYCLE_COUNT >= next_stop) {
+                if (CYCLE_COUNT >= SERIAL->TRANSFER_END && !SERIAL->LINKED) {
+                    serial_finish_transfer(SERIAL_DISCONNECTED);
+                }
+                if (CYCLE_COUNT >= run_limit) {
+                    return false;
+                }
+                next_stop = SERIAL->LINKED || SERIAL->TRANSFER_END > run_limit ? run_limit : SERIAL->TRANSFER_END;
             }
         }
-        process_events();
-        lcd_update_screen();
-        refresh = false;
+    }
+    refresh = false;
+    apu_end_frame();
+    if (MOVIE) {
+        movie_end_frame();
+    }
+    TIMELINE_FRAME();
+    HEATMAP_FRAME();
+    return true;
+}
 
-        //frame limiter
-        uint64_t frame_end = SDL_GetPerformanceCounter();
-        double elapsed_ms = (double)(frame_end - frame_start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+/*
+ * Makes gb_run_until() return after the current M-cycle
+ */
+void gb_end_slice() {
+    run_limit = 0;
+    next_stop = 0;
+}
 
-        if (elapsed_ms < FRAME_TIME_MS) {
-            SDL_Delay((uint32_t)(FRAME_TIME_MS - elapsed_ms));
-        }
-    }
-    free_resources();
+/*
+ * Makes the run loop recheck when it has to stop after the current M-cycle
+ */
+void gb_reschedule() {
+    next_stop = 0;
+}
+
+void gb_save_instance(GB_INSTANCE* instance) {
+    instance->MACHINE = MACHINE;
+    instance->CPU = CPU;
+    instance->PPU = PPU;
+    instance->MEMORY = MEMORY;
+    instance->CARTRIDGE = CARTRIDGE;
+    instance->SERIAL = SERIAL;
+    instance->APU = APU;
+    instance->INSTR_QUEUE = INSTR_QUEUE;
+    instance->OBJ_HEAP = OBJ_HEAP;
+    instance->FRAMEBUFFER = FRAMEBUFFER;
+    instance->MOVIE = MOVIE;
+#ifdef GB_PROFILE
+    instance->PROFILER = PROFILER;
+#endif
+    instance->CYCLE_COUNT = CYCLE_COUNT;
+    instance->TIMER_COUNTER = timer_internal_counter;
+    instance->DIV_COUNTER = div_internal_counter;
+    instance->TIMER_PERIOD = cycles_to_increment_timer;
+    instance->PPU_CYCLES = ppu_cycles;
+    instance->REFRESH = refresh;
+}
+
+void gb_load_instance(const GB_INSTANCE* instance) {
+    MACHINE = instance->MACHINE;
+    CPU = instance->CPU;
+    PPU = instance->PPU;
+    MEMORY = instance->MEMORY;
+    CARTRIDGE = instance->CARTRIDGE;
+    SERIAL = instance->SERIAL;
+    APU = instance->APU;
+    INSTR_QUEUE = instance->INSTR_QUEUE;
+    OBJ_HEAP = instance->OBJ_HEAP;
+    FRAMEBUFFER = instance->FRAMEBUFFER;
+    MOVIE = instance->MOVIE;
+#ifdef GB_PROFILE
+    PROFILER = instance->PROFILER;
+#endif
+    CYCLE_COUNT = instance->CYCLE_COUNT;
+    timer_internal_counter = instance->TIMER_COUNTER;
+    div_internal_counter = instance->DIV_COUNTER;
+    cycles_to_increment_timer = instance->TIMER_PERIOD;
+    ppu_cycles = instance->PPU_CYCLES;
+    refresh = instance->REFRESH;
 }
 
 void OAM_DMA() {
     uint16_t source_address = (MEMORY[DMA] << 8) | CPU->DMA_CYCLE;
+    TIMELINE_DMA(CPU->DMA_CYCLE);
     MEMORY[0xFE00 | CPU->DMA_CYCLE] = MEMORY[source_address];
+    PROFILE_DMA_CYCLE();
+    HEATMAP_ACCESS(HEAT_DMA, HEAT_READ, source_address);
+    HEATMAP_ACCESS(HEAT_DMA, HEAT_WRITE, 0xFE00 | CPU->DMA_CYCLE);
     if (CPU->DMA_CYCLE == 0xDF) {
         CPU->STATE = RUNNING;
     }
@@ -112,81 +229,92 @@ static void increment_timers() {
     }
 }
 
-static enum CARTRIDGES set_cartridge_type(FILE* gb_file) {
-    uint8_t header;
-    fseek(gb_file, 0x0147, SEEK_SET);
-    fread(&header, sizeof(uint8_t), 1, gb_file);
-    switch (header) {
-        case 0:
+static enum CARTRIDGES get_cartridge_type(const uint8_t* rom) {
+    switch (rom[CART_TYPE_ADDRESS]) {
+        case 0x00:
+        case 0x08:
+        case 0x09:
             return MBC0;
-            break;
-        case 1:
-        case 2:
-        case 3:
+        case 0x01:
+        case 0x02:
+        case 0x03:
             return MBC1;
-            break;
+        case 0x05:
+        case 0x06:
+            return MBC2;
+        case 0x0F:
+        case 0x10:
+        case 0x11:
+        case 0x12:
+        case 0x13:
+            return MBC3;
+        case 0x19:
+        case 0x1A:
+        case 0x1B:
+        case 0x1C:
+        case 0x1D:
+        case 0x1E:
+            return MBC5;
         default:
-            perror("Memory bank cartridge not supported");
-            exit(0);
+            fprintf(stderr, "Cartridge type 0x%02X not supported\n", rom[CART_TYPE_ADDRESS]);
+            exit(1);
     }
 }
 
-static uint32_t get_num_rom_banks(FILE* gb_file) {
-    uint8_t rom_header;
-    fread(&rom_header, sizeof(uint8_t), 1, gb_file);
-    fseek(gb_file, 0x0148, SEEK_SET);
-    return 2 * (1 << rom_header);
+/*
+ * MBC3 carts with a timer, the clock exists whether or not the cart has RAM
+ */
+static bool has_rtc(const uint8_t* rom) {
+    return rom[CART_TYPE_ADDRESS] == 0x0F || rom[CART_TYPE_ADDRESS] == 0x10;
+}
+
+static uint32_t get_num_rom_banks(const uint8_t* rom) {
+    return 2 * (1 << rom[ROM_SIZE_ADDRESS]);
 }
 
-static uint32_t get_ram_size(FILE* gb_file) {
-    uint8_t ram_header;
-    fread(&ram_header, sizeof(uint8_t), 1, gb_file);
-    fseek(gb_file, 0x0148, SEEK_SET);
-    switch (ram_header) {
+static uint32_t get_ram_size(const uint8_t* rom) {
+    if (get_cartridge_type(rom) == MBC2) {
+        return MBC2_RAM_SIZE;
+    }
+    switch (rom[RAM_SIZE_ADDRESS]) {
         case 2:
             return RAM_BANK_SIZE;
-            break;
         case 3:
             return RAM_BANK_SIZE * 4;
-            break;
         case 4:
             return RAM_BANK_SIZE * 16;
-            break;
         case 5:
             return RAM_BANK_SIZE * 8;
-            break;
         default:
             return 0;
-
     }
 }
+
 /*
- * Opens .gb file and reads it into memory
+ * Sets up the cartridge from the header of ROM and copies it into memory
  */
-static void memory_init(const char* file_name) {
-    FILE* gb_file =  fopen(file_name, "rb");
-    if (!gb_file) {
-        perror("Couldn't open .gb file");
-        exit(1);
-    }
-
-    enum CARTRIDGES cart_type = set_cartridge_type(gb_file);
-    uint16_t num_rom_banks = get_num_rom_banks(gb_file);
+void memory_init(const uint8_t* rom, uint32_t size) {
+    enum CARTRIDGES cart_type = get_cartridge_type(rom);
+    uint16_t num_rom_banks = get_num_rom_banks(rom);
     uint32_t rom_size = ROM_BANK_SIZE * num_rom_banks;
-    uint32_t ram_size = get_ram_size(gb_file);
+    uint32_t ram_size = get_ram_size(rom);
 
-    MEMORY = malloc(0x10000);
-    CARTRIDGE = malloc(sizeof(CARTRIDGE_STRUCT));
-    CARTRIDGE->ROM = malloc(rom_size);
-    CARTRIDGE->RAM = ram_size ? malloc(ram_size) : nullptr;
+    CARTRIDGE->ROM = calloc(rom_size, sizeof(uint8_t));
+    CARTRIDGE->RAM = ram_size ? calloc(ram_size, sizeof(uint8_t)) : nullptr;
     CARTRIDGE->CART_TYPE = cart_type;
     CARTRIDGE->ROM_SIZE = rom_size;
     CARTRIDGE->RAM_SIZE = ram_size;
     CARTRIDGE->NUM_ROM_BANKS = num_rom_banks;
+    CARTRIDGE->HAS_RTC = has_rtc(rom);
+    CARTRIDGE->CART_ROM_BANK = 1;
+    //ROM only carts with RAM have nothing to disable it with
+    CARTRIDGE->RAM_ENABLE = cart_type == MBC0 && ram_size;
+    if (cart_type == MBC2) {
+        memset(CARTRIDGE->RAM, 0xF0, ram_size);
+    }
 
-    fseek(gb_file, 0, SEEK_SET);
-    fread(CARTRIDGE->ROM, sizeof(uint8_t), rom_size, gb_file);
-    fclose(gb_file);
+    memcpy(CARTRIDGE->ROM, rom, size < rom_size ? size : rom_size);
+    cartridge_remap();
     io_ports_init();
 }
 
@@ -240,21 +368,6 @@ static void io_ports_init() {
     cycles_to_increment_timer = 256;
 }
 
-/*
- * Checks the serial transfer control input for if a byte has been written to
- * the serial transfer data input If so, prints the data and resets serial transfer
- * control input
- */
-static void check_sp() {
-    if (MEMORY[SC] == 0x81) {
-        char c = (char) MEMORY[SB];
-
-        printf("%c", c);
-
-        MEMORY[SC] = 0;
-    }
-}
-
 void set_refresh() {
     refresh = true;
 }
@@ -0,0 +1,368 @@
+#include <common.h>
+#include <SDL3/SDL.h>
+#include <apu.h>
+#include <movie.h>
+#include <gb.h>
+#ifdef __linux__
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#define DEFAULT_FRAMES 600  //~10 emulated seconds
+#define DEFAULT_RUNS 3
+
+/*
+ * Whole-emulator benchmark. Runs a ROM headless through run_frame() with sound
+ * synthesis off and on, alternating between the two so host noise hits both
+ * alike, and keeps the fastest run of each. The difference is what audio costs
+ * per emulated second. Lengths, sweep and envelopes run in both modes. With a
+ * movie every run replays the same recorded input, so the benchmark follows
+ * real gameplay instead of sitting on the title screen. On Linux the
+ * fastest run of each mode also reports what perf counters the host grants
+ * per frame: instructions, cache references and misses, L1 data cache read
+ * misses and page faults. A counter that cannot be opened, in a VM or with a
+ * strict perf_event_paranoid, is shown as "-". --save keeps the per-frame
+ * figures in a file and --compare prints the change against such a file, so
+ * two builds, for example two memory layouts, can be set side by side.
+ */
+
+enum BENCH_COUNTER {
+    COUNTER_INSTRUCTIONS,
+    COUNTER_CACHE_REFERENCES,
+    COUNTER_CACHE_MISSES,
+    COUNTER_L1D_READ_MISSES,
+    COUNTER_PAGE_FAULTS,
+    NUM_COUNTERS
+};
+
+static const char* COUNTER_NAMES[NUM_COUNTERS] = {"INSTR", "CACHE REFS", "CACHE MISS", "L1D MISS", "PAGE FAULTS"};
+
+typedef struct BENCH_MODE {
+    const char* NAME;
+    bool SYNTHESIZE;
+    uint64_t BEST_NS;
+    uint64_t SAMPLES;
+    uint64_t COUNTS[NUM_COUNTERS];  //of the fastest run
+} BENCH_MODE;
+
+static uint32_t rate;
+static enum RESAMPLE_QUALITY quality;
+static const char* movie_path;
+
+static BENCH_MODE MODES[] = {
+    {"silent", false, UINT64_MAX, 0, {0}},
+    {"audio", true, UINT64_MAX, 0, {0}},
+};
+
+#define NUM_MODES (sizeof(MODES) / sizeof(MODES[0]))
+#define NUM_FIGURES (NUM_COUNTERS + 1)  //ns per frame, then every counter
+#define FIGURE_UNAVAILABLE -1.0
+
+static int counter_fds[NUM_COUNTERS];
+static int counter_error;   //errno of the first counter that failed to open
+
+/*
+ * Opens every counter for this thread, user space only, stopped
+ */
+static void counters_open() {
+    counter_error = 0;
+    for (uint8_t i = 0; i < NUM_COUNTERS; i++) {
+        counter_fds[i] = -1;
+    }
+#ifdef __linux__
+    static const struct { uint32_t TYPE; uint64_t CONFIG; } EVENTS[NUM_COUNTERS] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                             PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+    };
+    for (uint8_t i = 0; i < NUM_COUNTERS; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = EVENTS[i].TYPE;
+        attr.config = EVENTS[i].CONFIG;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        counter_fds[i] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (counter_fds[i] < 0 && !counter_error) {
+            counter_error = errno;
+        }
+    }
+#endif
+}
+
+static void counters_close() {
+#ifdef __linux__
+    for (uint8_t i = 0; i < NUM_COUNTERS; i++) {
+        if (counter_fds[i] >= 0) {
+            close(counter_fds[i]);
+        }
+    }
+#endif
+}
+
+static void counters_start() {
+#ifdef __linux__
+    for (uint8_t i = 0; i < NUM_COUNTERS; i++) {
+        if (counter_fds[i] >= 0) {
+            ioctl(counter_fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(counter_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+static void counters_stop(uint64_t counts[NUM_COUNTERS]) {
+    for (uint8_t i = 0; i < NUM_COUNTERS; i++) {
+        counts[i] = 0;
+#ifdef __linux__
+        if (counter_fds[i] >= 0) {
+            ioctl(counter_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+            if (read(counter_fds[i], &counts[i], sizeof(counts[i])) != sizeof(counts[i])) {
+                counts[i] = 0;
+            }
+        }
+#endif
+    }
+}
+
+static void bench_mode(BENCH_MODE* mode, const char* rom, uint32_t frames) {
+    gb_init(rom);
+    if (movie_path) {
+        movie_init(movie_path, MOVIE_PLAY);
+    }
+    if (mode->SYNTHESIZE) {
+        apu_start_sound(rate, quality);
+    }
+    uint64_t samples = 0;
+    uint64_t counts[NUM_COUNTERS];
+    counters_start();
+    uint64_t start = SDL_GetTicksNS();
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        run_frame();
+        samples += APU->NUM_SAMPLES;
+        APU->NUM_SAMPLES = 0;
+    }
+    uint64_t elapsed_ns = SDL_GetTicksNS() - start;
+    counters_stop(counts);
+    if (elapsed_ns < mode->BEST_NS) {
+        mode->BEST_NS = elapsed_ns;
+        memcpy(mode->COUNTS, counts, sizeof(counts));
+    }
+    mode->SAMPLES = samples;
+    movie_free();
+    free_resources();
+}
+
+/*
+ * Fills FIGURES with the per-frame time and counts of the fastest run of MODE
+ */
+static void mode_figures(const BENCH_MODE* mode, uint32_t frames, double figures[NUM_FIGURES]) {
+    figures[0] = (double) mode->BEST_NS / frames;
+    for (uint8_t i = 0; i < NUM_COUNTERS; i++) {
+        figures[i + 1] = counter_fds[i] < 0 ? FIGURE_UNAVAILABLE : (double) mode->COUNTS[i] / frames;
+    }
+}
+
+/*
+ * Writes one line per mode: its name, then ns per frame and every counter per
+ * frame, -1 for counters the host refused
+ */
+static void save_figures(const char* path, uint32_t frames) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        perror("Couldn't open results file");
+        exit(1);
+    }
+    for (size_t m = 0; m < NUM_MODES; m++) {
+        double figures[NUM_FIGURES];
+        mode_figures(&MODES[m], frames, figures);
+        fprintf(file, "%s", MODES[m].NAME);
+        for (uint8_t i = 0; i < NUM_FIGURES; i++) {
+            fprintf(file, " %.3f", figures[i]);
+        }
+        fprintf(file, "\n");
+    }
+    fclose(file);
+}
+
+/*
+ * Prints the change of every figure against the file --save wrote for another build
+ */
+static void print_comparison(const char* path, uint32_t frames) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        perror("Couldn't open results file");
+        exit(1);
+    }
+    double baseline[NUM_MODES][NUM_FIGURES];
+    bool found[NUM_MODES] = {false};
+    char name[16];
+    while (fscanf(file, "%15s", name) == 1) {
+        double figures[NUM_FIGURES];
+        for (uint8_t i = 0; i < NUM_FIGURES; i++) {
+            if (fscanf(file, "%lf", &figures[i]) != 1) {
+                fprintf(stderr, "%s is not a gb_bench results file\n", path);
+                exit(1);
+            }
+        }
+        for (size_t m = 0; m < NUM_MODES; m++) {
+            if (!strcmp(name, MODES[m].NAME)) {
+                memcpy(baseline[m], figures, sizeof(figures));
+                found[m] = true;
+            }
+        }
+    }
+    fclose(file);
+
+    printf("\nChange against %s\n%-8s %12s", path, "MODE", "TIME");
+    for (uint8_t i = 0; i < NUM_COUNTERS; i++) {
+        printf(" %12s", COUNTER_NAMES[i]);
+    }
+    printf("\n");
+    for (size_t m = 0; m < NUM_MODES; m++) {
+        double figures[NUM_FIGURES];
+        mode_figures(&MODES[m], frames, figures);
+        printf("%-8s", MODES[m].NAME);
+        for (uint8_t i = 0; i < NUM_FIGURES; i++) {
+            if (!found[m] || figures[i] < 0 || baseline[m][i] <= 0) {
+                printf(" %12s", "-");
+            }
+            else {
+                printf(" %+11.1f%%", (figures[i] / baseline[m][i] - 1.0) * 100.0);
+            }
+        }
+        printf("\n");
+    }
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr, "Usage: %s <rom.gb> [options]\n", program);
+    fprintf(stderr, "  --frames <N>   frames per run (default %d, or the length of the movie)\n", DEFAULT_FRAMES);
+    fprintf(stderr, "  --movie <file> replay recorded input in every run\n");
+    fprintf(stderr, "  --runs <N>     runs per mode, the fastest is kept (default %d)\n", DEFAULT_RUNS);
+    fprintf(stderr, "  --rate <Hz>    output sample rate (default %d)\n", APU_OUTPUT_RATE);
+    fprintf(stderr, "  --quality <box|low|medium|high>\n");
+    fprintf(stderr, "                 resampling filter (default medium)\n");
+    fprintf(stderr, "  --save <file>  write time and counters per frame to a results file\n");
+    fprintf(stderr, "  --compare <file>\n");
+    fprintf(stderr, "                 print the change against a results file saved by another build\n");
+}
+
+int main(int argc, char* argv[]) {
+    const char* rom = nullptr;
+    uint32_t frames = 0;
+    uint32_t runs = DEFAULT_RUNS;
+    rate = APU_OUTPUT_RATE;
+    quality = RESAMPLE_MEDIUM;
+    movie_path = nullptr;
+    const char* save_path = nullptr;
+    const char* compare_path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            frames = (uint32_t) strtoul(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--runs") && i + 1 < argc) {
+            runs = (uint32_t) strtoul(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--movie") && i + 1 < argc) {
+            movie_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--rate") && i + 1 < argc) {
+            rate = (uint32_t) strtoul(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--save") && i + 1 < argc) {
+            save_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--compare") && i + 1 < argc) {
+            compare_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--quality") && i + 1 < argc) {
+            if (!resampler_parse_quality(argv[++i], &quality)) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (!rom && argv[i][0] != '-') {
+            rom = argv[i];
+        }
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!rom || !runs || rate < APU_MIN_OUTPUT_RATE || rate > APU_MAX_OUTPUT_RATE) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (!frames && movie_path) {
+        gb_init(rom);
+        movie_init(movie_path, MOVIE_PLAY);
+        frames = (uint32_t) MOVIE->FRAMES;
+        movie_free();
+        free_resources();
+    }
+    if (!frames) {
+        frames = DEFAULT_FRAMES;
+    }
+
+    counters_open();
+    for (uint32_t run = 0; run < runs; run++) {
+        for (size_t m = 0; m < NUM_MODES; m++) {
+            bench_mode(&MODES[m], rom, frames);
+        }
+    }
+    counters_close();
+
+    double emulated_s = frames * FRAME_TIME_MS / 1000.0;
+    printf("%s: %u frames (%.2f emulated seconds), fastest of %u runs, %s resampling to %u Hz\n",
+           rom, frames, emulated_s, runs, resampler_quality_name(quality), rate);
+    if (movie_path) {
+        printf("Input replayed from %s\n", movie_path);
+    }
+    printf("%-8s %14s %9s %12s\n", "MODE", "MS/EMULATED S", "SPEED", "SAMPLES");
+    for (size_t m = 0; m < NUM_MODES; m++) {
+        double ms_per_second = MODES[m].BEST_NS / 1e6 / emulated_s;
+        printf("%-8s %14.2f %8.1fx %12llu\n", MODES[m].NAME, ms_per_second, 1000.0 / ms_per_second,
+               (unsigned long long) MODES[m].SAMPLES);
+    }
+    //share of the real-time budget, 1000 ms per emulated second
+    double audio_ms = ((double) MODES[1].BEST_NS - (double) MODES[0].BEST_NS) / 1e6 / emulated_s;
+    printf("Sound synthesis: %.2f ms per emulated second, %.2f%% of real time\n", audio_ms, audio_ms / 10.0);
+
+    printf("\nPer frame of the fastest run\n%-8s", "MODE");
+    for (uint8_t i = 0; i < NUM_COUNTERS; i++) {
+        printf(" %12s", COUNTER_NAMES[i]);
+    }
+    printf("\n");
+    for (size_t m = 0; m < NUM_MODES; m++) {
+        printf("%-8s", MODES[m].NAME);
+        for (uint8_t i = 0; i < NUM_COUNTERS; i++) {
+            if (counter_fds[i] < 0) {
+                printf(" %12s", "-");
+            }
+            else {
+                printf(" %12.1f", (double) MODES[m].COUNTS[i] / frames);
+            }
+        }
+        printf("\n");
+    }
+    if (counter_error) {
+        printf("Some counters are unavailable: %s\n", strerror(counter_error));
+    }
+    if (compare_path) {
+        print_comparison(compare_path, frames);
+    }
+    if (save_path) {
+        save_figures(save_path, frames);
+    }
+    return 0;
+}
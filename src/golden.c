@@ -0,0 +1,183 @@
+#include <common.h>
+#include <jobs.h>
+
+#define DEFAULT_FRAMES 600
+#define NAME_WIDTH 40
+
+/*
+ * Golden-frame regression runner. Every ROM in a directory is run headless in
+ * parallel and its frame hash stream is compared against ROM.golden, so renderer
+ * and CPU changes can be checked to be pixel-identical to the current output.
+ * ROMs with a ROM.movie next to them replay it, so the run covers gameplay.
+ */
+
+enum GOLDEN_RESULT {
+    GOLDEN_PASS,
+    GOLDEN_FAIL,
+    GOLDEN_NEW,
+    GOLDEN_UPDATED,
+    GOLDEN_CRASH
+};
+
+static const char* RESULT_NAMES[] = {"PASS", "FAIL", "NO GOLDEN", "UPDATED", "CRASH"};
+
+static void print_usage(const char* program) {
+    fprintf(stderr, "Usage: %s <rom directory> [options]\n", program);
+    fprintf(stderr, "  --frames <N>          frames to run each ROM for (default %d)\n", DEFAULT_FRAMES);
+    fprintf(stderr, "  --hash-interval <N>   only compare every Nth frame\n");
+    fprintf(stderr, "  --update              replace the golden files with the current output\n");
+    fprintf(stderr, "  -j <N>                processes to run at once (default one per core)\n");
+    fprintf(stderr, "  --emulator <path>     gb_emu executable to test\n");
+}
+
+/*
+ * Compares two hash streams line by line, returns 0 if they match and
+ * otherwise the frame number of the first difference
+ */
+static uint64_t first_difference(const char* golden, const char* actual) {
+    while (*golden || *actual) {
+        const char* golden_end = strchr(golden, '\n');
+        const char* actual_end = strchr(actual, '\n');
+        size_t golden_len = golden_end ? (size_t) (golden_end - golden) : strlen(golden);
+        size_t actual_len = actual_end ? (size_t) (actual_end - actual) : strlen(actual);
+        if (golden_len != actual_len || memcmp(golden, actual, golden_len) != 0) {
+            //the line that exists holds the frame number, a missing line still reports a nonzero frame
+            uint64_t frame = strtoull(golden_len ? golden : actual, nullptr, 10);
+            return frame ? frame : 1;
+        }
+        golden += golden_len + (golden_end != nullptr);
+        actual += actual_len + (actual_end != nullptr);
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    const char* rom_dir = nullptr;
+    char* emulator = nullptr;
+    uint64_t frames = DEFAULT_FRAMES;
+    uint64_t hash_interval = 1;
+    uint32_t max_parallel = 0;
+    bool update = false;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            frames = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--hash-interval") && i + 1 < argc) {
+            hash_interval = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--update")) {
+            update = true;
+        }
+        else if (!strcmp(argv[i], "-j") && i + 1 < argc) {
+            max_parallel = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--emulator") && i + 1 < argc) {
+            emulator = SDL_strdup(argv[++i]);
+        }
+        else if (argv[i][0] != '-' && !rom_dir) {
+            rom_dir = argv[i];
+        }
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!rom_dir || !frames || !hash_interval) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (!emulator) {
+        emulator = jobs_emulator_path();
+    }
+
+    int num_roms;
+    char** roms = SDL_GlobDirectory(rom_dir, "*.gb", SDL_GLOB_CASEINSENSITIVE, &num_roms);
+    if (!roms || !num_roms) {
+        fprintf(stderr, "No ROMs found in %s\n", rom_dir);
+        return 1;
+    }
+
+    JOB* jobs = calloc(num_roms, sizeof(JOB));
+    for (int i = 0; i < num_roms; i++) {
+        JOB* job = &jobs[i];
+        job_init(job, roms[i]);
+        job_add_arg(job, "%s", emulator);
+        job_add_arg(job, "%s/%s", rom_dir, roms[i]);
+        job_add_arg(job, "--headless");
+        job_add_arg(job, "--frames");
+        job_add_arg(job, "%llu", (unsigned long long) frames);
+        job_add_arg(job, "--hash");
+        job_add_arg(job, "%s/%s.hashes", rom_dir, roms[i]);
+        job_add_arg(job, "--hash-interval");
+        job_add_arg(job, "%llu", (unsigned long long) hash_interval);
+        char* movie_path;
+        SDL_asprintf(&movie_path, "%s/%s.movie", rom_dir, roms[i]);
+        if (SDL_GetPathInfo(movie_path, nullptr)) {
+            job_add_arg(job, "--play");
+            job_add_arg(job, "%s", movie_path);
+        }
+        SDL_free(movie_path);
+    }
+
+    uint64_t start = SDL_GetTicksNS();
+    jobs_run(jobs, num_roms, max_parallel);
+    double total_ms = (double) (SDL_GetTicksNS() - start) / 1e6;
+
+    uint32_t failures = 0;
+    printf("%-*s %-24s %10s\n", NAME_WIDTH, "ROM", "RESULT", "TIME (ms)");
+    for (int i = 0; i < num_roms; i++) {
+        JOB* job = &jobs[i];
+        char* golden_path;
+        char* actual_path;
+        SDL_asprintf(&golden_path, "%s/%s.golden", rom_dir, job->NAME);
+        SDL_asprintf(&actual_path, "%s/%s.hashes", rom_dir, job->NAME);
+
+        enum GOLDEN_RESULT result;
+        uint64_t frame = 0;
+        char* golden = SDL_LoadFile(golden_path, nullptr);
+        char* actual = SDL_LoadFile(actual_path, nullptr);
+        if (job->EXIT_CODE != 0 || !actual) {
+            result = GOLDEN_CRASH;
+        }
+        else if (update) {
+            result = SDL_RenamePath(actual_path, golden_path) ? GOLDEN_UPDATED : GOLDEN_CRASH;
+        }
+        else if (!golden) {
+            result = GOLDEN_NEW;
+        }
+        else {
+            frame = first_difference(golden, actual);
+            result = frame ? GOLDEN_FAIL : GOLDEN_PASS;
+        }
+        //mismatching streams are kept next to the golden file for inspection
+        if (result == GOLDEN_PASS) {
+            SDL_RemovePath(actual_path);
+        }
+        if (result != GOLDEN_PASS && result != GOLDEN_UPDATED) {
+            failures++;
+        }
+
+        char detail[32] = "";
+        if (result == GOLDEN_FAIL) {
+            snprintf(detail, sizeof(detail), " at frame %llu", (unsigned long long) frame);
+        }
+        else if (result == GOLDEN_CRASH) {
+            snprintf(detail, sizeof(detail), " (exit %d)", job->EXIT_CODE);
+        }
+        char result_text[48];
+        snprintf(result_text, sizeof(result_text), "%s%s", RESULT_NAMES[result], detail);
+        printf("%-*s %-24s %10.1f\n", NAME_WIDTH, job->NAME, result_text, job->WALL_MS);
+
+        SDL_free(golden);
+        SDL_free(actual);
+        SDL_free(golden_path);
+        SDL_free(actual_path);
+        job_free(job);
+    }
+    printf("%d ROMs, %u failed, %.1f ms\n", num_roms, failures, total_ms);
+
+    free(jobs);
+    SDL_free(roms);
+    SDL_free(emulator);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,177 @@
+#include <common.h>
+#include <memory.h>
+#include <heatmap.h>
+
+static const char* SOURCE_NAMES[HEATMAP_NUM_SOURCES] = {"cpu", "dma", "ppu"};
+static const char ACCESS_NAMES[HEATMAP_NUM_ACCESSES] = {'r', 'w'};
+
+void heatmap_init(const char* path) {
+    HEATMAP = (HEATMAP_STRUCT*) calloc(1, sizeof(HEATMAP_STRUCT));
+    if (!HEATMAP) {
+        perror("Couldn't allocate heatmap");
+        exit(1);
+    }
+    if (!path) {
+        return;
+    }
+    HEATMAP->OUTPUT = fopen(path, "w");
+    if (!HEATMAP->OUTPUT) {
+        perror("Couldn't open heatmap file");
+        exit(1);
+    }
+    fprintf(HEATMAP->OUTPUT, "# frame <n>, then only the non-zero counts of that frame, pages and banks in hex:\n");
+    fprintf(HEATMAP->OUTPUT, "# <source> <r|w> <page>:<count>... and <source> <rom|ram> <bank>:<count>...\n");
+}
+
+void heatmap_free() {
+    if (!HEATMAP) {
+        return;
+    }
+    if (HEATMAP->OUTPUT) {
+        fclose(HEATMAP->OUTPUT);
+    }
+    free(HEATMAP);
+    HEATMAP = nullptr;
+}
+
+/*
+ * Counts one access, banks are taken from the cartridge state at the time of the access
+ */
+void heatmap_access(enum HEATMAP_SOURCE source, enum HEATMAP_ACCESS access, uint16_t address) {
+    HEATMAP->PAGES[source][access][address >> 8]++;
+    if (address < 0x8000 && access == HEAT_READ) {
+        HEATMAP->ROM_BANKS[source][mapped_rom_bank(address) % HEATMAP_MAX_ROM_BANKS]++;
+    }
+    else if (address >= 0xA000 && address < 0xC000) {
+        HEATMAP->RAM_BANKS[source][mapped_ram_bank() % HEATMAP_MAX_RAM_BANKS]++;
+    }
+}
+
+/*
+ * Writes the non-zero COUNTS as one line, adds them to TOTALS and clears them
+ */
+static void flush_counts(const char* label, uint32_t* counts, uint64_t* totals, uint16_t size) {
+    bool empty = true;
+    for (uint16_t i = 0; i < size; i++) {
+        if (!counts[i]) {
+            continue;
+        }
+        if (HEATMAP->OUTPUT) {
+            if (empty) {
+                fputs(label, HEATMAP->OUTPUT);
+            }
+            fprintf(HEATMAP->OUTPUT, " %02X:%u", i, counts[i]);
+        }
+        empty = false;
+        totals[i] += counts[i];
+        counts[i] = 0;
+    }
+    if (!empty && HEATMAP->OUTPUT) {
+        fputc('\n', HEATMAP->OUTPUT);
+    }
+}
+
+/*
+ * Called at the end of every frame
+ */
+void heatmap_frame() {
+    if (HEATMAP->OUTPUT) {
+        fprintf(HEATMAP->OUTPUT, "frame %llu\n", (unsigned long long) HEATMAP->FRAMES);
+    }
+    char label[16];
+    for (uint8_t source = 0; source < HEATMAP_NUM_SOURCES; source++) {
+        for (uint8_t access = 0; access < HEATMAP_NUM_ACCESSES; access++) {
+            snprintf(label, sizeof(label), "%s %c", SOURCE_NAMES[source], ACCESS_NAMES[access]);
+            flush_counts(label, HEATMAP->PAGES[source][access], HEATMAP->TOTAL_PAGES[source][access], HEATMAP_NUM_PAGES);
+        }
+        snprintf(label, sizeof(label), "%s rom", SOURCE_NAMES[source]);
+        flush_counts(label, HEATMAP->ROM_BANKS[source], HEATMAP->TOTAL_ROM_BANKS[source], HEATMAP_MAX_ROM_BANKS);
+        snprintf(label, sizeof(label), "%s ram", SOURCE_NAMES[source]);
+        flush_counts(label, HEATMAP->RAM_BANKS[source], HEATMAP->TOTAL_RAM_BANKS[source], HEATMAP_MAX_RAM_BANKS);
+    }
+    HEATMAP->FRAMES++;
+}
+
+static uint64_t page_total(uint16_t page) {
+    uint64_t total = 0;
+    for (uint8_t source = 0; source < HEATMAP_NUM_SOURCES; source++) {
+        for (uint8_t access = 0; access < HEATMAP_NUM_ACCESSES; access++) {
+            total += HEATMAP->TOTAL_PAGES[source][access][page];
+        }
+    }
+    return total;
+}
+
+static uint64_t range_total(uint8_t source, uint8_t access, uint16_t first_page, uint16_t last_page) {
+    uint64_t total = 0;
+    for (uint16_t page = first_page; page <= last_page; page++) {
+        total += HEATMAP->TOTAL_PAGES[source][access][page];
+    }
+    return total;
+}
+
+static void print_region(const char* name, uint16_t first_page, uint16_t last_page, double frames) {
+    printf("%-24s", name);
+    for (uint8_t source = 0; source < HEATMAP_NUM_SOURCES; source++) {
+        for (uint8_t access = 0; access < HEATMAP_NUM_ACCESSES; access++) {
+            printf(" %10.1f", range_total(source, access, first_page, last_page) / frames);
+        }
+    }
+    printf("\n");
+}
+
+/*
+ * TOTALS holds SIZE banks for each source, one after the other
+ */
+static void print_banks(const char* name, const uint64_t* totals, uint16_t size) {
+    bool first = true;
+    for (uint16_t bank = 0; bank < size; bank++) {
+        uint64_t count = 0;
+        for (uint8_t source = 0; source < HEATMAP_NUM_SOURCES; source++) {
+            count += totals[source * size + bank];
+        }
+        if (count) {
+            printf("%s %02X:%llu", first ? name : "", bank, (unsigned long long) count);
+            first = false;
+        }
+    }
+    if (!first) {
+        printf("\n");
+    }
+}
+
+/*
+ * Prints the hottest pages and the VRAM, OAM and bank totals, counts are per frame
+ */
+void heatmap_print_summary() {
+    if (!HEATMAP->FRAMES) {
+        return;
+    }
+    double frames = (double) HEATMAP->FRAMES;
+    bool listed[HEATMAP_NUM_PAGES] = {false};
+    printf("Heatmap over %llu frames, accesses per frame\n", (unsigned long long) HEATMAP->FRAMES);
+    printf("%-24s %10s %10s %10s %10s %10s %10s\n", "", "cpu r", "cpu w", "dma r", "dma w", "ppu r", "ppu w");
+    for (uint8_t rank = 0; rank < HEATMAP_TOP_PAGES; rank++) {
+        uint16_t hottest = 0;
+        uint64_t hottest_total = 0;
+        for (uint16_t page = 0; page < HEATMAP_NUM_PAGES; page++) {
+            uint64_t total = page_total(page);
+            if (!listed[page] && total > hottest_total) {
+                hottest = page;
+                hottest_total = total;
+            }
+        }
+        if (!hottest_total) {
+            break;
+        }
+        listed[hottest] = true;
+        char name[24];
+        snprintf(name, sizeof(name), "page %02X00", hottest);
+        print_region(name, hottest, hottest, frames);
+    }
+    print_region("VRAM 8000-9FFF", 0x80, 0x9F, frames);
+    print_region("OAM FE00-FE9F", 0xFE, 0xFE, frames);
+    print_region("I/O and HRAM FF00-FFFF", 0xFF, 0xFF, frames);
+    print_banks("ROM banks", &HEATMAP->TOTAL_ROM_BANKS[0][0], HEATMAP_MAX_ROM_BANKS);
+    print_banks("RAM banks", &HEATMAP->TOTAL_RAM_BANKS[0][0], HEATMAP_MAX_RAM_BANKS);
+}
@@ -0,0 +1,184 @@
+#include <common.h>
+#include <SDL3/SDL.h>
+#include <gb.h>
+#include <memory.h>
+#include <cpu.h>
+#include <input.h>
+#include <movie.h>
+
+#define QUEUE_MASK (INPUT_QUEUE_SIZE - 1)
+#define M_CYCLES_PER_FRAME (CYCLES_PER_FRAME / 4)
+#define SELECT_D_PAD 0x10           //P1 bits, a line is selected while its bit is 0
+#define SELECT_BUTTONS 0x20
+#define JOYPAD_INTERRUPT 0x10
+#define NEXT_FRAMES UINT64_MAX      //cycle of events the current frame does not reach
+
+void input_init() {
+    INPUT = (INPUT_STRUCT*) calloc(1, sizeof(INPUT_STRUCT));
+    if (!INPUT) {
+        perror("Couldn't allocate input queue");
+        exit(1);
+    }
+    INPUT->BUTTONS = 0xFF;
+    INPUT->D_PAD = 0xFF;
+    INPUT->POLLED_BUTTONS = 0xFF;
+    INPUT->POLLED_D_PAD = 0xFF;
+}
+
+void input_free() {
+    free(INPUT);
+    INPUT = nullptr;
+}
+
+///////////////////////////////////////// RENDER THREAD /////////////////////////////////////////
+
+/*
+ * Queues the joypad state after BIT of the d-pad or the buttons changed at
+ * HOST_NS. Key repeats leave the state unchanged and are not queued.
+ */
+void input_push(uint64_t host_ns, bool d_pad, uint8_t bit, bool pressed) {
+    uint8_t* state = d_pad ? &INPUT->D_PAD : &INPUT->BUTTONS;
+    uint8_t updated = pressed ? CLEAR_BIT(bit, *state) : SET_BIT(bit, *state);
+    if (updated == *state) {
+        return;
+    }
+    uint64_t head = atomic_load_explicit(&INPUT->HEAD, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&INPUT->TAIL, memory_order_acquire);
+    if (head - tail == INPUT_QUEUE_SIZE) {
+        //the state is left as it was so the next change still makes sense to the emulation thread
+        atomic_fetch_add_explicit(&INPUT->DROPPED, 1, memory_order_relaxed);
+        return;
+    }
+    *state = updated;
+    INPUT_EVENT* event = &INPUT->QUEUE[head & QUEUE_MASK];
+    event->HOST_NS = host_ns;
+    event->BUTTONS = INPUT->BUTTONS;
+    event->D_PAD = INPUT->D_PAD;
+    atomic_store_explicit(&INPUT->HEAD, head + 1, memory_order_release);
+}
+
+///////////////////////////////////////// EMULATION THREAD /////////////////////////////////////////
+
+/*
+ * Called before every frame, the frame replays the host time since the last one started
+ */
+void input_begin_frame() {
+    uint64_t now = SDL_GetTicksNS();
+    INPUT->WINDOW_START_NS = INPUT->WINDOW_END_NS ? INPUT->WINDOW_END_NS : now;
+    INPUT->WINDOW_END_NS = now;
+    INPUT->FRAME_CYCLE = CYCLE_COUNT;
+}
+
+/*
+ * M-cycle EVENT takes effect at, the same fraction of the frame as of the host window
+ */
+static uint64_t event_cycle(const INPUT_EVENT* event) {
+    if (event->HOST_NS >= INPUT->WINDOW_END_NS) {
+        return NEXT_FRAMES;
+    }
+    if (event->HOST_NS <= INPUT->WINDOW_START_NS) {
+        return INPUT->FRAME_CYCLE;
+    }
+    uint64_t offset = event->HOST_NS - INPUT->WINDOW_START_NS;
+    uint64_t window = INPUT->WINDOW_END_NS - INPUT->WINDOW_START_NS;
+    return INPUT->FRAME_CYCLE + offset * M_CYCLES_PER_FRAME / window;
+}
+
+/*
+ * Updates the joypad the game sees, live input and movie playback both go
+ * through here. Like the hardware, the interrupt is only requested when a
+ * selected P1 line goes from high to low, so on presses.
+ */
+void input_set_joypad(uint8_t buttons, uint8_t d_pad) {
+    uint8_t pressed_d_pad = CPU->D_PAD & ~d_pad & 0x0F;
+    uint8_t pressed_buttons = CPU->BUTTONS & ~buttons & 0x0F;
+    if ((pressed_d_pad && !(MEMORY[P1] & SELECT_D_PAD)) || (pressed_buttons && !(MEMORY[P1] & SELECT_BUTTONS))) {
+        MEMORY[IF] |= JOYPAD_INTERRUPT;
+    }
+    CPU->D_PAD = d_pad;
+    CPU->BUTTONS = buttons;
+    if (MOVIE && MOVIE->MODE == MOVIE_RECORD) {
+        movie_record(buttons, d_pad);
+    }
+}
+
+static void apply_event(const INPUT_EVENT* event) {
+    input_set_joypad(event->BUTTONS, event->D_PAD);
+    if (!INPUT->UNSEEN_NS) {
+        INPUT->UNSEEN_NS = event->HOST_NS;
+    }
+    if (event->HOST_NS < INPUT->WINDOW_START_NS) {
+        INPUT->LATE++;
+    }
+    INPUT->EVENTS++;
+}
+
+/*
+ * Applies the queued events that take effect by CYCLE
+ */
+static void apply_events(uint64_t cycle) {
+    uint64_t tail = atomic_load_explicit(&INPUT->TAIL, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&INPUT->HEAD, memory_order_acquire);
+    while (tail != head) {
+        const INPUT_EVENT* event = &INPUT->QUEUE[tail & QUEUE_MASK];
+        if (event_cycle(event) > cycle) {
+            break;
+        }
+        apply_event(event);
+        tail++;
+    }
+    atomic_store_explicit(&INPUT->TAIL, tail, memory_order_release);
+}
+
+/*
+ * Called on every P1 read, before the value is put on the bus
+ */
+void input_catch_up() {
+    apply_events(CYCLE_COUNT);
+    if (INPUT->UNSEEN_NS) {
+        uint64_t latency_ns = SDL_GetTicksNS() - INPUT->UNSEEN_NS;
+        INPUT->LATENCY_SUM_NS += latency_ns;
+        if (latency_ns > INPUT->LATENCY_MAX_NS) {
+            INPUT->LATENCY_MAX_NS = latency_ns;
+        }
+        INPUT->OBSERVED++;
+        INPUT->UNSEEN_NS = 0;
+    }
+}
+
+/*
+ * Called after every frame, applies what the game did not read in time
+ */
+void input_end_frame() {
+    apply_events(NEXT_FRAMES - 1);
+}
+
+/*
+ * Takes every queued event and returns the latest joypad state without
+ * applying it, for netplay which applies both players' input between frames
+ */
+void input_poll(uint8_t* buttons, uint8_t* d_pad) {
+    uint64_t tail = atomic_load_explicit(&INPUT->TAIL, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&INPUT->HEAD, memory_order_acquire);
+    while (tail != head) {
+        const INPUT_EVENT* event = &INPUT->QUEUE[tail & QUEUE_MASK];
+        INPUT->POLLED_BUTTONS = event->BUTTONS;
+        INPUT->POLLED_D_PAD = event->D_PAD;
+        INPUT->EVENTS++;
+        tail++;
+    }
+    atomic_store_explicit(&INPUT->TAIL, tail, memory_order_release);
+    *buttons = INPUT->POLLED_BUTTONS;
+    *d_pad = INPUT->POLLED_D_PAD;
+}
+
+void input_print_stats() {
+    uint64_t dropped = atomic_load(&INPUT->DROPPED);
+    printf("Input: %llu joypad changes, %llu late, %llu dropped\n", (unsigned long long) INPUT->EVENTS,
+           (unsigned long long) INPUT->LATE, (unsigned long long) dropped);
+    if (INPUT->OBSERVED) {
+        printf("Input latency to the next P1 read: avg %.2f ms, max %.2f ms over %llu changes\n",
+               INPUT->LATENCY_SUM_NS / 1e6 / INPUT->OBSERVED, INPUT->LATENCY_MAX_NS / 1e6,
+               (unsigned long long) INPUT->OBSERVED);
+    }
+}
@@ -0,0 +1,95 @@
+#include <common.h>
+#include <stdarg.h>
+#include <jobs.h>
+
+#define POLL_INTERVAL_MS 1
+
+#ifdef SDL_PLATFORM_WINDOWS
+#define EMULATOR_NAME "gb_emu.exe"
+#else
+#define EMULATOR_NAME "gb_emu"
+#endif
+
+void job_init(JOB* job, const char* name) {
+    memset(job, 0, sizeof(JOB));
+    job->NAME = SDL_strdup(name);
+    job->EXIT_CODE = -1;
+}
+
+void job_free(JOB* job) {
+    for (uint8_t i = 0; i < job->NUM_ARGS; i++) {
+        SDL_free(job->ARGS[i]);
+    }
+    SDL_free(job->NAME);
+}
+
+void job_add_arg(JOB* job, const char* fmt, ...) {
+    if (job->NUM_ARGS == JOB_MAX_ARGS) {
+        fprintf(stderr, "Too many arguments for %s\n", job->NAME);
+        exit(1);
+    }
+    va_list args;
+    va_start(args, fmt);
+    SDL_vasprintf(&job->ARGS[job->NUM_ARGS++], fmt, args);
+    va_end(args);
+}
+
+/*
+ * Starts JOB with its standard output discarded, errors still reach the terminal
+ */
+static void start_job(JOB* job) {
+    SDL_PropertiesID props = SDL_CreateProperties();
+    SDL_SetPointerProperty(props, SDL_PROP_PROCESS_CREATE_ARGS_POINTER, job->ARGS);
+    SDL_SetNumberProperty(props, SDL_PROP_PROCESS_CREATE_STDOUT_NUMBER, SDL_PROCESS_STDIO_NULL);
+    job->START_NS = SDL_GetTicksNS();
+    job->PROCESS = SDL_CreateProcessWithProperties(props);
+    SDL_DestroyProperties(props);
+    if (!job->PROCESS) {
+        fprintf(stderr, "Error starting %s: %s\n", job->ARGS[0], SDL_GetError());
+        exit(1);
+    }
+}
+
+/*
+ * Runs every job with at most MAX_PARALLEL processes at a time, returns once all
+ * of them exited. A MAX_PARALLEL of 0 uses one process per logical core.
+ */
+void jobs_run(JOB* jobs, uint32_t num_jobs, uint32_t max_parallel) {
+    if (!max_parallel) {
+        max_parallel = SDL_GetNumLogicalCPUCores();
+    }
+    uint32_t next_job = 0;
+    uint32_t running = 0;
+    uint32_t finished = 0;
+    while (finished < num_jobs) {
+        while (running < max_parallel && next_job < num_jobs) {
+            start_job(&jobs[next_job++]);
+            running++;
+        }
+        bool any_exited = false;
+        for (uint32_t i = 0; i < next_job; i++) {
+            JOB* job = &jobs[i];
+            if (job->PROCESS && SDL_WaitProcess(job->PROCESS, false, &job->EXIT_CODE)) {
+                job->WALL_MS = (double) (SDL_GetTicksNS() - job->START_NS) / 1e6;
+                SDL_DestroyProcess(job->PROCESS);
+                job->PROCESS = nullptr;
+                running--;
+                finished++;
+                any_exited = true;
+            }
+        }
+        if (!any_exited) {
+            SDL_Delay(POLL_INTERVAL_MS);
+        }
+    }
+}
+
+/*
+ * Path of the gb_emu executable, expected next to the tool being run
+ */
+char* jobs_emulator_path() {
+    char* path;
+    const char* base = SDL_GetBasePath();
+    SDL_asprintf(&path, "%s" EMULATOR_NAME, base ? base : "");
+    return path;
+}
@@ -2,9 +2,16 @@
 #include <memory.h>
 #include <gb.h>
 #include <ppu.h>
+#include <framebuffer.h>
+#include <triple_buffer.h>
 #include <lcd.h>
+#include <input.h>
+#include <timeline.h>
 
-#define SCALE 4
+#define DEFAULT_SCALE 4
+#define RENDER_WAIT_MS 4
+#define GB_REFRESH_RATE 59.7275
+#define DISPLAY_SYNC_TOLERANCE 0.005
 
 #define A_BIT 0x01
 #define RIGHT_BIT 0x01
@@ -16,23 +23,23 @@
 #define DOWN_BIT 0x08
 
 
-
-static const uint32_t COLORS_RGB[4] = {
-        0xFFFFFFFF, // White
-        0xAAAAAAFF, // Light Gray
-        0x555555FF, // Dark Gray
-        0x000000FF  // Black
-};
-
-void lcd_init() {
-    LCD = (GameBoy_Display*)malloc(sizeof(GameBoy_Display));
+/*
+ * Headless displays only keep the joypad and running state, no SDL window is created
+ */
+void lcd_init(bool headless) {
+    LCD = (GameBoy_Display*)calloc(1, sizeof(GameBoy_Display));
+    LCD->is_running = true;
+    LCD->redraw = true;
+    if (headless) {
+        return;
+    }
 
     if (!SDL_Init(SDL_INIT_VIDEO)) {
         fprintf(stderr, "Error initializing SDL3: %s\n", SDL_GetError());
         exit(1);
     }
 
-    LCD->window = SDL_CreateWindow("ByteBoy", WINDOW_WIDTH * SCALE, WINDOW_HEIGHT * SCALE, 0);
+    LCD->window = SDL_CreateWindow("ByteBoy", WINDOW_WIDTH * DEFAULT_SCALE, WINDOW_HEIGHT * DEFAULT_SCALE, SDL_WINDOW_RESIZABLE);
     if (!LCD->window) {
         fprintf(stderr, "Error creating window: %s\n", SDL_GetError());
         exit(1);
@@ -44,146 +51,183 @@ void lcd_init() {
         exit(1);
     }
 
-    LCD->surface = SDL_CreateSurface(WINDOW_WIDTH * SCALE, WINDOW_HEIGHT * SCALE, SDL_PIXELFORMAT_RGBA8888);
-    LCD->texture = SDL_CreateTextureFromSurface(LCD->renderer, LCD->surface);
+    //the texture stays at native resolution and the renderer scales it to the window
+    LCD->texture = SDL_CreateTexture(LCD->renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, WINDOW_WIDTH, WINDOW_HEIGHT);
+    if (!LCD->texture) {
+        fprintf(stderr, "Error creating texture: %s\n", SDL_GetError());
+        exit(1);
+    }
+    SDL_SetTextureScaleMode(LCD->texture, SDL_SCALEMODE_NEAREST);
+    SDL_SetRenderLogicalPresentation(LCD->renderer, WINDOW_WIDTH, WINDOW_HEIGHT, SDL_LOGICAL_PRESENTATION_LETTERBOX);
 
-    LCD->is_running = true;
-    LCD->buttons = 0xFF;
-    LCD->d_pad = 0xFF;
+    LCD->rgba = calloc(WINDOW_HEIGHT, sizeof(*LCD->rgba));
 }
 
+/*
+ * Turns on vsync and sets the frame period to the refresh rate of the display
+ * showing the window, but only when that rate is close enough to the Game Boy's
+ * that the speed difference is not noticeable. Returns whether it was enabled
+ */
+bool lcd_display_sync(uint64_t* period_num, uint64_t* period_den) {
+    const SDL_DisplayMode* mode = SDL_GetCurrentDisplayMode(SDL_GetDisplayForWindow(LCD->window));
+    if (!mode || !mode->refresh_rate_numerator || !mode->refresh_rate_denominator) {
+        return false;
+    }
+    double refresh_rate = (double) mode->refresh_rate_numerator / mode->refresh_rate_denominator;
+    if (SDL_fabs(refresh_rate - GB_REFRESH_RATE) > GB_REFRESH_RATE * DISPLAY_SYNC_TOLERANCE) {
+        return false;
+    }
+    if (!SDL_SetRenderVSync(LCD->renderer, 1)) {
+        return false;
+    }
+    *period_num = (uint64_t) mode->refresh_rate_denominator * 1000000000ULL;
+    *period_den = (uint64_t) mode->refresh_rate_numerator;
+    return true;
+}
+
+/*
+ * Joypad bit of a key, sets D_PAD for the direction keys. Returns 0 for other keys.
+ */
+static uint8_t joypad_bit(SDL_Scancode scancode, bool* d_pad) {
+    *d_pad = true;
+    switch (scancode) {
+        case SDL_SCANCODE_D:
+            return RIGHT_BIT;
+        case SDL_SCANCODE_A:
+            return LEFT_BIT;
+        case SDL_SCANCODE_W:
+            return UP_BIT;
+        case SDL_SCANCODE_S:
+            return DOWN_BIT;
+        default:
+            break;
+    }
+    *d_pad = false;
+    switch (scancode) {
+        case SDL_SCANCODE_H:
+            return A_BIT;
+        case SDL_SCANCODE_J:
+            return B_BIT;
+        case SDL_SCANCODE_K:
+            return SELECT_BIT;
+        case SDL_SCANCODE_L:
+            return START_BIT;
+        default:
+            return 0;
+    }
+}
+
+/*
+ * Handles SDL events on the render thread. Joypad changes are queued with
+ * their event timestamps, the emulation thread applies them at the matching
+ * cycle through the input queue.
+ */
 void process_events() {
     while (SDL_PollEvent(&LCD->event)) {
         switch (LCD->event.type) {
             case SDL_EVENT_QUIT:
                 LCD->is_running = false;
                 break;
+            case SDL_EVENT_WINDOW_EXPOSED:
+            case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED:
+                LCD->redraw = true;
+                break;
             case SDL_EVENT_KEY_DOWN:
-                switch (LCD->event.key.scancode) {
-                    case SDL_SCANCODE_H:
-                        LCD->buttons = CLEAR_BIT(A_BIT, LCD->buttons);
-                        MEMORY[IF] |= 0x10;
-                        break;
-                    case SDL_SCANCODE_D:
-                        LCD->d_pad = CLEAR_BIT(RIGHT_BIT, LCD->d_pad);
-                        MEMORY[IF] |= 0x10;
-                        break;
-                    case SDL_SCANCODE_J:
-                        LCD->buttons = CLEAR_BIT(B_BIT, LCD->buttons);
-                        MEMORY[IF] |= 0x10;
-                        break;
-                    case SDL_SCANCODE_A:
-                        LCD->d_pad = CLEAR_BIT(LEFT_BIT, LCD->d_pad);
-                        MEMORY[IF] |= 0x10;
-                        break;
-                    case SDL_SCANCODE_L:
-                        LCD->buttons = CLEAR_BIT(START_BIT, LCD->buttons);
-                        MEMORY[IF] |= 0x10;
-                        break;
-                    case SDL_SCANCODE_S:
-                        LCD->d_pad = CLEAR_BIT(DOWN_BIT, LCD->d_pad);
-                        MEMORY[IF] |= 0x10;
-                        break;
-                    case SDL_SCANCODE_K:
-                        LCD->buttons = CLEAR_BIT(SELECT_BIT, LCD->buttons);
-                        MEMORY[IF] |= 0x10;
-                        break;
-                    case SDL_SCANCODE_W:
-                        LCD->d_pad = CLEAR_BIT(UP_BIT, LCD->d_pad);
-                        MEMORY[IF] |= 0x10;
-                        break;
-                    default:
-                        break;
+            case SDL_EVENT_KEY_UP: {
+                bool d_pad;
+                uint8_t bit = joypad_bit(LCD->event.key.scancode, &d_pad);
+                if (bit && INPUT) {
+                    input_push(LCD->event.key.timestamp, d_pad, bit, LCD->event.type == SDL_EVENT_KEY_DOWN);
                 }
                 break;
-            case SDL_EVENT_KEY_UP:
-                switch (LCD->event.key.scancode) {
-                    case SDL_SCANCODE_H:
-                        LCD->buttons = SET_BIT(A_BIT, LCD->buttons);
-                        MEMORY[IF] |= 0x10;
-                        break;
-                    case SDL_SCANCODE_D:
-                        LCD->d_pad = SET_BIT(RIGHT_BIT, LCD->d_pad);
-                        MEMORY[IF] |= 0x10;
-                        break;
-                    case SDL_SCANCODE_J:
-                        LCD->buttons = SET_BIT(B_BIT, LCD->buttons);
-                        MEMORY[IF] |= 0x10;
-                        break;
-                    case SDL_SCANCODE_A:
-                        LCD->d_pad = SET_BIT(LEFT_BIT, LCD->d_pad);
-                        MEMORY[IF] |= 0x10;
-                        break;
-                    case SDL_SCANCODE_L:
-                        LCD->buttons = SET_BIT(START_BIT, LCD->buttons);
-                        MEMORY[IF] |= 0x10;
-                        break;
-                    case SDL_SCANCODE_S:
-                        LCD->d_pad = SET_BIT(DOWN_BIT, LCD->d_pad);
-                        MEMORY[IF] |= 0x10;
-                        break;
-                    case SDL_SCANCODE_K:
-                        LCD->buttons = SET_BIT(SELECT_BIT, LCD->buttons);
-                        MEMORY[IF] |= 0x10;
-                        break;
-                    case SDL_SCANCODE_W:
-                        LCD->d_pad = SET_BIT(UP_BIT, LCD->d_pad);
-                        MEMORY[IF] |= 0x10;
-                        break;
-                    default:
-                        break;
-                }
+            }
             default:
                 break;
         }
     }
 }
 
-void lcd_update_screen() {
-    SDL_UpdateTexture(LCD->texture, NULL, LCD->surface->pixels, LCD->surface->pitch);
+/*
+ * Uploads the dirty lines of FRAME and presents it. FRAME is nullptr when no new
+ * frame arrived, then the texture is only presented again if the window needs it
+ */
+void lcd_update_screen(const INDEXED_FRAME* frame) {
+    if (!frame && !LCD->redraw) {
+        return;
+    }
+    if (frame) {
+        frame_to_rgba(frame, LCD->rgba);
+        for (uint8_t y = 0; y < WINDOW_HEIGHT; y++) {
+            if (!frame_line_dirty(frame, y)) {
+                continue;
+            }
+            uint8_t first_line = y;
+            while (y + 1 < WINDOW_HEIGHT && frame_line_dirty(frame, y + 1)) {
+                y++;
+            }
+            SDL_Rect dirty_rows = {0, first_line, WINDOW_WIDTH, y - first_line + 1};
+            SDL_UpdateTexture(LCD->texture, &dirty_rows, LCD->rgba[first_line], FRAMEBUFFER_PITCH);
+        }
+    }
+    LCD->redraw = false;
     SDL_RenderClear(LCD->renderer);
     SDL_RenderTexture(LCD->renderer, LCD->texture, NULL, NULL);
     SDL_RenderPresent(LCD->renderer);
 }
 
+/*
+ * Render thread loop. SDL only allows rendering and event handling on the main
+ * thread, so the main thread presents while emulation runs on its own thread.
+ */
+void lcd_render_loop() {
+    while (LCD->is_running) {
+        TIMELINE_HOST_BEGIN(TRACK_RENDER_THREAD, "process_events");
+        process_events();
+        TIMELINE_HOST_BEGIN(TRACK_RENDER_THREAD, "wait for frame");
+        const FRAME_SLOT* slot = triple_buffer_acquire(RENDER_WAIT_MS);
+        uint64_t present_start = SDL_GetTicksNS();
+        TIMELINE_HOST_BEGIN(TRACK_RENDER_THREAD, "lcd_update_screen");
+        lcd_update_screen(slot ? &slot->FRAME : nullptr);
+        TIMELINE_HOST_END(TRACK_RENDER_THREAD);
+        if (slot) {
+            triple_buffer_presented(slot, present_start);
+        }
+    }
+}
+
+/*
+ * Stores the shade and palette of the pixel at (RENDER_X, LY). The shade comes
+ * from the palette register as it is at this dot, so raster effects that
+ * rewrite a palette mid-line are drawn like on hardware.
+ */
 void lcd_update_pixel(const PIXEL_DATA* pixel_data) {
-    uint8_t palette;
-    uint8_t pixel_color;
-    uint32_t pixel_rgb;
-    uint8_t color_index = pixel_data->binary_data;
+    enum PALETTE_ID palette_id;
+    uint8_t shade;
     enum FETCH_SOURCE source = pixel_data->source;
+    uint8_t color_index = pixel_data->binary_data & 0x03;
 
     if ((source == BACKGROUND || source == WINDOW) && (MEMORY[LCDC] & 0x01)) {
-        palette = MEMORY[BGP];
-        pixel_color = (palette >> (color_index * 2)) & 0x03;
-        pixel_rgb = COLORS_RGB[pixel_color];
+        palette_id = PALETTE_BGP;
+        shade = (MEMORY[BGP] >> (color_index * 2)) & 0x03;
     }
     else if (source == OBJECT) {
-        palette = pixel_data->palette ? MEMORY[OBP1] : MEMORY[OBP0];
-        pixel_color = (palette >> (color_index * 2)) & 0x03;
-        pixel_rgb = COLORS_RGB[pixel_color];
+        palette_id = pixel_data->palette ? PALETTE_OBP1 : PALETTE_OBP0;
+        shade = (MEMORY[pixel_data->palette ? OBP1 : OBP0] >> (color_index * 2)) & 0x03;
     }
     else {
-        pixel_rgb = COLORS_RGB[0];
+        palette_id = PALETTE_OFF;
+        shade = 0;
     }
 
-    uint32_t* surface_pixels = (uint32_t*)LCD->surface->pixels;
-    int dist_between_rows = LCD->surface->pitch / sizeof(uint32_t);
-
-    int gb_x = PPU->RENDER_X;
-    int gb_y = MEMORY[LY];
-
-    for (int dy = 0; dy < SCALE; dy++) {
-        for (int dx = 0; dx < SCALE; dx++) {
-            int x_offset = gb_x * SCALE + dx;
-            int y_offset = gb_y * SCALE + dy;
-            surface_pixels[y_offset * dist_between_rows + x_offset] = pixel_rgb;
-        }
-    }
+    FRAMEBUFFER->LINE[PPU->RENDER_X] = (palette_id << 2) | shade;
 }
 
 void lcd_free() {
     if (LCD) {
+        if (LCD->texture) {
+            SDL_DestroyTexture(LCD->texture);
+            LCD->texture = NULL;
+        }
         if (LCD->renderer) {
             SDL_DestroyRenderer(LCD->renderer);
             LCD->renderer = NULL;
@@ -192,15 +236,8 @@ void lcd_free() {
             SDL_DestroyWindow(LCD->window);
             LCD->window = NULL;
         }
-        if (LCD->surface) {
-            SDL_DestroySurface(LCD->surface);
-            LCD->surface = NULL;
-        }
-        if (LCD->texture) {
-            SDL_DestroyTexture(LCD->texture);
-            LCD->texture = NULL;
-        }
         SDL_Quit();
+        free(LCD->rgba);
         free(LCD);
     }
 }
\ No newline at end of file
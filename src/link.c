@@ -0,0 +1,124 @@
+#include <common.h>
+#include <memory.h>
+#include <serial.h>
+#include <movie.h>
+#include <gb.h>
+#include <link.h>
+
+#define PEER(player) ((player) ^ 1)
+
+/*
+ * Loads both ROMs as separate instances with their serial ports linked.
+ * The caller can select each player to attach a movie or serial capture.
+ */
+void link_init(const char* rom_a, const char* rom_b) {
+    LINK = (LINK_STRUCT*) calloc(1, sizeof(LINK_STRUCT));
+    if (!LINK) {
+        perror("Couldn't allocate link cable");
+        exit(1);
+    }
+    const char* roms[LINK_PLAYERS] = {rom_a, rom_b};
+    for (uint8_t player = 0; player < LINK_PLAYERS; player++) {
+        gb_init(roms[player]);
+        MOVIE = nullptr;
+        SERIAL->LINKED = true;
+        gb_save_instance(&LINK->PLAYERS[player]);
+    }
+    LINK->CURRENT = LINK_PLAYERS - 1;
+}
+
+void link_free() {
+    for (uint8_t player = 0; player < LINK_PLAYERS; player++) {
+        link_select(player);
+        movie_free();
+        free_resources();
+    }
+    free(LINK);
+    LINK = nullptr;
+}
+
+/*
+ * Swaps PLAYER into the globals, the core functions then act on it
+ */
+void link_select(uint8_t player) {
+    if (player == LINK->CURRENT) {
+        return;
+    }
+    gb_save_instance(&LINK->PLAYERS[LINK->CURRENT]);
+    gb_load_instance(&LINK->PLAYERS[player]);
+    LINK->CURRENT = player;
+}
+
+/*
+ * SC bit 7 is set, the port is either clocking a transfer or waiting for the peer to
+ */
+static bool port_busy(const GB_INSTANCE* instance) {
+    return instance->MEMORY[SC] & SERIAL_TRANSFER_START;
+}
+
+/*
+ * Cycle PLAYER may run up to before the other one has to catch up
+ */
+static uint64_t slice_limit(uint8_t player) {
+    const GB_INSTANCE* self = &LINK->PLAYERS[player];
+    const GB_INSTANCE* peer = &LINK->PLAYERS[PEER(player)];
+    uint64_t limit = self->SERIAL->TRANSFER_END;
+    if (peer->SERIAL->TRANSFER_END < limit) {
+        limit = peer->SERIAL->TRANSFER_END;
+    }
+    if (port_busy(self) && peer->CYCLE_COUNT + SERIAL_TRANSFER_CYCLES < limit) {
+        limit = peer->CYCLE_COUNT + SERIAL_TRANSFER_CYCLES;
+    }
+    return limit;
+}
+
+static void finish_transfer(uint8_t player, uint8_t incoming) {
+    link_select(player);
+    serial_finish_transfer(incoming);
+    gb_save_instance(&LINK->PLAYERS[player]);
+}
+
+/*
+ * Ends the internal clock transfers both instances have reached the end of.
+ * The master stopped exactly at the end, a peer that got further was not
+ * waiting there since a busy port cannot run past a transfer end.
+ */
+static void settle_transfers() {
+    for (uint8_t master = 0; master < LINK_PLAYERS; master++) {
+        const GB_INSTANCE* self = &LINK->PLAYERS[master];
+        const GB_INSTANCE* peer = &LINK->PLAYERS[PEER(master)];
+        uint64_t end = self->SERIAL->TRANSFER_END;
+        if (end == SERIAL_NO_TRANSFER || self->CYCLE_COUNT < end || peer->CYCLE_COUNT < end) {
+            continue;
+        }
+        bool waiting = peer->CYCLE_COUNT == end &&
+                       (peer->MEMORY[SC] & (SERIAL_TRANSFER_START | SERIAL_INTERNAL_CLOCK)) == SERIAL_TRANSFER_START;
+        uint8_t received = SERIAL_DISCONNECTED;
+        if (waiting) {
+            received = peer->MEMORY[SB];
+            finish_transfer(PEER(master), self->MEMORY[SB]);
+            LINK->EXCHANGES++;
+        }
+        finish_transfer(master, received);
+        LINK->MEETINGS++;
+    }
+}
+
+/*
+ * Runs both instances until each has finished one more frame. The one
+ * behind is always resumed, so at most one frame separates them.
+ */
+void link_run_frame() {
+    while (!LINK->PENDING_FRAMES[0] || !LINK->PENDING_FRAMES[1]) {
+        settle_transfers();
+        uint8_t player = LINK->PLAYERS[1].CYCLE_COUNT < LINK->PLAYERS[0].CYCLE_COUNT;
+        link_select(player);
+        LINK->SLICES++;
+        if (gb_run_until(slice_limit(player))) {
+            LINK->PENDING_FRAMES[player]++;
+        }
+        gb_save_instance(&LINK->PLAYERS[player]);
+    }
+    LINK->PENDING_FRAMES[0]--;
+    LINK->PENDING_FRAMES[1]--;
+}
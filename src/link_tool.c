@@ -0,0 +1,82 @@
+#include <common.h>
+#include <SDL3/SDL.h>
+#include <serial.h>
+#include <movie.h>
+#include <gb.h>
+#include <link.h>
+
+#define DEFAULT_FRAMES 600  //~10 emulated seconds
+
+/*
+ * Runs two ROMs headless over a link cable, or one ROM against a copy of
+ * itself, as fast as the host allows. Reports the speed of the pair and
+ * what went over the cable. Movies recorded with gb_emu --record drive
+ * either side, which makes two-player sessions reproducible.
+ */
+
+static void print_usage(const char* program) {
+    fprintf(stderr, "Usage: %s <rom_a.gb> [rom_b.gb] [options]\n", program);
+    fprintf(stderr, "  --frames <N>     frames to run both players for (default %d)\n", DEFAULT_FRAMES);
+    fprintf(stderr, "  --play-a <file>  replay recorded input on the first player\n");
+    fprintf(stderr, "  --play-b <file>  replay recorded input on the second player\n");
+}
+
+int main(int argc, char* argv[]) {
+    const char* roms[LINK_PLAYERS] = {nullptr, nullptr};
+    const char* movies[LINK_PLAYERS] = {nullptr, nullptr};
+    uint32_t frames = DEFAULT_FRAMES;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            frames = (uint32_t) strtoul(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--play-a") && i + 1 < argc) {
+            movies[0] = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--play-b") && i + 1 < argc) {
+            movies[1] = argv[++i];
+        }
+        else if (!roms[1] && argv[i][0] != '-') {
+            roms[roms[0] ? 1 : 0] = argv[i];
+        }
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!roms[0] || !frames) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (!roms[1]) {
+        roms[1] = roms[0];
+    }
+
+    link_init(roms[0], roms[1]);
+    for (uint8_t player = 0; player < LINK_PLAYERS; player++) {
+        link_select(player);
+        SERIAL->CAPTURE = true;
+        if (movies[player]) {
+            movie_init(movies[player], MOVIE_PLAY);
+        }
+    }
+
+    uint64_t start = SDL_GetTicksNS();
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        link_run_frame();
+    }
+    uint64_t elapsed_ns = SDL_GetTicksNS() - start;
+
+    double emulated_s = frames * FRAME_TIME_MS / 1000.0;
+    printf("%s <-> %s: %u frames (%.2f emulated seconds) in %.2f ms, %.1fx real time for the pair\n",
+           roms[0], roms[1], frames, emulated_s, elapsed_ns / 1e6, emulated_s * 1e9 / elapsed_ns);
+    printf("Link: %llu slices, %llu transfers ended at a meeting, %llu exchanged both ways\n",
+           (unsigned long long) LINK->SLICES, (unsigned long long) LINK->MEETINGS,
+           (unsigned long long) LINK->EXCHANGES);
+    for (uint8_t player = 0; player < LINK_PLAYERS; player++) {
+        link_select(player);
+        printf("Player %c: %llu transfers, %u bytes sent on the internal clock\n", 'A' + player,
+               (unsigned long long) SERIAL->TRANSFERS, SERIAL->SIZE);
+    }
+    link_free();
+    return 0;
+}
@@ -0,0 +1,30 @@
+#include <common.h>
+#include <machine.h>
+
+/*
+ * Allocates a zeroed machine and points the globals of the core into it,
+ * every other *_init() fills in its part afterwards
+ */
+void machine_init() {
+    MACHINE = (GB_MACHINE*) aligned_alloc(alignof(GB_MACHINE), sizeof(GB_MACHINE));
+    if (!MACHINE) {
+        perror("Couldn't allocate machine");
+        exit(1);
+    }
+    //zeroed so every run starts from the same state, movies rely on it
+    memset(MACHINE, 0, sizeof(GB_MACHINE));
+    CPU = &MACHINE->CPU;
+    INSTR_QUEUE = &MACHINE->INSTR_QUEUE;
+    PPU = &MACHINE->PPU;
+    OBJ_HEAP = &MACHINE->OBJ_HEAP;
+    MEMORY = MACHINE->MEMORY;
+    FRAMEBUFFER = &MACHINE->FRAMEBUFFER;
+    APU = &MACHINE->APU;
+    CARTRIDGE = &MACHINE->CARTRIDGE;
+    SERIAL = &MACHINE->SERIAL;
+}
+
+void machine_free() {
+    free(MACHINE);
+    MACHINE = nullptr;
+}
@@ -0,0 +1,661 @@
+#include <common.h>
+#include <limits.h>
+#include <cpu.h>
+#include <ppu.h>
+#include <lcd.h>
+#include <framebuffer.h>
+#include <triple_buffer.h>
+#include <pacer.h>
+#include <apu.h>
+#include <audio.h>
+#include <input.h>
+#include <movie.h>
+#include <capture.h>
+#include <serial.h>
+#include <profiler.h>
+#include <trace.h>
+#include <watch.h>
+#include <timeline.h>
+#include <heatmap.h>
+#include <gb.h>
+#include <link.h>
+#include <netplay.h>
+
+#define NETPLAY_CONNECT_TIMEOUT_MS 60000  //for the other player to start
+
+static const char* parse_args(int argc, char* argv[]);
+static void print_watch_stats();
+static int emulation_thread(void* UNUSED);
+
+static enum FRAME_SKIP_MODE frame_skip_mode;
+static uint8_t frame_skip_interval;
+static bool display_sync;
+static bool headless;
+static bool mute;
+static enum AUDIO_SYNC audio_sync;
+static uint32_t audio_rate;
+static enum RESAMPLE_QUALITY audio_quality;
+static uint64_t max_frames;
+static const char* capture_path;
+static enum CAPTURE_FORMAT capture_format;
+static enum CAPTURE_BACKPRESSURE capture_backpressure;
+static FILE* hash_file;
+static uint64_t hash_interval;
+static const char* serial_path;
+static bool serial_stop;
+static uint64_t max_cycles;
+static const char* profile_prefix;
+static const char* trace_path;
+static FILE* watch_log;
+static const char* timeline_path;
+static const char* heatmap_path;
+static const char* record_path;
+static const char* play_path;
+static const char* netplay_peer;
+static const char* netplay_rom;
+static uint16_t netplay_port;
+static uint8_t netplay_player;
+static uint32_t netplay_delay_ms;
+static uint8_t netplay_loss;
+
+
+/*
+ * Frees what the frontend created on top of the emulator core
+ */
+static void free_frontend() {
+    if (!headless) {
+        triple_buffer_free();
+        pacer_free();
+        input_free();
+    }
+    audio_free();
+    movie_free();
+    capture_free();
+    trace_free();
+    timeline_free();
+    heatmap_free();
+    if (hash_file) {
+        fclose(hash_file);
+    }
+    if (watch_log) {
+        fclose(watch_log);
+    }
+    lcd_free();
+}
+
+/*
+ * Main function loop
+ * Initializes memory and CPU, then executes instructions on the emulation
+ * thread while the main thread presents frames. Headless runs execute on the main thread.
+ */
+int main(int argc, char* argv[]) {
+    const char* rom = parse_args(argc, argv);
+    if (netplay_peer) {
+        link_init(rom, netplay_rom ? netplay_rom : rom);
+        netplay_init(netplay_player, netplay_port, netplay_peer);
+        netplay_simulate(netplay_delay_ms, netplay_loss);
+        printf("Waiting for player %u at %s\n", (netplay_player ^ 1) + 1, netplay_peer);
+        if (!netplay_connect(NETPLAY_CONNECT_TIMEOUT_MS)) {
+            fprintf(stderr, "No answer from %s\n", netplay_peer);
+            exit(1);
+        }
+    }
+    else {
+        gb_init(rom);
+    }
+    SERIAL->CAPTURE = serial_path != nullptr;
+    SERIAL->STOP_ON_RESULT = serial_stop;
+    if (record_path) {
+        movie_init(record_path, MOVIE_RECORD);
+    }
+    else if (play_path) {
+        movie_init(play_path, MOVIE_PLAY);
+    }
+    framebuffer_set_frame_skip(frame_skip_mode, frame_skip_interval);
+    lcd_init(headless);
+    if (!headless && !mute && audio_init(audio_sync, audio_rate)) {
+        apu_start_sound(audio_rate, audio_quality);
+    }
+    if (capture_path) {
+        capture_init(capture_path, capture_format, capture_backpressure);
+    }
+    if (trace_path) {
+        trace_init(trace_path);
+    }
+    if (timeline_path) {
+        timeline_init();
+    }
+    if (heatmap_path) {
+        heatmap_init(heatmap_path);
+    }
+
+    if (headless) {
+        //nothing to present, frames run unthrottled on the main thread
+        emulation_thread(nullptr);
+    }
+    else {
+        triple_buffer_init();
+        input_init();
+        uint64_t period_num = (uint64_t) CYCLES_PER_FRAME * 1000000000ULL;
+        uint64_t period_den = (uint64_t) CLOCK_FREQ;
+        if (display_sync && !lcd_display_sync(&period_num, &period_den)) {
+            fprintf(stderr, "Display refresh rate is not close to 59.73 Hz, pacing on the emulator clock\n");
+        }
+        pacer_init(period_num, period_den);
+
+        SDL_Thread* emulation = SDL_CreateThread(emulation_thread, "emulation", nullptr);
+        if (!emulation) {
+            fprintf(stderr, "Error creating emulation thread: %s\n", SDL_GetError());
+            exit(1);
+        }
+        lcd_render_loop();
+        SDL_WaitThread(emulation, nullptr);
+        triple_buffer_print_stats();
+        input_print_stats();
+        if (!AUDIO || AUDIO->SYNC != SYNC_AUDIO) {
+            pacer_print_stats();
+        }
+        if (AUDIO) {
+            audio_print_stats();
+        }
+        if (NETPLAY) {
+            netplay_print_stats();
+        }
+    }
+    if (CAPTURE) {
+        capture_finish();
+        capture_print_stats();
+    }
+    if (TRACE) {
+        trace_finish();
+        trace_print_stats();
+    }
+    print_watch_stats();
+    if (TIMELINE) {
+        timeline_write(timeline_path);
+    }
+    if (HEATMAP) {
+        heatmap_print_summary();
+    }
+
+    //test ROM runs report their result through the exit code
+    int exit_code = 0;
+    if (serial_path) {
+        serial_save(serial_path);
+        exit_code = SERIAL->RESULT == SERIAL_PASSED ? SERIAL_EXIT_PASSED :
+                    SERIAL->RESULT == SERIAL_FAILED ? SERIAL_EXIT_FAILED : SERIAL_EXIT_TIMEOUT;
+    }
+#ifdef GB_PROFILE
+    profiler_write_report(profile_prefix ? profile_prefix : rom);
+#endif
+    free_frontend();
+    if (NETPLAY) {
+        netplay_free();
+        link_free();
+    }
+    else {
+        free_resources();
+    }
+    return exit_code;
+}
+
+/*
+ * Runs the emulator one frame at a time and hands finished frames to the
+ * render thread and the capture ring
+ */
+static int emulation_thread(void* UNUSED) {
+    (void)UNUSED;
+    uint64_t frames = 0;
+    while (LCD->is_running) {
+        uint64_t frame_start = SDL_GetPerformanceCounter();
+
+        //a netplay frame does not run while the remote input is too far behind
+        bool ran = true;
+        if (NETPLAY) {
+            uint8_t buttons;
+            uint8_t d_pad;
+            input_poll(&buttons, &d_pad);
+            TIMELINE_HOST_BEGIN(TRACK_EMULATION_THREAD, "netplay_run_frame");
+            ran = netplay_run_frame(buttons, d_pad);
+            TIMELINE_HOST_END(TRACK_EMULATION_THREAD);
+        }
+        else {
+            if (INPUT) {
+                input_begin_frame();
+            }
+            //the cycle limit and a serial result stop the run at their M-cycle, not at the end of the frame
+            TIMELINE_HOST_BEGIN(TRACK_EMULATION_THREAD, "run_frame");
+            ran = gb_run_until(max_cycles ? max_cycles : ULLONG_MAX);
+            TIMELINE_HOST_END(TRACK_EMULATION_THREAD);
+            if (INPUT) {
+                input_end_frame();
+            }
+            if (!ran) {
+                LCD->is_running = false;
+            }
+        }
+        if (ran) {
+            if (AUDIO) {
+                audio_push();
+            }
+            if (CAPTURE) {
+                capture_push(&FRAMEBUFFER->FRAME);
+            }
+            if (!headless && FRAMEBUFFER->STATUS == FRAME_RENDERED && framebuffer_frame_dirty()) {
+                triple_buffer_publish(&FRAMEBUFFER->FRAME);
+            }
+            frames++;
+            if (hash_file && frames % hash_interval == 0 && FRAMEBUFFER->STATUS == FRAME_RENDERED) {
+                fprintf(hash_file, "%llu %016llx\n", (unsigned long long) frames,
+                        (unsigned long long) frame_hash(&FRAMEBUFFER->FRAME));
+            }
+            if ((max_frames && frames == max_frames) || (max_cycles && CYCLE_COUNT >= max_cycles) ||
+                (serial_stop && SERIAL->RESULT != SERIAL_RUNNING) || (!max_frames && MOVIE && movie_finished())) {
+                LCD->is_running = false;
+            }
+        }
+
+        uint64_t frame_end = SDL_GetPerformanceCounter();
+        double elapsed_ms = (double)(frame_end - frame_start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+        PPU->SKIP_RENDER = framebuffer_next_frame(elapsed_ms, FRAME_TIME_MS) == FRAME_SKIPPED;
+
+        //frame limiter
+        if (!headless) {
+            TIMELINE_HOST_BEGIN(TRACK_EMULATION_THREAD, "frame limiter");
+            if (AUDIO && AUDIO->SYNC == SYNC_AUDIO) {
+                audio_wait();
+            }
+            else {
+                pacer_wait_next_frame();
+            }
+            TIMELINE_HOST_END(TRACK_EMULATION_THREAD);
+        }
+    }
+    return 0;
+}
+
+static void log_watch_hit(const WATCH_HIT* hit, void* UNUSED) {
+    (void)UNUSED;
+    if (watch_log) {
+        char type = hit->TYPE == WATCH_READ ? 'r' : hit->TYPE == WATCH_WRITE ? 'w' : 'x';
+        fprintf(watch_log, "%llu %04X %c %04X %02X\n", (unsigned long long) hit->CYCLE, hit->PC, type, hit->ADDRESS, hit->VALUE);
+    }
+}
+
+static void print_watch_stats() {
+    for (uint8_t id = 0; id < WATCH_MAX; id++) {
+        const WATCHPOINT* watch = &WATCHPOINTS[id];
+        if (watch->ACTIVE) {
+            printf("Watch %s%s%s %04X-%04X: %llu hits\n", watch->TYPES & WATCH_READ ? "r" : "",
+                   watch->TYPES & WATCH_WRITE ? "w" : "", watch->TYPES & WATCH_EXECUTE ? "x" : "",
+                   watch->START, watch->END, (unsigned long long) watch->HITS);
+        }
+    }
+}
+
+/*
+ * Parses TEXT as a decimal number from MIN to MAX, returns false for anything
+ * else so a typo is reported instead of silently meaning 0
+ */
+static bool parse_number(const char* text, unsigned long long min, unsigned long long max, unsigned long long* value) {
+    if (*text < '0' || *text > '9') {
+        return false;
+    }
+    char* end;
+    unsigned long long number = strtoull(text, &end, 10);
+    //ULLONG_MAX is also what strtoull() gives on overflow
+    if (*end || number == ULLONG_MAX || number < min || number > max) {
+        return false;
+    }
+    *value = number;
+    return true;
+}
+
+/*
+ * Adds the watchpoint described by SPEC, [rwx]+:START[-END] with hex addresses
+ */
+static bool parse_watch(const char* spec) {
+    uint8_t types = 0;
+    for (; *spec && *spec != ':'; spec++) {
+        switch (*spec) {
+            case 'r':
+                types |= WATCH_READ;
+                break;
+            case 'w':
+                types |= WATCH_WRITE;
+                break;
+            case 'x':
+                types |= WATCH_EXECUTE;
+                break;
+            default:
+                return false;
+        }
+    }
+    if (!types || *spec != ':') {
+        return false;
+    }
+    char* end;
+    unsigned long start = strtoul(spec + 1, &end, 16);
+    unsigned long last = start;
+    if (*end == '-') {
+        last = strtoul(end + 1, &end, 16);
+    }
+    if (*end || start > 0xFFFF || last > 0xFFFF) {
+        return false;
+    }
+    return watch_add((uint16_t) start, (uint16_t) last, types, log_watch_hit, nullptr) >= 0;
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr, "Usage: %s <rom.gb> [options]\n", program);
+    fprintf(stderr, "  --frameskip <N|auto|all>  render one frame out of every N + 1, skip frames\n");
+    fprintf(stderr, "                            when behind the frame-time budget, or never render\n");
+    fprintf(stderr, "  --vsync                   present on vertical sync and pace to the display refresh\n");
+    fprintf(stderr, "                            rate when it is within 0.5%% of 59.73 Hz\n");
+    fprintf(stderr, "  --headless                run without a window or sound as fast as possible\n");
+    fprintf(stderr, "  --mute                    do not open an audio device or synthesize sound\n");
+    fprintf(stderr, "  --sync <timer|audio>      pace frames with the frame timer (default) or by waiting for\n");
+    fprintf(stderr, "                            the audio queue to drain, which runs on the sound card clock\n");
+    fprintf(stderr, "  --audio-rate <Hz>         output sample rate, 48000 (default), 44100 or any rate from %d to %d\n",
+            APU_MIN_OUTPUT_RATE, APU_MAX_OUTPUT_RATE);
+    fprintf(stderr, "  --audio-quality <box|low|medium|high>\n");
+    fprintf(stderr, "                            resampling filter, from a box average to a 16 zero crossing\n");
+    fprintf(stderr, "                            windowed sinc (default medium)\n");
+    fprintf(stderr, "  --frames <N>              quit after N frames\n");
+    fprintf(stderr, "  --record <file>           record every joypad change with its cycle to a movie\n");
+    fprintf(stderr, "  --play <file>             replay a movie headless at full speed, until its last frame\n");
+    fprintf(stderr, "                            unless --frames is given\n");
+    fprintf(stderr, "  --capture <file>          record every frame to a file or named pipe\n");
+    fprintf(stderr, "  --capture-format <y4m|raw>\n");
+    fprintf(stderr, "                            Y4M video (default) or raw indexed frames\n");
+    fprintf(stderr, "  --capture-backpressure <drop|block>\n");
+    fprintf(stderr, "                            drop frames (default) or wait when the writer falls behind\n");
+    fprintf(stderr, "  --hash <file>             write the frame number and 64-bit hash of rendered frames\n");
+    fprintf(stderr, "  --hash-interval <N>       only hash every Nth frame\n");
+    fprintf(stderr, "  --serial-out <file>       keep serial output in memory and write it to a file at exit,\n");
+    fprintf(stderr, "                            the exit code is %d if a test ROM passed, %d if it failed and %d if\n",
+            SERIAL_EXIT_PASSED, SERIAL_EXIT_FAILED, SERIAL_EXIT_TIMEOUT);
+    fprintf(stderr, "                            it reported nothing, 1 stays an emulator error\n");
+    fprintf(stderr, "  --serial-stop             quit once a test ROM reports its result over serial\n");
+    fprintf(stderr, "  --max-cycles <N>          quit after N CPU M-cycles\n");
+    fprintf(stderr, "  --profile <prefix>        write the profile to <prefix>.profile and <prefix>.folded\n");
+    fprintf(stderr, "                            instead of next to the ROM, needs a GB_PROFILE build\n");
+    fprintf(stderr, "  --trace <file>            stream every executed instruction to a binary trace,\n");
+    fprintf(stderr, "                            read it with gb_trace, needs a GB_TRACE build\n");
+    fprintf(stderr, "  --watch <[rwx]:start[-end]>\n");
+    fprintf(stderr, "                            count reads, writes or executions of a hex address range,\n");
+    fprintf(stderr, "                            can be given up to %d times\n", WATCH_MAX);
+    fprintf(stderr, "  --watch-log <file>        write every watchpoint hit as cycle, PC, type, address, value\n");
+    fprintf(stderr, "  --timeline <file>         write PPU modes, interrupts, OAM DMA, HALT and host work as\n");
+    fprintf(stderr, "                            Chrome trace JSON, needs a GB_TIMELINE build\n");
+    fprintf(stderr, "  --heatmap <file>          write reads and writes per 256-byte page, source and bank for\n");
+    fprintf(stderr, "                            every frame, print the hottest pages at exit, needs a GB_HEATMAP build\n");
+    fprintf(stderr, "  --netplay <host:port>     play against another gb_emu over UDP, with a window\n");
+    fprintf(stderr, "  --player <1|2>            player this window controls (default 1), the other side takes the other\n");
+    fprintf(stderr, "  --netplay-port <N>        local UDP port (default %d)\n", NETPLAY_DEFAULT_PORT);
+    fprintf(stderr, "  --netplay-rom <file>      player 2's ROM when it differs, both sides give the same ROMs\n");
+    fprintf(stderr, "  --netplay-delay <ms>      hold every packet sent back this long, for testing\n");
+    fprintf(stderr, "  --netplay-loss <percent>  drop this share of the packets sent, for testing\n");
+}
+
+/*
+ * Reads command line options and returns the ROM file name
+ */
+static const char* parse_args(int argc, char* argv[]) {
+    const char* rom = nullptr;
+    frame_skip_mode = FRAME_SKIP_OFF;
+    frame_skip_interval = 0;
+    display_sync = false;
+    headless = false;
+    mute = false;
+    audio_sync = SYNC_TIMER;
+    audio_rate = APU_OUTPUT_RATE;
+    audio_quality = RESAMPLE_MEDIUM;
+    max_frames = 0;
+    capture_path = nullptr;
+    capture_format = CAPTURE_Y4M;
+    capture_backpressure = CAPTURE_DROP;
+    hash_file = nullptr;
+    hash_interval = 1;
+    serial_path = nullptr;
+    serial_stop = false;
+    max_cycles = 0;
+    profile_prefix = nullptr;
+    trace_path = nullptr;
+    watch_log = nullptr;
+    timeline_path = nullptr;
+    heatmap_path = nullptr;
+    record_path = nullptr;
+    play_path = nullptr;
+    netplay_peer = nullptr;
+    netplay_rom = nullptr;
+    netplay_port = NETPLAY_DEFAULT_PORT;
+    netplay_player = 0;
+    netplay_delay_ms = 0;
+    netplay_loss = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--frameskip") && i + 1 < argc) {
+            const char* value = argv[++i];
+            if (!strcmp(value, "auto")) {
+                frame_skip_mode = FRAME_SKIP_AUTO;
+            }
+            else if (!strcmp(value, "all")) {
+                frame_skip_mode = FRAME_SKIP_ALL;
+            }
+            else {
+                char* end;
+                long interval = strtol(value, &end, 10);
+                if (end == value || *end || interval < 0 || interval > UINT8_MAX) {
+                    print_usage(argv[0]);
+                    exit(1);
+                }
+                frame_skip_mode = interval ? FRAME_SKIP_FIXED : FRAME_SKIP_OFF;
+                frame_skip_interval = (uint8_t) interval;
+            }
+        }
+        else if (!strcmp(argv[i], "--vsync")) {
+            display_sync = true;
+        }
+        else if (!strcmp(argv[i], "--headless")) {
+            headless = true;
+        }
+        else if (!strcmp(argv[i], "--mute")) {
+            mute = true;
+        }
+        else if (!strcmp(argv[i], "--sync") && i + 1 < argc) {
+            const char* value = argv[++i];
+            if (!strcmp(value, "timer")) {
+                audio_sync = SYNC_TIMER;
+            }
+            else if (!strcmp(value, "audio")) {
+                audio_sync = SYNC_AUDIO;
+            }
+            else {
+                print_usage(argv[0]);
+                exit(1);
+            }
+        }
+        else if (!strcmp(argv[i], "--audio-rate") && i + 1 < argc) {
+            unsigned long long value;
+            if (!parse_number(argv[++i], APU_MIN_OUTPUT_RATE, APU_MAX_OUTPUT_RATE, &value)) {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            audio_rate = (uint32_t) value;
+        }
+        else if (!strcmp(argv[i], "--audio-quality") && i + 1 < argc) {
+            if (!resampler_parse_quality(argv[++i], &audio_quality)) {
+                print_usage(argv[0]);
+                exit(1);
+            }
+        }
+        else if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            unsigned long long value;
+            if (!parse_number(argv[++i], 1, ULLONG_MAX, &value)) {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            max_frames = value;
+        }
+        else if (!strcmp(argv[i], "--record") && i + 1 < argc) {
+            record_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--play") && i + 1 < argc) {
+            play_path = argv[++i];
+            headless = true;
+        }
+        else if (!strcmp(argv[i], "--capture") && i + 1 < argc) {
+            capture_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--hash") && i + 1 < argc) {
+            hash_file = fopen(argv[++i], "w");
+            if (!hash_file) {
+                perror("Couldn't open hash file");
+                exit(1);
+            }
+        }
+        else if (!strcmp(argv[i], "--hash-interval") && i + 1 < argc) {
+            hash_interval = strtoull(argv[++i], nullptr, 10);
+            if (!hash_interval) {
+                print_usage(argv[0]);
+                exit(1);
+            }
+        }
+        else if (!strcmp(argv[i], "--serial-out") && i + 1 < argc) {
+            serial_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--serial-stop")) {
+            serial_stop = true;
+        }
+        else if (!strcmp(argv[i], "--max-cycles") && i + 1 < argc) {
+            unsigned long long value;
+            if (!parse_number(argv[++i], 1, ULLONG_MAX, &value)) {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            max_cycles = value;
+        }
+        else if (!strcmp(argv[i], "--profile") && i + 1 < argc) {
+#ifndef GB_PROFILE
+            fprintf(stderr, "--profile needs a build configured with -DGB_PROFILE=ON\n");
+            exit(1);
+#endif
+            profile_prefix = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--trace") && i + 1 < argc) {
+#ifndef GB_TRACE
+            fprintf(stderr, "--trace needs a build configured with -DGB_TRACE=ON\n");
+            exit(1);
+#endif
+            trace_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--timeline") && i + 1 < argc) {
+#ifndef GB_TIMELINE
+            fprintf(stderr, "--timeline needs a build configured with -DGB_TIMELINE=ON\n");
+            exit(1);
+#endif
+            timeline_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--heatmap") && i + 1 < argc) {
+#ifndef GB_HEATMAP
+            fprintf(stderr, "--heatmap needs a build configured with -DGB_HEATMAP=ON\n");
+            exit(1);
+#endif
+            heatmap_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--watch") && i + 1 < argc) {
+            if (!parse_watch(argv[++i])) {
+                print_usage(argv[0]);
+                exit(1);
+            }
+        }
+        else if (!strcmp(argv[i], "--watch-log") && i + 1 < argc) {
+            watch_log = fopen(argv[++i], "w");
+            if (!watch_log) {
+                perror("Couldn't open watch log");
+                exit(1);
+            }
+        }
+        else if (!strcmp(argv[i], "--capture-format") && i + 1 < argc) {
+            const char* value = argv[++i];
+            if (!strcmp(value, "y4m")) {
+                capture_format = CAPTURE_Y4M;
+            }
+            else if (!strcmp(value, "raw")) {
+                capture_format = CAPTURE_RAW;
+            }
+            else {
+                print_usage(argv[0]);
+                exit(1);
+            }
+        }
+        else if (!strcmp(argv[i], "--capture-backpressure") && i + 1 < argc) {
+            const char* value = argv[++i];
+            if (!strcmp(value, "drop")) {
+                capture_backpressure = CAPTURE_DROP;
+            }
+            else if (!strcmp(value, "block")) {
+                capture_backpressure = CAPTURE_BLOCK;
+            }
+            else {
+                print_usage(argv[0]);
+                exit(1);
+            }
+        }
+        else if (!strcmp(argv[i], "--netplay") && i + 1 < argc) {
+            netplay_peer = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--player") && i + 1 < argc) {
+            unsigned long long value;
+            if (!parse_number(argv[++i], 1, LINK_PLAYERS, &value)) {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            netplay_player = (uint8_t) (value - 1);
+        }
+        else if (!strcmp(argv[i], "--netplay-port") && i + 1 < argc) {
+            unsigned long long value;
+            if (!parse_number(argv[++i], 1, UINT16_MAX, &value)) {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            netplay_port = (uint16_t) value;
+        }
+        else if (!strcmp(argv[i], "--netplay-rom") && i + 1 < argc) {
+            netplay_rom = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--netplay-delay") && i + 1 < argc) {
+            unsigned long long value;
+            if (!parse_number(argv[++i], 0, UINT32_MAX, &value)) {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            netplay_delay_ms = (uint32_t) value;
+        }
+        else if (!strcmp(argv[i], "--netplay-loss") && i + 1 < argc) {
+            unsigned long long value;
+            if (!parse_number(argv[++i], 0, 99, &value)) {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            netplay_loss = (uint8_t) value;
+        }
+        else if (argv[i][0] != '-' && !rom) {
+            rom = argv[i];
+        }
+        else {
+            print_usage(argv[0]);
+            exit(1);
+        }
+    }
+    if (!rom || (record_path && play_path)) {
+        print_usage(argv[0]);
+        exit(1);
+    }
+    if (netplay_peer && (headless || record_path)) {
+        //rollbacks run frames again, which a movie would record twice
+        fprintf(stderr, "--netplay needs a window and cannot be combined with --record, gb_netplay runs headless\n");
+        exit(1);
+    }
+    return rom;
+}
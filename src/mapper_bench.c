@@ -0,0 +1,219 @@
+#include <common.h>
+#include <SDL3/SDL.h>
+#include <cpu.h>
+#include <memory.h>
+#include <gb.h>
+
+#define DEFAULT_ACCESSES 10000000
+#define DEFAULT_LOADS 20
+#define CART_TYPE_ADDRESS 0x0147
+#define ROM_SIZE_ADDRESS 0x0148
+#define RAM_SIZE_ADDRESS 0x0149
+#define RTC_CYCLES_PER_LATCH 1048576    //a second of emulated time between latches
+
+/*
+ * Cartridge mapper benchmark. For every supported mapper a ROM of the largest
+ * size it addresses is built in memory, with every bank holding its own
+ * number. It times loading that ROM through gb_init_rom(), then calls
+ * read_memory() and write_memory() directly on the cartridge areas: reads of
+ * both ROM windows and of cartridge RAM, RAM writes, ROM bank switches and,
+ * on MBC3, clock latches. Bank switches hop between banks so every one
+ * remaps a window.
+ */
+
+typedef struct MAPPER {
+    const char* NAME;
+    uint8_t CART_TYPE;
+    uint8_t ROM_SIZE_CODE;          //header value, 2 << code banks
+    uint8_t RAM_SIZE_CODE;
+    uint16_t ROM_BANK_REGISTER;     //address a bank switch writes to
+} MAPPER;
+
+static const MAPPER MAPPERS[] = {
+    {"rom", 0x00, 0, 0, 0x2000},
+    {"mbc1", 0x03, 6, 3, 0x2000},
+    {"mbc2", 0x06, 3, 0, 0x2100},
+    {"mbc3", 0x10, 6, 3, 0x2000},
+    {"mbc5", 0x1B, 8, 4, 0x2000},
+};
+
+#define NUM_MAPPERS (sizeof(MAPPERS) / sizeof(MAPPERS[0]))
+
+enum ACCESS {
+    ACCESS_ROM0_READ,
+    ACCESS_ROMX_READ,
+    ACCESS_RAM_READ,
+    ACCESS_RAM_WRITE,
+    ACCESS_BANK_SWITCH,
+    ACCESS_RTC_LATCH,
+    NUM_ACCESSES
+};
+
+static const char* ACCESS_NAMES[NUM_ACCESSES] = {"ROM0 RD", "ROMX RD", "RAM RD", "RAM WR", "BANK SW", "RTC LATCH"};
+
+static uint8_t* build_rom(const MAPPER* mapper, uint32_t* size) {
+    uint32_t banks = 2 << mapper->ROM_SIZE_CODE;
+    *size = banks * ROM_BANK_SIZE;
+    uint8_t* rom = calloc(*size, sizeof(uint8_t));
+    if (!rom) {
+        perror("Couldn't allocate ROM");
+        exit(1);
+    }
+    for (uint32_t bank = 0; bank < banks; bank++) {
+        memset(rom + bank * ROM_BANK_SIZE, (uint8_t) bank, ROM_BANK_SIZE);
+    }
+    rom[CART_TYPE_ADDRESS] = mapper->CART_TYPE;
+    rom[ROM_SIZE_ADDRESS] = mapper->ROM_SIZE_CODE;
+    rom[RAM_SIZE_ADDRESS] = mapper->RAM_SIZE_CODE;
+    return rom;
+}
+
+static void write_byte(uint16_t address, uint8_t value) {
+    CPU->ADDRESS_BUS = address;
+    CPU->DATA_BUS = value;
+    write_memory(UNUSED_VAL);
+}
+
+/*
+ * Runs ACCESSES accesses of one kind and returns the ns each took
+ */
+static double bench_access(const MAPPER* mapper, enum ACCESS access, uint32_t accesses) {
+    uint32_t sink = 0;
+    uint64_t start = SDL_GetTicksNS();
+    for (uint32_t i = 0; i < accesses; i++) {
+        switch (access) {
+            case ACCESS_ROM0_READ:
+                CPU->ADDRESS_BUS = i & 0x3FFF;
+                read_memory(UNUSED_VAL);
+                sink += CPU->DATA_BUS;
+                break;
+            case ACCESS_ROMX_READ:
+                CPU->ADDRESS_BUS = 0x4000 | (i & 0x3FFF);
+                read_memory(UNUSED_VAL);
+                sink += CPU->DATA_BUS;
+                break;
+            case ACCESS_RAM_READ:
+                CPU->ADDRESS_BUS = 0xA000 | (i & 0x1FFF);
+                read_memory(UNUSED_VAL);
+                sink += CPU->DATA_BUS;
+                break;
+            case ACCESS_RAM_WRITE:
+                write_byte(0xA000 | (i & 0x1FFF), (uint8_t) i);
+                break;
+            case ACCESS_BANK_SWITCH:
+                //odd steps through the banks so consecutive switches never pick the same one
+                write_byte(mapper->ROM_BANK_REGISTER, (uint8_t) (i * 7 + 1));
+                break;
+            default:
+                CYCLE_COUNT += RTC_CYCLES_PER_LATCH;
+                write_byte(0x6000, 0x00);
+                write_byte(0x6000, 0x01);
+                break;
+        }
+    }
+    uint64_t elapsed_ns = SDL_GetTicksNS() - start;
+    if (sink == UINT32_MAX) {
+        printf(" ");    //keeps the reads from being optimized out
+    }
+    return (double) elapsed_ns / accesses;
+}
+
+/*
+ * Returns the µs one gb_init_rom() of ROM takes, the fastest of LOADS
+ */
+static double bench_load(const uint8_t* rom, uint32_t size, uint32_t loads) {
+    uint64_t best_ns = UINT64_MAX;
+    for (uint32_t i = 0; i < loads; i++) {
+        uint64_t start = SDL_GetTicksNS();
+        gb_init_rom(rom, size);
+        uint64_t elapsed_ns = SDL_GetTicksNS() - start;
+        if (elapsed_ns < best_ns) {
+            best_ns = elapsed_ns;
+        }
+        free_resources();
+    }
+    return best_ns / 1e3;
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr, "Usage: %s [options]\n", program);
+    fprintf(stderr, "  --accesses <N>   accesses timed per kind (default %d)\n", DEFAULT_ACCESSES);
+    fprintf(stderr, "  --loads <N>      ROM loads timed, the fastest is kept (default %d)\n", DEFAULT_LOADS);
+    fprintf(stderr, "  --mapper <name>  only run one of rom, mbc1, mbc2, mbc3, mbc5\n");
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t accesses = DEFAULT_ACCESSES;
+    uint32_t loads = DEFAULT_LOADS;
+    const char* only = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--accesses") && i + 1 < argc) {
+            accesses = (uint32_t) strtoul(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--loads") && i + 1 < argc) {
+            loads = (uint32_t) strtoul(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--mapper") && i + 1 < argc) {
+            only = argv[++i];
+        }
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!accesses || !loads) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    double load_us[NUM_MAPPERS];
+    double access_ns[NUM_MAPPERS][NUM_ACCESSES];
+    uint32_t rom_kib[NUM_MAPPERS];
+    bool ran[NUM_MAPPERS] = {false};
+    for (size_t m = 0; m < NUM_MAPPERS; m++) {
+        const MAPPER* mapper = &MAPPERS[m];
+        if (only && strcmp(only, mapper->NAME)) {
+            continue;
+        }
+        uint32_t size;
+        uint8_t* rom = build_rom(mapper, &size);
+        rom_kib[m] = size / 1024;
+        load_us[m] = bench_load(rom, size, loads);
+
+        gb_init_rom(rom, size);
+        write_byte(0x0000, 0x0A);   //RAM and clock enable
+        for (uint8_t a = 0; a < NUM_ACCESSES; a++) {
+            if (a == ACCESS_RTC_LATCH && !CARTRIDGE->HAS_RTC) {
+                access_ns[m][a] = -1;
+                continue;
+            }
+            access_ns[m][a] = bench_access(mapper, a, accesses);
+        }
+        free_resources();
+        free(rom);
+        ran[m] = true;
+    }
+
+    printf("%u accesses per kind, fastest of %u loads\n", accesses, loads);
+    printf("%-6s %9s %9s", "MAPPER", "ROM KIB", "LOAD US");
+    for (uint8_t a = 0; a < NUM_ACCESSES; a++) {
+        printf(" %9s", ACCESS_NAMES[a]);
+    }
+    printf("   (ns per access)\n");
+    for (size_t m = 0; m < NUM_MAPPERS; m++) {
+        if (!ran[m]) {
+            continue;
+        }
+        printf("%-6s %9u %9.1f", MAPPERS[m].NAME, rom_kib[m], load_us[m]);
+        for (uint8_t a = 0; a < NUM_ACCESSES; a++) {
+            if (access_ns[m][a] < 0) {
+                printf(" %9s", "-");
+            }
+            else {
+                printf(" %9.2f", access_ns[m][a]);
+            }
+        }
+        printf("\n");
+    }
+    return 0;
+}
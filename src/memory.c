@@ -1,133 +1,280 @@
 #include <common.h>
 #include <cpu.h>
 #include <gb.h>
-#include <lcd.h>
+#include <input.h>
+#include <movie.h>
 #include <memory.h>
+#include <serial.h>
+#include <apu.h>
+#include <watch.h>
+#include <heatmap.h>
 
-void ram_enable() {
-    CARTRIDGE->RAM_ENABLE = (CPU->DATA_BUS & 0x0F) == 0x0A;
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#define RTC_CYCLES_PER_SECOND 1048576   //M-cycles
+#define RTC_SECONDS_PER_DAY 86400
+#define RTC_MAX_DAYS 512
+#define RTC_FIRST_REGISTER 0x08         //RAM bank values 0x08-0x0C select the clock registers
+#define RTC_DAY_HIGH 4
+#define RTC_HALT_BIT 0x40
+#define RTC_CARRY_BIT 0x80
+
+///////////////////////////////////////// BANK WINDOWS /////////////////////////////////////////
+
+/*
+ * Points the windows at 0x0000 and 0x4000 at ROM banks LOW and HIGH, the bank
+ * numbers wrap at the size of the ROM like the unconnected address lines do
+ */
+static void map_rom(uint32_t low, uint32_t high) {
+    CARTRIDGE->ROM_MAP[0] = CARTRIDGE->ROM + (low & (CARTRIDGE->NUM_ROM_BANKS - 1)) * ROM_BANK_SIZE;
+    CARTRIDGE->ROM_MAP[1] = CARTRIDGE->ROM + (high & (CARTRIDGE->NUM_ROM_BANKS - 1)) * ROM_BANK_SIZE;
 }
 
-static void set_rom_bank() {
-    uint8_t bank_num = CPU->DATA_BUS & 0x1F;
-    if (bank_num == 0) {
-        bank_num = 1;
-    }
-    if (bank_num > CARTRIDGE->NUM_ROM_BANKS) {
-        uint8_t mask = 0x01;
-        //TODO might work with cartidge->rom_size - 1
-        for (uint8_t bit = 0x04; bit <= 0x10; bit = bit << 1) {
-            if (!(CARTRIDGE->NUM_ROM_BANKS & bit)) {
-                break;
-            }
-            mask = (mask << 1) | 0x01;
-        }
-        bank_num &= mask;
+/*
+ * Points the window at 0xA000 at RAM bank BANK, or unmaps it while the RAM is
+ * disabled. RAM smaller than a bank repeats over the window.
+ */
+static void map_ram(uint32_t bank) {
+    if (!CARTRIDGE->RAM_ENABLE || !CARTRIDGE->RAM_SIZE) {
+        CARTRIDGE->RAM_MAP = nullptr;
+        return;
     }
-    if (bank_num == 0x00 || bank_num == 0x20 || bank_num == 0x40 || bank_num == 0x60) {
-        bank_num++;
+    if (CARTRIDGE->RAM_SIZE < RAM_BANK_SIZE) {
+        CARTRIDGE->RAM_MAP = CARTRIDGE->RAM;
+        CARTRIDGE->RAM_MASK = CARTRIDGE->RAM_SIZE - 1;
+        return;
     }
-    CARTRIDGE->CART_ROM_BANK = bank_num;
+    CARTRIDGE->RAM_MAP = CARTRIDGE->RAM + (bank & (CARTRIDGE->RAM_SIZE / RAM_BANK_SIZE - 1)) * RAM_BANK_SIZE;
+    CARTRIDGE->RAM_MASK = RAM_BANK_SIZE - 1;
 }
 
-static void set_RAM_UPPER_ROM() {
-    CARTRIDGE->RAM_UPPER_ROM = CPU->DATA_BUS & 0x03;
+static void ram_enable() {
+    CARTRIDGE->RAM_ENABLE = (CPU->DATA_BUS & 0x0F) == 0x0A;
 }
 
-static void set_banking_mode() {
-    CARTRIDGE->BANK_MODE = (bool) CPU->DATA_BUS;
+///////////////////////////////////////// MBC1 /////////////////////////////////////////
+
+/*
+ * The two bit register reaches ROM address lines 19-20 on carts of 64 banks or
+ * more, and RAM bank lines otherwise. In mode 1 it also applies to bank 0's
+ * window and to the RAM.
+ */
+static void mbc1_remap() {
+    uint32_t upper = CARTRIDGE->RAM_UPPER_ROM << 5;
+    map_rom(CARTRIDGE->BANK_MODE ? upper : 0, upper | CARTRIDGE->CART_ROM_BANK);
+    map_ram(CARTRIDGE->BANK_MODE ? CARTRIDGE->RAM_UPPER_ROM : 0);
 }
 
-static void read_bank_00() {
-    if (!CARTRIDGE->BANK_MODE) {
-        CPU->DATA_BUS = CARTRIDGE->ROM[CPU->ADDRESS_BUS];
+static void mbc1_write_register(uint16_t address) {
+    if (address < 0x2000) {
+        ram_enable();
+    }
+    else if (address < 0x4000) {
+        //0 is checked before the bank wraps, so small carts can still map bank 0 here
+        CARTRIDGE->CART_ROM_BANK = CPU->DATA_BUS & 0x1F ? CPU->DATA_BUS & 0x1F : 1;
     }
-    else if (CARTRIDGE->NUM_ROM_BANKS >= 64) {
-        CPU->DATA_BUS = CARTRIDGE->ROM[(CARTRIDGE->RAM_UPPER_ROM << 19) | CPU->ADDRESS_BUS];
+    else if (address < 0x6000) {
+        CARTRIDGE->RAM_UPPER_ROM = CPU->DATA_BUS & 0x03;
     }
     else {
-        perror("Error in read bank 00");
+        CARTRIDGE->BANK_MODE = CPU->DATA_BUS & 0x01;
     }
+    mbc1_remap();
+}
+
+///////////////////////////////////////// MBC2 /////////////////////////////////////////
+
+static void mbc2_remap() {
+    map_rom(0, CARTRIDGE->CART_ROM_BANK);
+    map_ram(0);
 }
 
-static void read_bank_0x() {
-    uint32_t address = (CARTRIDGE->CART_ROM_BANK << 14) | CPU->ADDRESS_BUS & 0x3FFF;
-    if (CARTRIDGE->NUM_ROM_BANKS >= 64) {
-        address |= CARTRIDGE->RAM_UPPER_ROM << 19;
+/*
+ * Both registers sit in 0x0000-0x3FFF, address bit 8 picks which one
+ */
+static void mbc2_write_register(uint16_t address) {
+    if (address >= 0x4000) {
+        return;
+    }
+    if (address & 0x0100) {
+        CARTRIDGE->CART_ROM_BANK = CPU->DATA_BUS & 0x0F ? CPU->DATA_BUS & 0x0F : 1;
     }
     else {
-        address &= CARTRIDGE->ROM_SIZE - 1;
+        ram_enable();
     }
-    CPU->DATA_BUS = CARTRIDGE->ROM[address];
+    mbc2_remap();
 }
 
-static void read_ram() {
-    if (!CARTRIDGE->RAM_ENABLE) {
-        CPU->DATA_BUS = 0xFF;
+///////////////////////////////////////// MBC3 /////////////////////////////////////////
+
+/*
+ * Brings the clock up to the current cycle, whole seconds only so the
+ * fraction carries over to the next catch up
+ */
+static void rtc_catch_up() {
+    RTC_STRUCT* rtc = &CARTRIDGE->RTC;
+    if (rtc->HALT) {
+        rtc->CYCLE = CYCLE_COUNT;
+        return;
+    }
+    uint64_t seconds = (CYCLE_COUNT - rtc->CYCLE) / RTC_CYCLES_PER_SECOND;
+    rtc->CYCLE += seconds * RTC_CYCLES_PER_SECOND;
+    rtc->SECONDS += seconds;
+    if (rtc->SECONDS >= (uint64_t) RTC_MAX_DAYS * RTC_SECONDS_PER_DAY) {
+        rtc->SECONDS %= (uint64_t) RTC_MAX_DAYS * RTC_SECONDS_PER_DAY;
+        rtc->DAY_CARRY = true;
+    }
+}
+
+/*
+ * Copies the current time into the registers the game reads
+ */
+static void rtc_latch() {
+    RTC_STRUCT* rtc = &CARTRIDGE->RTC;
+    rtc_catch_up();
+    uint64_t days = rtc->SECONDS / RTC_SECONDS_PER_DAY;
+    rtc->LATCHED[0] = rtc->SECONDS % 60;
+    rtc->LATCHED[1] = rtc->SECONDS / 60 % 60;
+    rtc->LATCHED[2] = rtc->SECONDS / 3600 % 24;
+    rtc->LATCHED[3] = days & 0xFF;
+    rtc->LATCHED[RTC_DAY_HIGH] = (days >> 8 & 0x01) | (rtc->HALT ? RTC_HALT_BIT : 0) | (rtc->DAY_CARRY ? RTC_CARRY_BIT : 0);
+}
+
+/*
+ * Sets clock register REG to VALUE. Out of range values are wrapped into
+ * range instead of counting up to the next overflow as the chip does.
+ */
+static void rtc_write(uint8_t reg, uint8_t value) {
+    RTC_STRUCT* rtc = &CARTRIDGE->RTC;
+    rtc_catch_up();
+    uint64_t seconds = rtc->SECONDS % 60;
+    uint64_t minutes = rtc->SECONDS / 60 % 60;
+    uint64_t hours = rtc->SECONDS / 3600 % 24;
+    uint64_t days = rtc->SECONDS / RTC_SECONDS_PER_DAY;
+    switch (reg) {
+        case 0:
+            seconds = (value & 0x3F) % 60;
+            rtc->CYCLE = CYCLE_COUNT;   //writing the seconds resets the sub-second divider
+            break;
+        case 1:
+            minutes = (value & 0x3F) % 60;
+            break;
+        case 2:
+            hours = (value & 0x1F) % 24;
+            break;
+        case 3:
+            days = (days & 0x100) | value;
+            break;
+        default:
+            days = (days & 0xFF) | (value & 0x01) << 8;
+            rtc->HALT = value & RTC_HALT_BIT;
+            rtc->DAY_CARRY = value & RTC_CARRY_BIT;
+            break;
+    }
+    rtc->SECONDS = ((days * 24 + hours) * 60 + minutes) * 60 + seconds;
+    rtc->LATCHED[reg] = value;
+}
+
+/*
+ * RAM bank values 0x08-0x0C map one clock register over the whole window
+ */
+static void mbc3_remap() {
+    map_rom(0, CARTRIDGE->CART_ROM_BANK);
+    uint8_t select = CARTRIDGE->RAM_BANK;
+    if (select < RTC_FIRST_REGISTER) {
+        map_ram(select);
     }
-    if (!CARTRIDGE->BANK_MODE) {
-        CPU->DATA_BUS = CARTRIDGE->RAM[(CPU->ADDRESS_BUS & 0x1FFF)];
+    else if (CARTRIDGE->HAS_RTC && CARTRIDGE->RAM_ENABLE && select < RTC_FIRST_REGISTER + RTC_NUM_REGISTERS) {
+        CARTRIDGE->RAM_MAP = &CARTRIDGE->RTC.LATCHED[select - RTC_FIRST_REGISTER];
+        CARTRIDGE->RAM_MASK = 0;
     }
     else {
-        CPU->DATA_BUS = CARTRIDGE->RAM[(CARTRIDGE->RAM_UPPER_ROM << 13) | (CPU->ADDRESS_BUS & 0x1FFF)];
+        CARTRIDGE->RAM_MAP = nullptr;
     }
 }
 
-static void write_ram() {
-    if (!CARTRIDGE->RAM_ENABLE) {
-        return;
+static void mbc3_write_register(uint16_t address) {
+    if (address < 0x2000) {
+        ram_enable();
     }
-    if (!CARTRIDGE->BANK_MODE) {
-        CARTRIDGE->RAM[CPU->ADDRESS_BUS] = CPU->DATA_BUS;
+    else if (address < 0x4000) {
+        CARTRIDGE->CART_ROM_BANK = CPU->DATA_BUS & 0x7F ? CPU->DATA_BUS & 0x7F : 1;
+    }
+    else if (address < 0x6000) {
+        CARTRIDGE->RAM_BANK = CPU->DATA_BUS & 0x0F;
     }
     else {
-        CARTRIDGE->RAM[(CARTRIDGE->RAM_UPPER_ROM << 13) | (CPU->ADDRESS_BUS & 0x1FFF)] = CPU->DATA_BUS;
+        if (CARTRIDGE->HAS_RTC && CARTRIDGE->RTC.LATCH_WRITE == 0x00 && CPU->DATA_BUS == 0x01) {
+            rtc_latch();
+        }
+        CARTRIDGE->RTC.LATCH_WRITE = CPU->DATA_BUS;
+        return;
     }
+    mbc3_remap();
 }
 
-/*
- * Reads byte pointed to by CPU->ADDRESS_BUS onto CPU->DATA_BUS
- */
-void read_memory(uint8_t UNUSED) {
-    (void)UNUSED;
-    if (CARTRIDGE->CART_TYPE == MBC0 && CPU->ADDRESS_BUS <= 0x8000) {
-        CPU->DATA_BUS = CARTRIDGE->ROM[CPU->ADDRESS_BUS];
-        return;
+///////////////////////////////////////// MBC5 /////////////////////////////////////////
+
+static void mbc5_remap() {
+    map_rom(0, CARTRIDGE->CART_ROM_BANK);
+    map_ram(CARTRIDGE->RAM_BANK);
+}
+
+static void mbc5_write_register(uint16_t address) {
+    if (address < 0x2000) {
+        ram_enable();
     }
-    else if (CPU->ADDRESS_BUS <= 0x4000) {
-        read_bank_00();
-        return;
+    else if (address < 0x3000) {
+        CARTRIDGE->CART_ROM_BANK = (CARTRIDGE->CART_ROM_BANK & 0x100) | CPU->DATA_BUS;
     }
-    else if (CPU->ADDRESS_BUS <= 0x8000) {
-        read_bank_0x();
-        return;
+    else if (address < 0x4000) {
+        CARTRIDGE->CART_ROM_BANK = (CARTRIDGE->CART_ROM_BANK & 0xFF) | (CPU->DATA_BUS & 0x01) << 8;
     }
-    else if (CPU->ADDRESS_BUS >= 0xA000 && CPU->ADDRESS_BUS < 0xC000) {
-        read_ram();
+    else if (address < 0x6000) {
+        CARTRIDGE->RAM_BANK = CPU->DATA_BUS & 0x0F;
+    }
+    else {
         return;
     }
+    mbc5_remap();
+}
 
+///////////////////////////////////////// BUS /////////////////////////////////////////
+
+/*
+ * The rest of the memory map from 0x8000 up, shared by every cartridge
+ */
+static void bus_read_system() {
     if (CPU->ADDRESS_BUS == P1) {
+        if (INPUT) {
+            input_catch_up();
+        }
+        if (MOVIE) {
+            movie_catch_up();
+        }
         uint8_t inputs = MEMORY[P1];
         if ((inputs & 0x10) == 0x10) {
-            CPU->DATA_BUS = 0x10 | (LCD->buttons & 0x0F);
+            CPU->DATA_BUS = 0x10 | (CPU->BUTTONS & 0x0F);
         }
         else if ((inputs & 0x20) == 0x20) {
-            CPU->DATA_BUS = 0x20 | (LCD->d_pad & 0x0F);
+            CPU->DATA_BUS = 0x20 | (CPU->D_PAD & 0x0F);
         }
         else {
             CPU->DATA_BUS = 0xFF;
         }
         return;
     }
-    if (CPU->ADDRESS_BUS == SB) {
-        CPU->DATA_BUS = 0xFF;
+    if (CPU->ADDRESS_BUS == SC) {
+        CPU->DATA_BUS = MEMORY[SC] | 0x7E;  //unused bits read as 1
         return;
     }
     if (CPU->ADDRESS_BUS == KEY1) {
         CPU->DATA_BUS = 0xFF;
         return;
     }
+    if (CPU->ADDRESS_BUS >= NR10 && CPU->ADDRESS_BUS <= APU_LAST_REGISTER) {
+        CPU->DATA_BUS = apu_read(CPU->ADDRESS_BUS);
+        return;
+    }
 //    if ((PPU->STATE == OAM_SEARCH) && (CPU->ADDRESS_BUS >= 0xFE00) && CPU->ADDRESS_BUS <= 0xFE9F) {
 //        CPU->DATA_BUS = 0xFF;
 //        return;
@@ -140,35 +287,7 @@ void read_memory(uint8_t UNUSED) {
     CPU->DATA_BUS = MEMORY[CPU->ADDRESS_BUS];
 }
 
-/*
- * Writes byte in CPU->DATA_BUS into the memory location
- * pointed to by CPU->ADDRESS_BUS
- */
-void write_memory(uint8_t UNUSED) {
-    (void)UNUSED;
-    if (CARTRIDGE->CART_TYPE == MBC0 && CPU->ADDRESS_BUS <= 0x8000) {
-        return;
-    }
-    else if (CPU->ADDRESS_BUS < 0x2000) {
-        ram_enable();
-        return;
-    }
-    else if (CPU->ADDRESS_BUS < 0x4000) {
-        set_rom_bank();
-        return;
-    }
-    else if (CPU->ADDRESS_BUS < 0x6000) {
-        set_RAM_UPPER_ROM();
-        return;
-    }
-    else if (CPU->ADDRESS_BUS < 0x8000) {
-        set_banking_mode();
-        return;
-    }
-    if (CPU->ADDRESS_BUS >= 0xA000 && CPU->ADDRESS_BUS < 0xC000) {
-        write_ram();
-        return;
-    }
+static ALWAYS_INLINE void bus_write_system() {
     //TODO 2 CYCLE DELAY FOR OAM DMA?
     if (CPU->ADDRESS_BUS == DMA) {
         CPU->STATE = OAM_DMA_TRANSFER;
@@ -190,6 +309,10 @@ void write_memory(uint8_t UNUSED) {
         MEMORY[P1] = (MEMORY[P1] & 0x0F) | (CPU->DATA_BUS & 0xF0);
         return;
     }
+    if (CPU->ADDRESS_BUS >= NR10 && CPU->ADDRESS_BUS <= APU_LAST_REGISTER) {
+        apu_write(CPU->ADDRESS_BUS, CPU->DATA_BUS);
+        return;
+    }
 
     MEMORY[CPU->ADDRESS_BUS] = CPU->DATA_BUS;
 
@@ -199,4 +322,170 @@ void write_memory(uint8_t UNUSED) {
     if (CPU->ADDRESS_BUS == DIV) {
         MEMORY[DIV] = 0x00;
     }
-}
\ No newline at end of file
+    if (CPU->ADDRESS_BUS == SC) {
+        serial_write_control();
+    }
+}
+
+/*
+ * CPU view of cartridge RAM writes and the rest of the map for one mapper.
+ * MAPPER is a constant in every expansion of MAPPERS, so each handler is
+ * compiled with the checks on it folded away. Writes below 0x8000 go to the
+ * mapper's registers, which remap the windows.
+ */
+static ALWAYS_INLINE void bus_write(enum CARTRIDGES mapper) {
+    uint16_t address = CPU->ADDRESS_BUS;
+    if (address < 0x8000) {
+        switch (mapper) {
+            case MBC1:
+                mbc1_write_register(address);
+                break;
+            case MBC2:
+                mbc2_write_register(address);
+                break;
+            case MBC3:
+                mbc3_write_register(address);
+                break;
+            case MBC5:
+                mbc5_write_register(address);
+                break;
+            default:
+                break;
+        }
+    }
+    else if (address >= 0xA000 && address < 0xC000) {
+        if (!CARTRIDGE->RAM_MAP) {
+            return;
+        }
+        if (mapper == MBC2) {
+            //only the low half of each byte exists, the rest reads back as 1s
+            CARTRIDGE->RAM_MAP[address & CARTRIDGE->RAM_MASK] = CPU->DATA_BUS | 0xF0;
+        }
+        else if (mapper == MBC3 && CARTRIDGE->RAM_BANK >= RTC_FIRST_REGISTER) {
+            rtc_write(CARTRIDGE->RAM_BANK - RTC_FIRST_REGISTER, CPU->DATA_BUS);
+        }
+        else {
+            CARTRIDGE->RAM_MAP[address & CARTRIDGE->RAM_MASK] = CPU->DATA_BUS;
+        }
+    }
+    else {
+        bus_write_system();
+    }
+}
+
+static ALWAYS_INLINE void watch_write() {
+    HEATMAP_ACCESS(HEAT_CPU, HEAT_WRITE, CPU->ADDRESS_BUS);
+    if (WATCH_PAGES[CPU->ADDRESS_BUS >> 8] & WATCH_WRITE) {
+        watch_hit(WATCH_WRITE, CPU->ADDRESS_BUS, CPU->DATA_BUS);
+    }
+}
+
+/*
+ * Every mapper gets its own write handler, reads look the same for all of
+ * them once the banks sit behind ROM_MAP and RAM_MAP
+ */
+#define MAPPERS(X) \
+    X(mbc0, MBC0)  \
+    X(mbc1, MBC1)  \
+    X(mbc2, MBC2)  \
+    X(mbc3, MBC3)  \
+    X(mbc5, MBC5)
+
+#define DEFINE_WRITE_HANDLER(NAME, MAPPER)                                  \
+    static void write_memory_##NAME(uint8_t UNUSED) {                       \
+        (void)UNUSED;                                                       \
+        bus_write(MAPPER);                                                  \
+        watch_write();                                                      \
+    }
+
+MAPPERS(DEFINE_WRITE_HANDLER)
+
+/*
+ * Picks the write handler of the cartridge's mapper and points the windows at
+ * the banks its registers select, at load and after a save state is restored
+ */
+void cartridge_remap() {
+    switch (CARTRIDGE->CART_TYPE) {
+        case MBC0:
+            CARTRIDGE->WRITE_MEMORY = write_memory_mbc0;
+            map_rom(0, 1);
+            map_ram(0);
+            break;
+        case MBC1:
+            CARTRIDGE->WRITE_MEMORY = write_memory_mbc1;
+            mbc1_remap();
+            break;
+        case MBC2:
+            CARTRIDGE->WRITE_MEMORY = write_memory_mbc2;
+            mbc2_remap();
+            break;
+        case MBC3:
+            CARTRIDGE->WRITE_MEMORY = write_memory_mbc3;
+            mbc3_remap();
+            break;
+        case MBC5:
+            CARTRIDGE->WRITE_MEMORY = write_memory_mbc5;
+            mbc5_remap();
+            break;
+    }
+}
+
+/*
+ * Returns the ROM bank the CPU currently reads at ADDRESS, which must be below 0x8000
+ */
+uint16_t mapped_rom_bank(uint16_t address) {
+    return (CARTRIDGE->ROM_MAP[address >> 14] - CARTRIDGE->ROM) / ROM_BANK_SIZE;
+}
+
+/*
+ * Returns the external RAM bank mapped at 0xA000-0xBFFF, 0 while no RAM bank is
+ */
+uint8_t mapped_ram_bank() {
+    uint8_t* map = CARTRIDGE->RAM_MAP;
+    if (!map || map < CARTRIDGE->RAM || map >= CARTRIDGE->RAM + CARTRIDGE->RAM_SIZE) {
+        return 0;
+    }
+    return (map - CARTRIDGE->RAM) / RAM_BANK_SIZE;
+}
+
+static ALWAYS_INLINE void bus_read() {
+    uint16_t address = CPU->ADDRESS_BUS;
+    if (address < 0x8000) {
+        CPU->DATA_BUS = CARTRIDGE->ROM_MAP[address >> 14][address & (ROM_BANK_SIZE - 1)];
+    }
+    else if (address >= 0xA000 && address < 0xC000) {
+        CPU->DATA_BUS = CARTRIDGE->RAM_MAP ? CARTRIDGE->RAM_MAP[address & CARTRIDGE->RAM_MASK] : 0xFF;
+    }
+    else {
+        bus_read_system();
+    }
+    HEATMAP_ACCESS(HEAT_CPU, HEAT_READ, CPU->ADDRESS_BUS);
+}
+
+/*
+ * Reads byte pointed to by CPU->ADDRESS_BUS onto CPU->DATA_BUS
+ */
+void read_memory(uint8_t UNUSED) {
+    (void)UNUSED;
+    bus_read();
+    if (WATCH_PAGES[CPU->ADDRESS_BUS >> 8] & WATCH_READ) {
+        watch_hit(WATCH_READ, CPU->ADDRESS_BUS, CPU->DATA_BUS);
+    }
+}
+
+/*
+ * read_memory() for opcode and operand fetches at PC, which read watches
+ * ignore so a watch on data next to code doesn't fire on every execution.
+ * Opcode fetches are seen by execute watches instead.
+ */
+void fetch_memory() {
+    bus_read();
+}
+
+/*
+ * Writes byte in CPU->DATA_BUS into the memory location
+ * pointed to by CPU->ADDRESS_BUS
+ */
+void write_memory(uint8_t UNUSED) {
+    CARTRIDGE->WRITE_MEMORY(UNUSED);
+}
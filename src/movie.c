@@ -0,0 +1,209 @@
+#include <common.h>
+#include <gb.h>
+#include <memory.h>
+#include <input.h>
+#include <movie.h>
+
+#define FNV_OFFSET 0xCBF29CE484222325ULL
+#define FNV_PRIME 0x100000001B3ULL
+#define FRAMES_OFFSET 24            //of the counts rewritten when recording stops
+
+static void write_u64(uint8_t* bytes, uint64_t value) {
+    for (uint8_t i = 0; i < 8; i++) {
+        bytes[i] = (uint8_t) (value >> (8 * i));
+    }
+}
+
+static uint64_t read_u64(const uint8_t* bytes) {
+    uint64_t value = 0;
+    for (uint8_t i = 0; i < 8; i++) {
+        value |= (uint64_t) bytes[i] << (8 * i);
+    }
+    return value;
+}
+
+/*
+ * FNV-1a over the cartridge ROM
+ */
+uint64_t movie_rom_hash() {
+    uint64_t hash = FNV_OFFSET;
+    for (uint32_t i = 0; i < CARTRIDGE->ROM_SIZE; i++) {
+        hash = (hash ^ CARTRIDGE->ROM[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+static void write_header() {
+    uint8_t header[MOVIE_HEADER_SIZE] = {0};
+    memcpy(header, MOVIE_MAGIC, 4);
+    header[4] = MOVIE_VERSION & 0xFF;
+    header[5] = MOVIE_VERSION >> 8;
+    header[6] = MOVIE_START_POWER_ON;
+    write_u64(&header[8], MOVIE->ROM_HASH);
+    write_u64(&header[16], MOVIE->START_CYCLE);
+    write_u64(&header[FRAMES_OFFSET], MOVIE->FRAMES);
+    write_u64(&header[32], MOVIE->CHANGES);
+    write_u64(&header[40], CYCLE_COUNT);
+    fseek(MOVIE->FILE, 0, SEEK_SET);
+    fwrite(header, 1, sizeof(header), MOVIE->FILE);
+}
+
+/*
+ * Reads the next change of the stream, clears HAS_NEXT at the end
+ */
+static void read_next() {
+    uint64_t delta = 0;
+    uint8_t shift = 0;
+    while (MOVIE->OFFSET < MOVIE->SIZE && shift < 64) {
+        uint8_t byte = MOVIE->DATA[MOVIE->OFFSET++];
+        delta |= (uint64_t) (byte & 0x7F) << shift;
+        shift += 7;
+        if (!(byte & 0x80)) {
+            break;
+        }
+    }
+    MOVIE->HAS_NEXT = MOVIE->OFFSET < MOVIE->SIZE;
+    if (!MOVIE->HAS_NEXT) {
+        return;
+    }
+    MOVIE->NEXT_JOYPAD = MOVIE->DATA[MOVIE->OFFSET++];
+    MOVIE->LAST_CYCLE += delta;
+    MOVIE->NEXT_CYCLE = MOVIE->LAST_CYCLE;
+}
+
+static void load_movie(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        perror("Couldn't open movie");
+        exit(1);
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t header[MOVIE_HEADER_SIZE];
+    if (size < MOVIE_HEADER_SIZE || fread(header, 1, sizeof(header), file) != sizeof(header) ||
+        memcmp(header, MOVIE_MAGIC, 4) != 0) {
+        fprintf(stderr, "%s is not a movie\n", path);
+        exit(1);
+    }
+    uint16_t version = header[4] | header[5] << 8;
+    if (version != MOVIE_VERSION || header[6] != MOVIE_START_POWER_ON) {
+        fprintf(stderr, "%s has version %u and start state %u, only version %u from power-on is supported\n",
+                path, version, header[6], MOVIE_VERSION);
+        exit(1);
+    }
+    MOVIE->ROM_HASH = read_u64(&header[8]);
+    MOVIE->START_CYCLE = read_u64(&header[16]);
+    MOVIE->FRAMES = read_u64(&header[FRAMES_OFFSET]);
+    MOVIE->CHANGES = read_u64(&header[32]);
+    MOVIE->SIZE = (size_t) size - MOVIE_HEADER_SIZE;
+    MOVIE->DATA = malloc(MOVIE->SIZE ? MOVIE->SIZE : 1);
+    if (!MOVIE->DATA || fread(MOVIE->DATA, 1, MOVIE->SIZE, file) != MOVIE->SIZE) {
+        perror("Couldn't read movie");
+        exit(1);
+    }
+    fclose(file);
+
+    if (MOVIE->ROM_HASH != movie_rom_hash()) {
+        fprintf(stderr, "%s was recorded with a different ROM\n", path);
+        exit(1);
+    }
+    if (MOVIE->START_CYCLE != CYCLE_COUNT) {
+        fprintf(stderr, "%s starts at cycle %llu, the emulator is at %llu\n", path,
+                (unsigned long long) MOVIE->START_CYCLE, (unsigned long long) CYCLE_COUNT);
+        exit(1);
+    }
+    MOVIE->LAST_CYCLE = MOVIE->START_CYCLE;
+    read_next();
+}
+
+/*
+ * Starts recording to or playing back from PATH, right after gb_init()
+ */
+void movie_init(const char* path, enum MOVIE_MODE mode) {
+    MOVIE = (MOVIE_STRUCT*) calloc(1, sizeof(MOVIE_STRUCT));
+    if (!MOVIE) {
+        perror("Couldn't allocate movie");
+        exit(1);
+    }
+    MOVIE->MODE = mode;
+    if (mode == MOVIE_PLAY) {
+        load_movie(path);
+        return;
+    }
+    MOVIE->FILE = fopen(path, "wb");
+    if (!MOVIE->FILE) {
+        perror("Couldn't open movie file");
+        exit(1);
+    }
+    MOVIE->ROM_HASH = movie_rom_hash();
+    MOVIE->START_CYCLE = CYCLE_COUNT;
+    MOVIE->LAST_CYCLE = CYCLE_COUNT;
+    write_header();
+}
+
+/*
+ * Recordings get their counts written into the header
+ */
+void movie_free() {
+    if (!MOVIE) {
+        return;
+    }
+    if (MOVIE->FILE) {
+        write_header();
+        fclose(MOVIE->FILE);
+    }
+    free(MOVIE->DATA);
+    free(MOVIE);
+    MOVIE = nullptr;
+}
+
+/*
+ * Appends the joypad state the game sees from CYCLE_COUNT on
+ */
+void movie_record(uint8_t buttons, uint8_t d_pad) {
+    uint8_t bytes[11];
+    uint8_t length = 0;
+    uint64_t delta = CYCLE_COUNT - MOVIE->LAST_CYCLE;
+    do {
+        bytes[length] = delta & 0x7F;
+        delta >>= 7;
+        if (delta) {
+            bytes[length] |= 0x80;
+        }
+        length++;
+    } while (delta);
+    bytes[length++] = (buttons & 0x0F) << 4 | (d_pad & 0x0F);
+    fwrite(bytes, 1, length, MOVIE->FILE);
+    MOVIE->LAST_CYCLE = CYCLE_COUNT;
+    MOVIE->CHANGES++;
+}
+
+/*
+ * Playback, called on every P1 read. Applies the changes recorded up to CYCLE_COUNT.
+ */
+void movie_catch_up() {
+    if (MOVIE->MODE != MOVIE_PLAY) {
+        return;
+    }
+    while (MOVIE->HAS_NEXT && MOVIE->NEXT_CYCLE <= CYCLE_COUNT) {
+        input_set_joypad(0xF0 | MOVIE->NEXT_JOYPAD >> 4, 0xF0 | (MOVIE->NEXT_JOYPAD & 0x0F));
+        read_next();
+    }
+}
+
+/*
+ * Called at the end of every frame, playback applies the changes recorded at the frame's last cycle
+ */
+void movie_end_frame() {
+    if (MOVIE->MODE == MOVIE_RECORD) {
+        MOVIE->FRAMES++;
+        return;
+    }
+    movie_catch_up();
+    MOVIE->FRAMES_PLAYED++;
+}
+
+bool movie_finished() {
+    return MOVIE->MODE == MOVIE_PLAY && MOVIE->FRAMES_PLAYED >= MOVIE->FRAMES;
+}
@@ -0,0 +1,589 @@
+#include <common.h>
+#include <SDL3/SDL.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <ppu.h>
+#include <apu.h>
+#include <memory.h>
+#include <input.h>
+#include <gb.h>
+#include <link.h>
+#include <savestate.h>
+#include <netplay.h>
+
+#define HISTORY_MASK (NETPLAY_HISTORY - 1)
+#define REMOTE_PLAYER (NETPLAY->LOCAL_PLAYER ^ 1)
+#define NO_ROLLBACK UINT64_MAX
+#define NO_INPUT 0xFF               //nothing pressed, what the remote player is predicted to do before its first input
+#define SYNC_INTERVAL 10            //frames to run between two time sync waits
+#define SYNC_THRESHOLD 2            //frames ahead of the peer that make us wait
+#define CONNECT_INTERVAL_NS 50000000ULL
+#define POLL_INTERVAL_NS 1000000ULL
+#define FINISH_LINGER_NS 250000000ULL
+#define FNV_OFFSET 0xCBF29CE484222325ULL
+#define FNV_PRIME 0x100000001B3ULL
+
+//packet layout, integers are little endian
+#define PACKET_MAGIC "GBNP"
+#define PACKET_PLAYER 4
+#define PACKET_COUNT 5
+#define PACKET_SESSION 8
+#define PACKET_FRAME 16             //sender's next frame
+#define PACKET_FIRST 24             //frame of the first input carried
+#define PACKET_ACK 32               //sender has our inputs for all frames below
+#define PACKET_SENT_NS 40
+#define PACKET_ECHO_NS 48           //send time of the last packet the sender got from us
+#define PACKET_HOLD_NS 56           //and how long the sender held it before this one
+#define PACKET_CHECK_FRAME 64
+#define PACKET_CHECKSUM 72
+#define PACKET_HEADER 80
+#define PACKET_MAX_INPUTS (NETPLAY_MAX_PACKET - PACKET_HEADER)
+
+static void put_u64(uint8_t* data, uint64_t value) {
+    for (uint8_t i = 0; i < 8; i++) {
+        data[i] = value >> (8 * i);
+    }
+}
+
+static uint64_t get_u64(const uint8_t* data) {
+    uint64_t value = 0;
+    for (uint8_t i = 0; i < 8; i++) {
+        value |= (uint64_t) data[i] << (8 * i);
+    }
+    return value;
+}
+
+static uint32_t next_random() {
+    NETPLAY->RANDOM ^= NETPLAY->RANDOM << 13;
+    NETPLAY->RANDOM ^= NETPLAY->RANDOM >> 17;
+    NETPLAY->RANDOM ^= NETPLAY->RANDOM << 5;
+    return NETPLAY->RANDOM;
+}
+
+/*
+ * Both sides must run the same ROMs in the same order
+ */
+static uint64_t session_hash() {
+    uint64_t hash = FNV_OFFSET;
+    for (uint8_t player = 0; player < LINK_PLAYERS; player++) {
+        link_select(player);
+        for (uint32_t i = 0; i < CARTRIDGE->ROM_SIZE; i++) {
+            hash = (hash ^ CARTRIDGE->ROM[i]) * FNV_PRIME;
+        }
+    }
+    return hash;
+}
+
+static void resolve_peer(const char* peer) {
+    char host[256];
+    const char* colon = strrchr(peer, ':');
+    size_t length = colon ? (size_t) (colon - peer) : strlen(peer);
+    if (length >= sizeof(host)) {
+        fprintf(stderr, "Netplay peer address too long: %s\n", peer);
+        exit(1);
+    }
+    memcpy(host, peer, length);
+    host[length] = '\0';
+    char port[16];
+    snprintf(port, sizeof(port), "%u", colon ? (unsigned) strtoul(colon + 1, nullptr, 10) : NETPLAY_DEFAULT_PORT);
+
+    struct addrinfo hints = {.ai_family = AF_INET, .ai_socktype = SOCK_DGRAM};
+    struct addrinfo* result;
+    int error = getaddrinfo(host, port, &hints, &result);
+    if (error) {
+        fprintf(stderr, "Couldn't resolve netplay peer %s: %s\n", peer, gai_strerror(error));
+        exit(1);
+    }
+    memcpy(&NETPLAY->PEER, result->ai_addr, sizeof(NETPLAY->PEER));
+    freeaddrinfo(result);
+}
+
+/*
+ * Sets up a session on the instances of link_init(), LOCAL_PLAYER (0 or 1)
+ * is the one this process controls. Listens on PORT and sends to PEER,
+ * "host:port" or just a host on the default port.
+ */
+void netplay_init(uint8_t local_player, uint16_t port, const char* peer) {
+    NETPLAY = (NETPLAY_STRUCT*) calloc(1, sizeof(NETPLAY_STRUCT));
+    if (!NETPLAY) {
+        perror("Couldn't allocate netplay session");
+        exit(1);
+    }
+    NETPLAY->LOCAL_PLAYER = local_player;
+    NETPLAY->ROLLBACK_FRAME = NO_ROLLBACK;
+    NETPLAY->RANDOM = 0x9E3779B9u ^ local_player;
+    NETPLAY->SESSION = session_hash();
+    for (uint8_t player = 0; player < LINK_PLAYERS; player++) {
+        link_select(player);
+        for (uint8_t i = 0; i < NETPLAY_STATES; i++) {
+            savestate_init(&NETPLAY->STATES[i].PLAYERS[player]);
+        }
+        //the remote player's picture is never shown
+        PPU->SKIP_RENDER = player != local_player;
+    }
+    link_select(local_player);
+
+    NETPLAY->SOCKET = socket(AF_INET, SOCK_DGRAM, 0);
+    if (NETPLAY->SOCKET < 0) {
+        perror("Couldn't open netplay socket");
+        exit(1);
+    }
+    struct sockaddr_in address = {.sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_ANY)};
+    if (bind(NETPLAY->SOCKET, (struct sockaddr*) &address, sizeof(address)) < 0) {
+        perror("Couldn't bind netplay socket");
+        exit(1);
+    }
+    if (fcntl(NETPLAY->SOCKET, F_SETFL, fcntl(NETPLAY->SOCKET, F_GETFL) | O_NONBLOCK) < 0) {
+        perror("Couldn't make netplay socket non-blocking");
+        exit(1);
+    }
+    resolve_peer(peer);
+}
+
+void netplay_free() {
+    close(NETPLAY->SOCKET);
+    for (uint8_t i = 0; i < NETPLAY_STATES; i++) {
+        for (uint8_t player = 0; player < LINK_PLAYERS; player++) {
+            savestate_free(&NETPLAY->STATES[i].PLAYERS[player]);
+        }
+    }
+    free(NETPLAY);
+    NETPLAY = nullptr;
+}
+
+/*
+ * Holds every packet back DELAY_MS and drops LOSS_PERCENT of them, to test
+ * prediction and rollback on loopback
+ */
+void netplay_simulate(uint32_t delay_ms, uint8_t loss_percent) {
+    NETPLAY->DELAY_NS = delay_ms * 1000000ULL;
+    NETPLAY->LOSS_PERCENT = loss_percent;
+}
+
+///////////////////////////////////////// PACKETS /////////////////////////////////////////
+
+static void transmit(const uint8_t* data, uint16_t size) {
+    if (sendto(NETPLAY->SOCKET, data, size, 0, (const struct sockaddr*) &NETPLAY->PEER, sizeof(NETPLAY->PEER)) < 0) {
+        NETPLAY->PACKETS_DROPPED++;
+        return;
+    }
+    NETPLAY->PACKETS_SENT++;
+}
+
+static void flush_outbox(uint64_t now) {
+    while (NETPLAY->OUTBOX_SIZE && NETPLAY->OUTBOX[NETPLAY->OUTBOX_HEAD].RELEASE_NS <= now) {
+        const NETPLAY_PACKET* packet = &NETPLAY->OUTBOX[NETPLAY->OUTBOX_HEAD];
+        transmit(packet->DATA, packet->SIZE);
+        NETPLAY->OUTBOX_HEAD = (NETPLAY->OUTBOX_HEAD + 1) % NETPLAY_OUTBOX_SIZE;
+        NETPLAY->OUTBOX_SIZE--;
+    }
+}
+
+static void send_packet(const uint8_t* data, uint16_t size, uint64_t now) {
+    if (NETPLAY->LOSS_PERCENT && next_random() % 100 < NETPLAY->LOSS_PERCENT) {
+        NETPLAY->PACKETS_DROPPED++;
+        return;
+    }
+    if (!NETPLAY->DELAY_NS) {
+        transmit(data, size);
+        return;
+    }
+    if (NETPLAY->OUTBOX_SIZE == NETPLAY_OUTBOX_SIZE) {
+        NETPLAY->PACKETS_DROPPED++;
+        return;
+    }
+    NETPLAY_PACKET* packet = &NETPLAY->OUTBOX[(NETPLAY->OUTBOX_HEAD + NETPLAY->OUTBOX_SIZE) % NETPLAY_OUTBOX_SIZE];
+    packet->RELEASE_NS = now + NETPLAY->DELAY_NS;
+    packet->SIZE = size;
+    memcpy(packet->DATA, data, size);
+    NETPLAY->OUTBOX_SIZE++;
+}
+
+/*
+ * Sends every input the peer has not acknowledged, a lost packet costs
+ * nothing once the next one arrives
+ */
+static void send_inputs(uint64_t now) {
+    uint8_t data[NETPLAY_MAX_PACKET] = {0};
+    uint64_t first = NETPLAY->ACKED_FRAMES;
+    uint64_t count = NETPLAY->FRAME - first;
+    if (count > PACKET_MAX_INPUTS) {
+        count = PACKET_MAX_INPUTS;
+    }
+    memcpy(data, PACKET_MAGIC, 4);
+    data[PACKET_PLAYER] = NETPLAY->LOCAL_PLAYER;
+    data[PACKET_COUNT] = count;
+    put_u64(&data[PACKET_SESSION], NETPLAY->SESSION);
+    put_u64(&data[PACKET_FRAME], NETPLAY->FRAME);
+    put_u64(&data[PACKET_FIRST], first);
+    put_u64(&data[PACKET_ACK], NETPLAY->REMOTE_FRAMES);
+    put_u64(&data[PACKET_SENT_NS], now);
+    put_u64(&data[PACKET_ECHO_NS], NETPLAY->ECHO_NS);
+    put_u64(&data[PACKET_HOLD_NS], NETPLAY->ECHO_NS ? now - NETPLAY->ECHO_RECEIVED_NS : 0);
+    put_u64(&data[PACKET_CHECK_FRAME], NETPLAY->CHECK_FRAME);
+    put_u64(&data[PACKET_CHECKSUM], NETPLAY->CHECKSUMS[NETPLAY->CHECK_FRAME & HISTORY_MASK]);
+    for (uint64_t i = 0; i < count; i++) {
+        data[PACKET_HEADER + i] = NETPLAY->LOCAL_INPUTS[(first + i) & HISTORY_MASK];
+    }
+    send_packet(data, PACKET_HEADER + count, now);
+}
+
+/*
+ * Takes the remote input of FRAME. If FRAME already ran on a different
+ * prediction it has to be simulated again.
+ */
+static void receive_input(uint64_t frame, uint8_t input) {
+    uint8_t* slot = &NETPLAY->REMOTE_INPUTS[frame & HISTORY_MASK];
+    if (frame < NETPLAY->FRAME) {
+        NETPLAY->REMOTE_INPUTS_LATE++;
+        NETPLAY->REMOTE_LAG_SUM += NETPLAY->FRAME - frame;
+        if (*slot != input && frame < NETPLAY->ROLLBACK_FRAME) {
+            NETPLAY->ROLLBACK_FRAME = frame;
+        }
+    }
+    *slot = input;
+    NETPLAY->REMOTE_FRAMES++;
+}
+
+static void receive_packet(const uint8_t* data, size_t size, uint64_t now) {
+    if (size < PACKET_HEADER || memcmp(data, PACKET_MAGIC, 4) || data[PACKET_PLAYER] != REMOTE_PLAYER ||
+        get_u64(&data[PACKET_SESSION]) != NETPLAY->SESSION || size < PACKET_HEADER + (size_t) data[PACKET_COUNT]) {
+        return;
+    }
+    NETPLAY->PACKETS_RECEIVED++;
+    uint64_t frame = get_u64(&data[PACKET_FRAME]);
+    if (frame > NETPLAY->REMOTE_FRAME) {
+        NETPLAY->REMOTE_FRAME = frame;
+    }
+    uint64_t ack = get_u64(&data[PACKET_ACK]);
+    if (ack > NETPLAY->ACKED_FRAMES && ack <= NETPLAY->FRAME) {
+        NETPLAY->ACKED_FRAMES = ack;
+    }
+    uint64_t sent_ns = get_u64(&data[PACKET_SENT_NS]);
+    if (sent_ns > NETPLAY->ECHO_NS) {
+        NETPLAY->ECHO_NS = sent_ns;
+        NETPLAY->ECHO_RECEIVED_NS = now;
+    }
+    uint64_t echo_ns = get_u64(&data[PACKET_ECHO_NS]);
+    uint64_t hold_ns = get_u64(&data[PACKET_HOLD_NS]);
+    if (echo_ns && echo_ns + hold_ns <= now) {
+        uint64_t rtt_ns = now - echo_ns - hold_ns;
+        NETPLAY->RTT_SUM_NS += rtt_ns;
+        NETPLAY->RTT_SAMPLES++;
+        if (rtt_ns > NETPLAY->RTT_MAX_NS) {
+            NETPLAY->RTT_MAX_NS = rtt_ns;
+        }
+    }
+    uint64_t check_frame = get_u64(&data[PACKET_CHECK_FRAME]);
+    if (check_frame > NETPLAY->PEER_CHECK_FRAME) {
+        NETPLAY->PEER_CHECK_FRAME = check_frame;
+        NETPLAY->PEER_CHECKSUM = get_u64(&data[PACKET_CHECKSUM]);
+    }
+
+    uint64_t first = get_u64(&data[PACKET_FIRST]);
+    for (uint8_t i = 0; i < data[PACKET_COUNT]; i++) {
+        uint64_t input_frame = first + i;
+        if (input_frame == NETPLAY->REMOTE_FRAMES) {
+            receive_input(input_frame, data[PACKET_HEADER + i]);
+        }
+    }
+}
+
+/*
+ * Compares the peer's latest hash with ours of the same frame, if we hashed
+ * it too. Every input before it is final on both sides, the states must match.
+ */
+static void compare_checksums() {
+    uint64_t frame = NETPLAY->PEER_CHECK_FRAME;
+    if (frame <= NETPLAY->COMPARED_FRAME || NETPLAY->CHECKSUM_FRAMES[frame & HISTORY_MASK] != frame) {
+        return;
+    }
+    NETPLAY->COMPARED_FRAME = frame;
+    NETPLAY->CHECKS++;
+    if (NETPLAY->CHECKSUMS[frame & HISTORY_MASK] != NETPLAY->PEER_CHECKSUM) {
+        if (!NETPLAY->DESYNCS) {
+            fprintf(stderr, "Netplay desync: state at frame %llu differs from the peer's\n",
+                    (unsigned long long) frame);
+        }
+        NETPLAY->DESYNCS++;
+    }
+}
+
+/*
+ * Receives whatever arrived and sends what the artificial delay released
+ */
+static void poll_socket() {
+    uint8_t data[NETPLAY_MAX_PACKET];
+    while (true) {
+        ssize_t size = recv(NETPLAY->SOCKET, data, sizeof(data), 0);
+        if (size < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ECONNREFUSED && errno != EINTR) {
+                perror("Netplay receive failed");
+            }
+            break;
+        }
+        receive_packet(data, (size_t) size, SDL_GetTicksNS());
+    }
+    compare_checksums();
+    flush_outbox(SDL_GetTicksNS());
+}
+
+///////////////////////////////////////// FRAMES /////////////////////////////////////////
+
+static void save_frame(uint64_t frame) {
+    NETPLAY_FRAME_STATE* state = &NETPLAY->STATES[frame % NETPLAY_STATES];
+    for (uint8_t player = 0; player < LINK_PLAYERS; player++) {
+        link_select(player);
+        savestate_save(&state->PLAYERS[player]);
+        state->PENDING_FRAMES[player] = LINK->PENDING_FRAMES[player];
+    }
+}
+
+static void load_frame(uint64_t frame) {
+    const NETPLAY_FRAME_STATE* state = &NETPLAY->STATES[frame % NETPLAY_STATES];
+    for (uint8_t player = 0; player < LINK_PLAYERS; player++) {
+        link_select(player);
+        savestate_load(&state->PLAYERS[player]);
+        LINK->PENDING_FRAMES[player] = state->PENDING_FRAMES[player];
+    }
+    //the link schedules on its copies, the selected one was loaded behind its back
+    gb_save_instance(&LINK->PLAYERS[LINK->CURRENT]);
+}
+
+/*
+ * Remote input FRAME runs on, repeating the last one received until the real one is in
+ */
+static uint8_t remote_input(uint64_t frame) {
+    if (frame >= NETPLAY->REMOTE_FRAMES) {
+        NETPLAY->REMOTE_INPUTS[frame & HISTORY_MASK] =
+            NETPLAY->REMOTE_FRAMES ? NETPLAY->REMOTE_INPUTS[(NETPLAY->REMOTE_FRAMES - 1) & HISTORY_MASK] : NO_INPUT;
+    }
+    return NETPLAY->REMOTE_INPUTS[frame & HISTORY_MASK];
+}
+
+/*
+ * Runs FRAME on the pair, the local picture is only rendered if RENDER
+ */
+static void simulate(uint64_t frame, bool render) {
+    uint8_t inputs[LINK_PLAYERS];
+    inputs[NETPLAY->LOCAL_PLAYER] = NETPLAY->LOCAL_INPUTS[frame & HISTORY_MASK];
+    inputs[REMOTE_PLAYER] = remote_input(frame);
+    for (uint8_t player = 0; player < LINK_PLAYERS; player++) {
+        link_select(player);
+        input_set_joypad(0xF0 | inputs[player] >> 4, 0xF0 | (inputs[player] & 0x0F));
+        PPU->SKIP_RENDER = player != NETPLAY->LOCAL_PLAYER || !render;
+    }
+    link_run_frame();
+}
+
+/*
+ * Restores the start of the first mispredicted frame and simulates the
+ * frames since again. Only the frame that runs next is shown, so these are
+ * not rendered and the sound they made is dropped, it was played already.
+ */
+static void roll_back() {
+    uint64_t start_ns = SDL_GetTicksNS();
+    link_select(NETPLAY->LOCAL_PLAYER);
+    uint32_t samples = APU->NUM_SAMPLES;
+    uint64_t depth = NETPLAY->FRAME - NETPLAY->ROLLBACK_FRAME;
+    load_frame(NETPLAY->ROLLBACK_FRAME);
+    for (uint64_t frame = NETPLAY->ROLLBACK_FRAME; frame < NETPLAY->FRAME; frame++) {
+        if (frame != NETPLAY->ROLLBACK_FRAME) {
+            save_frame(frame);
+        }
+        simulate(frame, false);
+    }
+    link_select(NETPLAY->LOCAL_PLAYER);
+    APU->NUM_SAMPLES = samples;
+    NETPLAY->ROLLBACK_FRAME = NO_ROLLBACK;
+
+    uint64_t elapsed_ns = SDL_GetTicksNS() - start_ns;
+    NETPLAY->ROLLBACKS++;
+    NETPLAY->RESIM_FRAMES += depth;
+    NETPLAY->RESIM_NS += elapsed_ns;
+    if (elapsed_ns > NETPLAY->RESIM_MAX_NS) {
+        NETPLAY->RESIM_MAX_NS = elapsed_ns;
+    }
+    if (depth > NETPLAY->ROLLBACK_DEPTH_MAX) {
+        NETPLAY->ROLLBACK_DEPTH_MAX = depth;
+    }
+}
+
+/*
+ * Hashes the latest frame start no remote input is missing for, its state
+ * was saved within the last NETPLAY_MAX_ROLLBACK frames
+ */
+static void check_frame() {
+    uint64_t frame = NETPLAY->REMOTE_FRAMES < NETPLAY->FRAME ? NETPLAY->REMOTE_FRAMES : NETPLAY->FRAME;
+    if (frame <= NETPLAY->CHECK_FRAME) {
+        return;
+    }
+    const NETPLAY_FRAME_STATE* state = &NETPLAY->STATES[frame % NETPLAY_STATES];
+    uint64_t hash = FNV_OFFSET;
+    for (uint8_t player = 0; player < LINK_PLAYERS; player++) {
+        hash = savestate_hash(&state->PLAYERS[player], hash);
+    }
+    NETPLAY->CHECKSUMS[frame & HISTORY_MASK] = hash;
+    NETPLAY->CHECKSUM_FRAMES[frame & HISTORY_MASK] = frame;
+    NETPLAY->CHECK_FRAME = frame;
+}
+
+/*
+ * Whether we are far enough ahead of the peer to wait a frame for it. The
+ * peer has gone on by half a round trip since it sent its frame number.
+ */
+static bool ahead_of_peer() {
+    if (NETPLAY->FRAME < NETPLAY->LAST_SYNC_FRAME + SYNC_INTERVAL || !NETPLAY->RTT_SAMPLES) {
+        return false;
+    }
+    double one_way_frames = NETPLAY->RTT_SUM_NS / 2e6 / NETPLAY->RTT_SAMPLES / FRAME_TIME_MS;
+    double peer_frame = (double) NETPLAY->REMOTE_FRAME + one_way_frames;
+    if ((double) NETPLAY->FRAME < peer_frame + SYNC_THRESHOLD) {
+        return false;
+    }
+    NETPLAY->LAST_SYNC_FRAME = NETPLAY->FRAME;
+    return true;
+}
+
+/*
+ * Sends a packet every CONNECT_INTERVAL_NS until the peer's first one
+ * arrives or TIMEOUT_MS runs out
+ */
+bool netplay_connect(uint32_t timeout_ms) {
+    uint64_t start_ns = SDL_GetTicksNS();
+    uint64_t next_send_ns = start_ns;
+    while (!NETPLAY->PACKETS_RECEIVED) {
+        uint64_t now = SDL_GetTicksNS();
+        if (now - start_ns >= timeout_ms * 1000000ULL) {
+            return false;
+        }
+        if (now >= next_send_ns) {
+            send_inputs(now);
+            next_send_ns = now + CONNECT_INTERVAL_NS;
+        }
+        poll_socket();
+        SDL_DelayNS(POLL_INTERVAL_NS);
+    }
+    return true;
+}
+
+/*
+ * Runs the next frame with the local joypad state, or nothing if the remote
+ * input is too far behind or the peer needs to catch up. Returns whether a
+ * frame ran, the local instance is selected either way.
+ */
+bool netplay_run_frame(uint8_t buttons, uint8_t d_pad) {
+    link_select(NETPLAY->LOCAL_PLAYER);
+    bool render = !PPU->SKIP_RENDER;
+    poll_socket();
+    if (NETPLAY->ROLLBACK_FRAME != NO_ROLLBACK) {
+        roll_back();
+    }
+
+    bool ran = false;
+    if (NETPLAY->REMOTE_FRAMES + NETPLAY_MAX_ROLLBACK <= NETPLAY->FRAME) {
+        NETPLAY->STALLS++;
+    }
+    else if (ahead_of_peer()) {
+        NETPLAY->SYNC_WAITS++;
+    }
+    else {
+        NETPLAY->LOCAL_INPUTS[NETPLAY->FRAME & HISTORY_MASK] = (buttons & 0x0F) << 4 | (d_pad & 0x0F);
+        save_frame(NETPLAY->FRAME);
+        check_frame();
+        simulate(NETPLAY->FRAME, render);
+        NETPLAY->FRAME++;
+        ran = true;
+    }
+    send_inputs(SDL_GetTicksNS());
+    flush_outbox(SDL_GetTicksNS());
+    link_select(NETPLAY->LOCAL_PLAYER);
+    PPU->SKIP_RENDER = !render;
+    return ran;
+}
+
+/*
+ * Receives and sends between frames, so packets are not held up until the next one
+ */
+void netplay_poll() {
+    poll_socket();
+}
+
+/*
+ * Stops running frames and waits up to TIMEOUT_MS until both sides have all
+ * of each other's inputs, then settles the last prediction. Both processes
+ * then hold the same state, unless they desynced.
+ */
+bool netplay_finish(uint32_t timeout_ms) {
+    uint64_t start_ns = SDL_GetTicksNS();
+    uint64_t next_send_ns = start_ns;
+    uint64_t done_ns = 0;
+    while (!done_ns || SDL_GetTicksNS() - done_ns < FINISH_LINGER_NS) {
+        uint64_t now = SDL_GetTicksNS();
+        if (now - start_ns >= timeout_ms * 1000000ULL) {
+            break;
+        }
+        if (now >= next_send_ns) {
+            send_inputs(now);
+            next_send_ns = now + POLL_INTERVAL_NS * 5;
+        }
+        poll_socket();
+        //the peer might still be waiting for our acknowledgement, keep answering for a while
+        if (!done_ns && NETPLAY->REMOTE_FRAME == NETPLAY->FRAME && NETPLAY->REMOTE_FRAMES == NETPLAY->FRAME &&
+            NETPLAY->ACKED_FRAMES == NETPLAY->FRAME) {
+            done_ns = now;
+        }
+        SDL_DelayNS(POLL_INTERVAL_NS);
+    }
+    if (NETPLAY->ROLLBACK_FRAME != NO_ROLLBACK) {
+        roll_back();
+    }
+    link_select(NETPLAY->LOCAL_PLAYER);
+    return done_ns != 0;
+}
+
+/*
+ * Hash of both instances as they are now, equal on both sides after netplay_finish()
+ */
+uint64_t netplay_state_hash() {
+    NETPLAY_FRAME_STATE* state = &NETPLAY->STATES[NETPLAY->FRAME % NETPLAY_STATES];
+    save_frame(NETPLAY->FRAME);
+    uint64_t hash = FNV_OFFSET;
+    for (uint8_t player = 0; player < LINK_PLAYERS; player++) {
+        hash = savestate_hash(&state->PLAYERS[player], hash);
+    }
+    link_select(NETPLAY->LOCAL_PLAYER);
+    return hash;
+}
+
+void netplay_print_stats() {
+    printf("Netplay: player %u, %llu frames, %llu packets sent, %llu received, %llu dropped\n",
+           NETPLAY->LOCAL_PLAYER + 1, (unsigned long long) NETPLAY->FRAME,
+           (unsigned long long) NETPLAY->PACKETS_SENT, (unsigned long long) NETPLAY->PACKETS_RECEIVED,
+           (unsigned long long) NETPLAY->PACKETS_DROPPED);
+    if (NETPLAY->RTT_SAMPLES) {
+        printf("Netplay latency: round trip avg %.2f ms, max %.2f ms\n",
+               NETPLAY->RTT_SUM_NS / 1e6 / NETPLAY->RTT_SAMPLES, NETPLAY->RTT_MAX_NS / 1e6);
+    }
+    if (NETPLAY->REMOTE_INPUTS_LATE) {
+        printf("Netplay remote input: %llu predicted, late by %.2f frames on average\n",
+               (unsigned long long) NETPLAY->REMOTE_INPUTS_LATE,
+               (double) NETPLAY->REMOTE_LAG_SUM / NETPLAY->REMOTE_INPUTS_LATE);
+    }
+    printf("Netplay rollbacks: %llu, depth avg %.2f max %llu frames, %llu frames simulated again\n",
+           (unsigned long long) NETPLAY->ROLLBACKS,
+           NETPLAY->ROLLBACKS ? (double) NETPLAY->RESIM_FRAMES / NETPLAY->ROLLBACKS : 0.0,
+           (unsigned long long) NETPLAY->ROLLBACK_DEPTH_MAX, (unsigned long long) NETPLAY->RESIM_FRAMES);
+    if (NETPLAY->ROLLBACKS) {
+        printf("Netplay re-simulation: %.3f ms per frame run, %.3f ms per frame simulated again, max %.3f ms\n",
+               NETPLAY->FRAME ? NETPLAY->RESIM_NS / 1e6 / NETPLAY->FRAME : 0.0,
+               NETPLAY->RESIM_NS / 1e6 / NETPLAY->RESIM_FRAMES, NETPLAY->RESIM_MAX_NS / 1e6);
+    }
+    printf("Netplay waits: %llu stalled on remote input, %llu letting the peer catch up\n",
+           (unsigned long long) NETPLAY->STALLS, (unsigned long long) NETPLAY->SYNC_WAITS);
+    printf("Netplay desync checks: %llu, %llu mismatched\n", (unsigned long long) NETPLAY->CHECKS,
+           (unsigned long long) NETPLAY->DESYNCS);
+}
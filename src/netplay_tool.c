@@ -0,0 +1,135 @@
+#include <common.h>
+#include <SDL3/SDL.h>
+#include <gb.h>
+#include <link.h>
+#include <netplay.h>
+
+#define DEFAULT_FRAMES 600          //~10 emulated seconds
+#define CONNECT_TIMEOUT_MS 10000
+#define FINISH_TIMEOUT_MS 10000
+#define FRAME_NS ((uint64_t) (FRAME_TIME_MS * 1e6))
+#define POLL_NS 1000000ULL
+
+/*
+ * Headless netplay session at the Game Boy's frame rate, for testing two
+ * processes against each other on one machine. The local player's joypad
+ * follows a script seeded by --seed and the player number, holding random
+ * buttons for a random number of frames, so the remote side mispredicts
+ * regularly. At the end both processes wait for each other's last inputs
+ * and print the hash of the state they agree on, which has to be the same.
+ */
+
+static void print_usage(const char* program) {
+    fprintf(stderr, "Usage: %s <rom_a.gb> [rom_b.gb] --player <1|2> --peer <host:port> [options]\n", program);
+    fprintf(stderr, "  --port <N>       local UDP port (default %d)\n", NETPLAY_DEFAULT_PORT);
+    fprintf(stderr, "  --frames <N>     frames to play (default %d)\n", DEFAULT_FRAMES);
+    fprintf(stderr, "  --delay <ms>     hold every packet sent back this long\n");
+    fprintf(stderr, "  --loss <percent> drop this share of the packets sent\n");
+    fprintf(stderr, "  --seed <N>       seed of the scripted joypad input\n");
+}
+
+/*
+ * Returns TEXT as a number from MIN to MAX, prints the usage and exits unless all of it is one
+ */
+static uint32_t parse_number(const char* program, const char* text, uint32_t min, uint32_t max) {
+    char* end;
+    unsigned long long number = strtoull(text, &end, 10);
+    if (*text < '0' || *text > '9' || *end || number < min || number > max) {
+        print_usage(program);
+        exit(1);
+    }
+    return (uint32_t) number;
+}
+
+static uint32_t next_random(uint32_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+int main(int argc, char* argv[]) {
+    const char* roms[LINK_PLAYERS] = {nullptr, nullptr};
+    const char* peer = nullptr;
+    uint8_t player = 0;
+    uint16_t port = NETPLAY_DEFAULT_PORT;
+    uint32_t frames = DEFAULT_FRAMES;
+    uint32_t delay_ms = 0;
+    uint8_t loss_percent = 0;
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--player") && i + 1 < argc) {
+            player = (uint8_t) parse_number(argv[0], argv[++i], 1, LINK_PLAYERS);
+        }
+        else if (!strcmp(argv[i], "--peer") && i + 1 < argc) {
+            peer = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--port") && i + 1 < argc) {
+            port = (uint16_t) parse_number(argv[0], argv[++i], 1, UINT16_MAX);
+        }
+        else if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            frames = parse_number(argv[0], argv[++i], 1, UINT32_MAX);
+        }
+        else if (!strcmp(argv[i], "--delay") && i + 1 < argc) {
+            delay_ms = parse_number(argv[0], argv[++i], 0, UINT32_MAX);
+        }
+        else if (!strcmp(argv[i], "--loss") && i + 1 < argc) {
+            loss_percent = (uint8_t) parse_number(argv[0], argv[++i], 0, 99);
+        }
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = parse_number(argv[0], argv[++i], 0, UINT32_MAX);
+        }
+        else if (!roms[1] && argv[i][0] != '-') {
+            roms[roms[0] ? 1 : 0] = argv[i];
+        }
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!roms[0] || !peer || !player) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (!roms[1]) {
+        roms[1] = roms[0];
+    }
+
+    link_init(roms[0], roms[1]);
+    netplay_init(player - 1, port, peer);
+    netplay_simulate(delay_ms, loss_percent);
+    if (!netplay_connect(CONNECT_TIMEOUT_MS)) {
+        fprintf(stderr, "No answer from %s\n", peer);
+        netplay_free();
+        link_free();
+        return 1;
+    }
+
+    uint32_t script = seed * 2654435761u + player;
+    uint8_t joypad = 0xFF;
+    uint32_t hold = 0;
+    uint64_t next_frame_ns = SDL_GetTicksNS();
+    while (NETPLAY->FRAME < frames) {
+        if (NETPLAY->FRAME >= hold) {
+            //mostly one or two keys at a time, now and then nothing
+            joypad = next_random(&script) % 4 ? ~(1 << next_random(&script) % 8 | 1 << next_random(&script) % 8) : 0xFF;
+            hold = NETPLAY->FRAME + 4 + next_random(&script) % 40;
+        }
+        netplay_run_frame(0xF0 | joypad >> 4, 0xF0 | (joypad & 0x0F));
+
+        next_frame_ns += FRAME_NS;
+        for (uint64_t now = SDL_GetTicksNS(); now < next_frame_ns; now = SDL_GetTicksNS()) {
+            netplay_poll();
+            SDL_DelayNS(next_frame_ns - now < POLL_NS ? next_frame_ns - now : POLL_NS);
+        }
+    }
+    bool finished = netplay_finish(FINISH_TIMEOUT_MS);
+
+    netplay_print_stats();
+    printf("State hash after frame %llu: %016llx%s\n", (unsigned long long) NETPLAY->FRAME,
+           (unsigned long long) netplay_state_hash(), finished ? "" : " (peer did not finish)");
+    int exit_code = finished && !NETPLAY->DESYNCS ? 0 : 1;
+    netplay_free();
+    link_free();
+    return exit_code;
+}
@@ -0,0 +1,112 @@
+#include <common.h>
+#include <SDL3/SDL.h>
+#include <pacer.h>
+
+#define MIN_SPIN_THRESHOLD_NS 200000     //0.2 ms
+#define MAX_SPIN_THRESHOLD_NS 4000000    //4 ms
+#define MAX_FRAMES_BEHIND 4
+
+void pacer_init(uint64_t period_num, uint64_t period_den) {
+    PACER = (PACER_STRUCT*) calloc(1, sizeof(PACER_STRUCT));
+    PACER->PERIOD_NUM = period_num;
+    PACER->PERIOD_DEN = period_den;
+    PACER->SPIN_THRESHOLD_NS = 1000000;
+    PACER->OVERSLEEP_AVG_NS = 0;
+    PACER->START_NS = SDL_GetTicksNS();
+    PACER->DEADLINE_NS = PACER->START_NS;
+    PACER->DEADLINE_REMAINDER = 0;
+}
+
+void pacer_free() {
+    free(PACER);
+}
+
+/*
+ * Moves the deadline forward by exactly one period
+ */
+static void advance_deadline() {
+    PACER->DEADLINE_NS += PACER->PERIOD_NUM / PACER->PERIOD_DEN;
+    PACER->DEADLINE_REMAINDER += PACER->PERIOD_NUM % PACER->PERIOD_DEN;
+    if (PACER->DEADLINE_REMAINDER >= PACER->PERIOD_DEN) {
+        PACER->DEADLINE_REMAINDER -= PACER->PERIOD_DEN;
+        PACER->DEADLINE_NS++;
+    }
+}
+
+/*
+ * Sleeps until shortly before DEADLINE, learning how late the OS wakes us up
+ */
+static void sleep_until(uint64_t deadline) {
+    uint64_t now = SDL_GetTicksNS();
+    if (deadline <= now + PACER->SPIN_THRESHOLD_NS) {
+        return;
+    }
+    uint64_t wake_target = deadline - PACER->SPIN_THRESHOLD_NS;
+    SDL_DelayNS(wake_target - now);
+    now = SDL_GetTicksNS();
+    uint64_t oversleep = now > wake_target ? now - wake_target : 0;
+
+    //moving average of the oversleep, the threshold keeps twice that as margin
+    PACER->OVERSLEEP_AVG_NS = (PACER->OVERSLEEP_AVG_NS * 7 + oversleep) / 8;
+    uint64_t threshold = PACER->OVERSLEEP_AVG_NS * 2;
+    if (oversleep > threshold) {
+        threshold = oversleep;
+    }
+    if (threshold < MIN_SPIN_THRESHOLD_NS) {
+        threshold = MIN_SPIN_THRESHOLD_NS;
+    }
+    else if (threshold > MAX_SPIN_THRESHOLD_NS) {
+        threshold = MAX_SPIN_THRESHOLD_NS;
+    }
+    PACER->SPIN_THRESHOLD_NS = threshold;
+}
+
+static void record_jitter(uint64_t jitter) {
+    PACER->JITTER_SUM_NS += (double) jitter;
+    PACER->JITTER_SQUARE_SUM_NS += (double) jitter * (double) jitter;
+    if (jitter > PACER->JITTER_MAX_NS) {
+        PACER->JITTER_MAX_NS = jitter;
+    }
+}
+
+/*
+ * Waits until the end of the current frame on the absolute timeline
+ */
+void pacer_wait_next_frame() {
+    advance_deadline();
+    PACER->FRAMES++;
+    uint64_t deadline = PACER->DEADLINE_NS;
+    uint64_t now = SDL_GetTicksNS();
+
+    if (now >= deadline) {
+        PACER->LATE_FRAMES++;
+        //too far behind to catch up without running in a burst, restart the timeline
+        if (now - deadline > MAX_FRAMES_BEHIND * PACER->PERIOD_NUM / PACER->PERIOD_DEN) {
+            PACER->RESYNCS++;
+            PACER->DEADLINE_NS = now;
+            PACER->DEADLINE_REMAINDER = 0;
+        }
+        return;
+    }
+
+    sleep_until(deadline);
+    while ((now = SDL_GetTicksNS()) < deadline) {
+        SDL_CPUPauseInstruction();
+    }
+    record_jitter(now - deadline);
+}
+
+void pacer_print_stats() {
+    uint64_t on_time = PACER->FRAMES - PACER->LATE_FRAMES;
+    double mean = on_time ? PACER->JITTER_SUM_NS / on_time : 0.0;
+    double variance = on_time ? PACER->JITTER_SQUARE_SUM_NS / on_time - mean * mean : 0.0;
+    double elapsed_s = (double) (SDL_GetTicksNS() - PACER->START_NS) / 1e9;
+    printf("Frame rate: %.4f Hz (target %.4f Hz)\n",
+           elapsed_s > 0 ? PACER->FRAMES / elapsed_s : 0.0,
+           1e9 * PACER->PERIOD_DEN / (double) PACER->PERIOD_NUM);
+    printf("Pacing jitter mean: %.1f us, stddev: %.1f us, max: %.1f us\n",
+           mean / 1e3, variance > 0 ? SDL_sqrt(variance) / 1e3 : 0.0, PACER->JITTER_MAX_NS / 1e3);
+    printf("Late frames: %llu, timeline resyncs: %llu, spin threshold: %.1f us\n",
+           (unsigned long long) PACER->LATE_FRAMES, (unsigned long long) PACER->RESYNCS,
+           PACER->SPIN_THRESHOLD_NS / 1e3);
+}
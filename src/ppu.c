@@ -4,20 +4,21 @@
 #include <lcd.h>
 #include <queue.h>
 #include <memory.h>
+#include <framebuffer.h>
 #include <ppu.h>
+#include <profiler.h>
+#include <timeline.h>
+#include <heatmap.h>
 
 #define BITS_PER_TILE 16
 #define CYCLES_PER_LINE 456
-#define PIXELS_PER_TILE 8
 #define OAM_BASE_ADDRESS 0xFE00
 
 
 static void pop_pixel();
+static void skip_pop_pixel();
 
 void ppu_init() {
-    PPU = malloc(sizeof(PPU_STRUCT));
-    PPU->CURRENT_OBJ = malloc(sizeof(OAM_STRUCT));
-    PPU->PIXEL_DATA = calloc(PIXELS_PER_TILE, sizeof(PIXEL_DATA));
     PPU->STATE = V_BLANK;
     PPU->RENDER_LINE_CYCLE = 1;
     PPU->FETCH_TYPE = BACKGROUND;
@@ -27,18 +28,15 @@ void ppu_init() {
     PPU->POP_ENABLE = true;
     PPU->FIRST_TILE_DONE = false;
     PPU->WINDOW_LINE_COUNTER = 0;
-}
-
-void ppu_free() {
-    free(PPU->PIXEL_DATA);
-    free(PPU->CURRENT_OBJ);
-    free(PPU);
+    PPU->SKIP_RENDER = false;
 }
 
 static void oam_search_validate() {
     uint16_t oam_address = OAM_BASE_ADDRESS + (PPU->RENDER_LINE_CYCLE - 1) * 2;
     uint8_t obj_y_pos = MEMORY[oam_address];
     uint8_t obj_x_pos = MEMORY[oam_address + 1];
+    HEATMAP_ACCESS(HEAT_PPU, HEAT_READ, oam_address);
+    HEATMAP_ACCESS(HEAT_PPU, HEAT_READ, oam_address + 1);
     uint8_t lcd_y_position = MEMORY[LY];
     uint8_t obj_height = MEMORY[LCDC] & 0x04 ? 16 : 8;
 
@@ -46,9 +44,9 @@ static void oam_search_validate() {
     //an objects y position is equal to their vertical position on screen + 16
     if ((lcd_y_position >= obj_y_pos - 16) && (lcd_y_position < obj_y_pos - 16 + obj_height)) {
         PPU->VALID_OAM = true;
-        PPU->CURRENT_OBJ->y_pos = obj_y_pos;
-        PPU->CURRENT_OBJ->x_pos = obj_x_pos;
-        PPU->CURRENT_OBJ->address = oam_address;
+        PPU->CURRENT_OBJ.y_pos = obj_y_pos;
+        PPU->CURRENT_OBJ.x_pos = obj_x_pos;
+        PPU->CURRENT_OBJ.address = oam_address;
     }
     else {
         PPU->VALID_OAM = false;
@@ -57,14 +55,16 @@ static void oam_search_validate() {
 
 static void oam_search_store() {
     if (PPU->VALID_OAM) {
-        uint16_t oam_address = PPU->CURRENT_OBJ->address;
+        uint16_t oam_address = PPU->CURRENT_OBJ.address;
         uint8_t oam_attributes = MEMORY[oam_address + 3];
-        PPU->CURRENT_OBJ->tile_index = MEMORY[oam_address + 2];
-        PPU->CURRENT_OBJ->priority = oam_attributes & 0x80;
-        PPU->CURRENT_OBJ->y_flip = oam_attributes & 0x40;
-        PPU->CURRENT_OBJ->x_flip = oam_attributes & 0x20;
-        PPU->CURRENT_OBJ->palette = oam_attributes & 0x10;
-        heap_insert(PPU->CURRENT_OBJ);
+        PPU->CURRENT_OBJ.tile_index = MEMORY[oam_address + 2];
+        HEATMAP_ACCESS(HEAT_PPU, HEAT_READ, oam_address + 2);
+        HEATMAP_ACCESS(HEAT_PPU, HEAT_READ, oam_address + 3);
+        PPU->CURRENT_OBJ.priority = oam_attributes & 0x80;
+        PPU->CURRENT_OBJ.y_flip = oam_attributes & 0x40;
+        PPU->CURRENT_OBJ.x_flip = oam_attributes & 0x20;
+        PPU->CURRENT_OBJ.palette = oam_attributes & 0x10;
+        heap_insert(&PPU->CURRENT_OBJ);
     }
     if (PPU->RENDER_LINE_CYCLE == 80) {
         PPU->STATE = PIXEL_TRANSFER;
@@ -106,12 +106,17 @@ static void fetch_tile() {
     uint8_t tile_y;
     uint16_t base_address;
     uint16_t tile_map_address;
+    if (PPU->SKIP_RENDER) {
+        PPU->PIXEL_TRANSFER_STATE = GET_DATA_LOW;
+        return;
+    }
     if (PPU->FETCH_TYPE == WINDOW) {
         base_address = MEMORY[LCDC] & 0x40 ? 0x9C00 : 0x9800;
         tile_x = PPU->FETCHER_X;
         tile_y = PPU->WINDOW_LINE_COUNTER;
         tile_map_address = base_address + tile_x + ((tile_y / 8) * 32);
         PPU->TILE_INDEX = MEMORY[tile_map_address];
+        HEATMAP_ACCESS(HEAT_PPU, HEAT_READ, tile_map_address);
     }
     else if (PPU->FETCH_TYPE == BACKGROUND) {
         base_address = MEMORY[LCDC] & 0x08 ? 0x9C00 : 0x9800;
@@ -120,6 +125,7 @@ static void fetch_tile() {
         tile_map_address = (base_address + tile_x + ((tile_y / 8) * 32));
         //TODO IF VRAM IS BLOCKED THAN TILE NUMBER WILL BE READ AS 0xFF
         PPU->TILE_INDEX = MEMORY[tile_map_address];
+        HEATMAP_ACCESS(HEAT_PPU, HEAT_READ, tile_map_address);
     }
     else {
         PPU->TILE_INDEX = heap_peek()->tile_index;
@@ -131,6 +137,10 @@ static void fetch_tile() {
 }
 
 static void get_tile_data_low() {
+    if (PPU->SKIP_RENDER) {
+        PPU->PIXEL_TRANSFER_STATE = GET_DATA_HIGH;
+        return;
+    }
     //get base address
     if ((MEMORY[LCDC] & 0x10) || (PPU->FETCH_TYPE == OBJECT)) {
         PPU->TILE_ADDRESS = 0x8000 + (PPU->TILE_INDEX * BITS_PER_TILE);
@@ -154,29 +164,40 @@ static void get_tile_data_low() {
         PPU->TILE_ADDRESS += 2 * y_offset;
     }
     PPU->DATA_LOW = MEMORY[PPU->TILE_ADDRESS];
+    HEATMAP_ACCESS(HEAT_PPU, HEAT_READ, PPU->TILE_ADDRESS);
     PPU->PIXEL_TRANSFER_STATE = GET_DATA_HIGH;
 }
 
 static void get_tile_data_high() {
-    PPU->DATA_HIGH = MEMORY[PPU->TILE_ADDRESS+1];
     if (PPU->FETCH_TYPE == BACKGROUND && PPU->RENDER_X == 0 && !PPU->FIRST_TILE_DONE) {
         PPU->FIRST_TILE_DONE = true;
         PPU->PIXEL_TRANSFER_STATE = FETCH_TILE;
     }
     else {
         PPU->PIXEL_TRANSFER_STATE = PUSH;
-        construct_pixel_data();
+        if (!PPU->SKIP_RENDER) {
+            PPU->DATA_HIGH = MEMORY[PPU->TILE_ADDRESS+1];
+            HEATMAP_ACCESS(HEAT_PPU, HEAT_READ, PPU->TILE_ADDRESS + 1);
+            construct_pixel_data();
+        }
     }
 }
 
 static void pixel_push() {
-    if ((PPU->FETCH_TYPE != OBJECT) && (pixel_fifo_is_empty(PPU->BACKGROUND_FIFO))) {
-        background_fifo_push(PPU->PIXEL_DATA);
+    if ((PPU->FETCH_TYPE != OBJECT) && (pixel_fifo_is_empty(&PPU->BACKGROUND_FIFO))) {
+        if (PPU->SKIP_RENDER) {
+            pixel_fifo_skip_push(&PPU->BACKGROUND_FIFO);
+        }
+        else {
+            background_fifo_push(PPU->PIXEL_DATA);
+        }
         PPU->FETCHER_X++;
         PPU->PIXEL_TRANSFER_STATE = FETCH_TILE;
     }
     else if (PPU->FETCH_TYPE == OBJECT) {
-        sprite_fifo_push(PPU->PIXEL_DATA);
+        if (!PPU->SKIP_RENDER) {
+            sprite_fifo_push(PPU->PIXEL_DATA);
+        }
         heap_delete_min();
         PPU->PIXEL_TRANSFER_STATE = FETCH_TILE;
         if ((PPU->RENDER_X >= MEMORY[WX] - 7) && (MEMORY[LY] > MEMORY[WY]) && (MEMORY[LCDC] & 0x20)) {
@@ -189,20 +210,41 @@ static void pixel_push() {
     }
 }
 
+/*
+ * Moves the render counter to the next pixel and enters h-blank once the line is done
+ */
+static void next_render_x() {
+    PPU->RENDER_X++;
+    if (PPU->RENDER_X == 160) {
+        if (!PPU->SKIP_RENDER) {
+            framebuffer_commit_line();
+        }
+        PPU->FETCHER_X = 0;
+        PPU->RENDER_X = 0;
+        pixel_fifo_clear(&PPU->BACKGROUND_FIFO);
+        pixel_fifo_clear(&PPU->SPRITE_FIFO);
+        PPU->STATE = H_BLANK;
+        MEMORY[STAT] = (MEMORY[STAT] & 0xFC);
+        if (MEMORY[STAT] & 0x08) {
+            MEMORY[IF] |= 0x02;
+        }
+    }
+}
+
 static void pop_pixel() {
     PIXEL_DATA pixel_data;
 
     //throw away scroll pixels
     if (PPU->NUM_SCROLL_PIXELS) {
-        pixel_fifo_pop(PPU->BACKGROUND_FIFO, &pixel_data);
+        pixel_fifo_pop(&PPU->BACKGROUND_FIFO, &pixel_data);
         PPU->NUM_SCROLL_PIXELS--;
         return;
     //merge pixel from both fifos
-    } else if (!pixel_fifo_is_empty(PPU->SPRITE_FIFO)) {
+    } else if (!pixel_fifo_is_empty(&PPU->SPRITE_FIFO)) {
         PIXEL_DATA bg_pixel_data;
         PIXEL_DATA obj_pixel_data;
-        pixel_fifo_pop(PPU->BACKGROUND_FIFO, &bg_pixel_data);
-        pixel_fifo_pop(PPU->SPRITE_FIFO, &obj_pixel_data);
+        pixel_fifo_pop(&PPU->BACKGROUND_FIFO, &bg_pixel_data);
+        pixel_fifo_pop(&PPU->SPRITE_FIFO, &obj_pixel_data);
         if (MEMORY[LCDC] & 0x01) {
             bool transparent = obj_pixel_data.binary_data == 0x00;
             bool priority = obj_pixel_data.priority && (bg_pixel_data.binary_data != 0x00);
@@ -214,21 +256,23 @@ static void pop_pixel() {
     }
     //pop from background fifo
     else {
-        pixel_fifo_pop(PPU->BACKGROUND_FIFO, &pixel_data);
+        pixel_fifo_pop(&PPU->BACKGROUND_FIFO, &pixel_data);
     }
     lcd_update_pixel(&pixel_data);
-    PPU->RENDER_X++;
-    if (PPU->RENDER_X == 160) {
-        PPU->FETCHER_X = 0;
-        PPU->RENDER_X = 0;
-        pixel_fifo_clear(PPU->BACKGROUND_FIFO);
-        pixel_fifo_clear(PPU->SPRITE_FIFO);
-        PPU->STATE = H_BLANK;
-        MEMORY[STAT] = (MEMORY[STAT] & 0xFC);
-        if (MEMORY[STAT] & 0x08) {
-            MEMORY[IF] |= 0x02;
-        }
+    next_render_x();
+}
+
+/*
+ * Pops a pixel on a skipped frame, the sprite FIFO is never filled so only
+ * the background FIFO needs to advance to keep the line's timing
+ */
+static void skip_pop_pixel() {
+    pixel_fifo_skip_pop(&PPU->BACKGROUND_FIFO);
+    if (PPU->NUM_SCROLL_PIXELS) {
+        PPU->NUM_SCROLL_PIXELS--;
+        return;
     }
+    next_render_x();
 }
 
 static void pixel_renderer() {
@@ -237,7 +281,7 @@ static void pixel_renderer() {
     }
     //Check for window
     if ((PPU->RENDER_X == MEMORY[WX] - 7) && (MEMORY[LY] > MEMORY[WY]) && (PPU->FETCH_TYPE == BACKGROUND) && (MEMORY[LCDC] & 0x20)) {
-        pixel_fifo_clear(PPU->BACKGROUND_FIFO);
+        pixel_fifo_clear(&PPU->BACKGROUND_FIFO);
         PPU->PIXEL_TRANSFER_STATE = FETCH_TILE;
         PPU->FETCHER_X = 0;
         PPU->FETCH_TYPE = WINDOW;
@@ -257,8 +301,8 @@ static void pixel_renderer() {
         return;
     }
     //pixel_renderer if enough data in fifo
-    if (!pixel_fifo_is_empty(PPU->BACKGROUND_FIFO)) {
-        pop_pixel();
+    if (!pixel_fifo_is_empty(&PPU->BACKGROUND_FIFO)) {
+        PPU->SKIP_RENDER ? skip_pop_pixel() : pop_pixel();
     }
 }
 
@@ -325,6 +369,8 @@ void v_blank() {
 }
 
 void execute_next_PPU_cycle() {
+    PROFILE_PPU_DOT(PPU->STATE);
+    TIMELINE_PPU_DOT(PPU->STATE);
     if (PPU->PENALTY) {
         if (PPU->STATE == PIXEL_TRANSFER) {
             pixel_renderer();
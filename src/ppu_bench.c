@@ -0,0 +1,250 @@
+#include <common.h>
+#include <SDL3/SDL.h>
+#include <ppu.h>
+#include <memory.h>
+#include <framebuffer.h>
+#include <gb.h>
+
+#define ROM_SIZE 0x8000
+#define DEFAULT_FRAMES 300
+#define DOTS_PER_LINE 456
+#define LINES_PER_FRAME 154
+#define OAM_START 0xFE00
+#define OAM_END 0xFEA0
+#define SPRITES_PER_LINE 10
+#define TILE_DATA_START 0x8000
+#define TILE_MAP_END 0xA000
+#define WINDOW_MID_LINE_WX 87   //window starts at x 80
+#define RANDOM_SEED 0x2545F491
+
+/*
+ * PPU micro-benchmark. The PPU is driven dot by dot with no CPU, VRAM is filled
+ * with noise and each scenario sets up OAM and the LCD registers to model one of
+ * the expensive cases of the pixel FIFO. Scenarios that need more than 40 sprites
+ * in a frame rewrite OAM before every line the way a raster effect would.
+ */
+
+typedef struct PPU_RENDERER {
+    const char* NAME;
+    void (*STEP)();     //runs one dot
+    bool SKIP_RENDER;   //renderer only keeps mode timing, like a skipped frame
+} PPU_RENDERER;
+
+static const PPU_RENDERER RENDERERS[] = {
+    {"fifo", execute_next_PPU_cycle, false},
+    {"fifo-skip", execute_next_PPU_cycle, true},
+};
+
+typedef struct SCENARIO {
+    const char* NAME;
+    const char* DESCRIPTION;
+    uint8_t LCDC_VALUE;
+    void (*LINE)(uint8_t line);     //called before each line is drawn, can be nullptr
+} SCENARIO;
+
+typedef struct BENCH_RESULT {
+    const SCENARIO* SCENARIO;
+    const PPU_RENDERER* RENDERER;
+    double NS_PER_DOT;
+    double NS_PER_FRAME;
+    uint64_t HASH;
+} BENCH_RESULT;
+
+static uint32_t random_state;
+
+static uint8_t next_random() {
+    //xorshift32, fixed seed so every run draws the same picture
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return (uint8_t) random_state;
+}
+
+/*
+ * Writes SPRITES_PER_LINE sprites into OAM so they all cover LINE. Sprites start
+ * at a multiple of HEIGHT so every row of the tile gets fetched over a frame.
+ */
+static void place_sprites(uint8_t line, uint8_t height, bool overlap) {
+    uint8_t top = line - (line % height);
+    for (uint8_t i = 0; i < SPRITES_PER_LINE; i++) {
+        uint16_t address = OAM_START + i * 4;
+        MEMORY[address] = top + 16;
+        if (overlap) {
+            //pairs land on the same pixels, every sprite is x flipped
+            MEMORY[address + 1] = 40 + (i / 2) * 4 + (i % 2);
+            MEMORY[address + 3] = 0x20 | (i % 2 ? 0x90 : 0x00);
+        }
+        else {
+            MEMORY[address + 1] = 8 + i * 16;
+            MEMORY[address + 3] = 0x00;
+        }
+    }
+}
+
+static void sprites_line(uint8_t line) {
+    place_sprites(line, 8, false);
+}
+
+static void overlap_line(uint8_t line) {
+    place_sprites(line, 8, true);
+}
+
+static void tall_sprites_line(uint8_t line) {
+    place_sprites(line, 16, false);
+}
+
+static void scroll_line(uint8_t line) {
+    //walks NUM_SCROLL_PIXELS through 0-7 and the coarse scroll through the map
+    MEMORY[SCX] = line * 3;
+}
+
+static void worst_case_line(uint8_t line) {
+    scroll_line(line);
+    place_sprites(line, 16, true);
+}
+
+static const SCENARIO SCENARIOS[] = {
+    {"background", "background only, no scroll", 0x91, nullptr},
+    {"scroll", "SCX changes every line, 0-7 scroll pixels dropped", 0x91, scroll_line},
+    {"window", "window enabled mid-line at x 80", 0xF1, nullptr},
+    {"sprites", "10 8x8 sprites on every line", 0x93, sprites_line},
+    {"overlap", "10 overlapping x flipped sprites on every line", 0x93, overlap_line},
+    {"sprites8x16", "10 8x16 sprites on every line", 0x97, tall_sprites_line},
+    {"worst", "scroll, mid-line window and 10 overlapping x flipped 8x16 sprites", 0xF7, worst_case_line},
+};
+
+/*
+ * Fills VRAM with noise and sets the registers and OAM for SCENARIO
+ */
+static void setup_scenario(const SCENARIO* scenario) {
+    random_state = RANDOM_SEED;
+    for (uint32_t address = TILE_DATA_START; address < TILE_MAP_END; address++) {
+        MEMORY[address] = next_random();
+    }
+    memset(&MEMORY[OAM_START], 0, OAM_END - OAM_START);
+    for (uint8_t i = 0; i < SPRITES_PER_LINE; i++) {
+        MEMORY[OAM_START + i * 4 + 2] = i * 2;
+    }
+    MEMORY[LCDC] = scenario->LCDC_VALUE;
+    MEMORY[SCX] = 0;
+    MEMORY[SCY] = 0;
+    MEMORY[WY] = 0;
+    MEMORY[WX] = WINDOW_MID_LINE_WX;
+    MEMORY[BGP] = 0xE4;
+    MEMORY[OBP0] = 0xE4;
+    MEMORY[OBP1] = 0x1B;
+}
+
+static void run_frame_dots(const PPU_RENDERER* renderer, const SCENARIO* scenario) {
+    for (uint8_t line = 0; line < LINES_PER_FRAME; line++) {
+        if (scenario->LINE && line < WINDOW_HEIGHT) {
+            scenario->LINE(line);
+        }
+        for (uint16_t dot = 0; dot < DOTS_PER_LINE; dot++) {
+            renderer->STEP();
+        }
+    }
+}
+
+/*
+ * Steps the PPU out of its power on v-blank so runs start on the first dot of a frame
+ */
+static void align_to_frame() {
+    while (MEMORY[LY] != 0 || PPU->STATE != OAM_SEARCH || PPU->RENDER_LINE_CYCLE != 1) {
+        execute_next_PPU_cycle();
+    }
+}
+
+static BENCH_RESULT bench_scenario(const PPU_RENDERER* renderer, const SCENARIO* scenario, uint32_t frames) {
+    setup_scenario(scenario);
+    PPU->SKIP_RENDER = renderer->SKIP_RENDER;
+    //one untimed frame so the FIFOs and heap are in their steady state
+    run_frame_dots(renderer, scenario);
+    uint64_t start = SDL_GetTicksNS();
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        run_frame_dots(renderer, scenario);
+    }
+    uint64_t elapsed_ns = SDL_GetTicksNS() - start;
+    if (MEMORY[LY] != 0 || PPU->RENDER_LINE_CYCLE != 1) {
+        fprintf(stderr, "%s: frame did not end after %d dots (LY %d)\n", scenario->NAME, CYCLES_PER_FRAME, MEMORY[LY]);
+    }
+    double total_frames = frames ? frames : 1;
+    BENCH_RESULT result = {
+        .SCENARIO = scenario,
+        .RENDERER = renderer,
+        .NS_PER_DOT = elapsed_ns / (total_frames * CYCLES_PER_FRAME),
+        .NS_PER_FRAME = elapsed_ns / total_frames,
+        .HASH = renderer->SKIP_RENDER ? 0 : frame_hash(&FRAMEBUFFER->FRAME)
+    };
+    PPU->SKIP_RENDER = false;
+    return result;
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr, "Usage: %s [options]\n", program);
+    fprintf(stderr, "  --frames <N>        frames to run per scenario (default %d)\n", DEFAULT_FRAMES);
+    fprintf(stderr, "  --scenario <name>   only run one scenario:\n");
+    for (size_t s = 0; s < sizeof(SCENARIOS) / sizeof(SCENARIOS[0]); s++) {
+        fprintf(stderr, "                        %-12s %s\n", SCENARIOS[s].NAME, SCENARIOS[s].DESCRIPTION);
+    }
+    fprintf(stderr, "  --renderer <name>   only run one renderer (default all)\n");
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t frames = DEFAULT_FRAMES;
+    const char* only_scenario = nullptr;
+    const char* only_renderer = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            frames = (uint32_t) strtoul(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--scenario") && i + 1 < argc) {
+            only_scenario = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--renderer") && i + 1 < argc) {
+            only_renderer = argv[++i];
+        }
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    //the cartridge is never executed, an empty 32KiB ROM is enough
+    uint8_t* rom = calloc(ROM_SIZE, sizeof(uint8_t));
+    gb_init_rom(rom, ROM_SIZE);
+    free(rom);
+    align_to_frame();
+
+    printf("%u frames per scenario, %d dots per frame\n", frames, CYCLES_PER_FRAME);
+    printf("%-12s %-10s %9s %11s %9s  %-16s\n", "SCENARIO", "RENDERER", "NS/DOT", "US/FRAME", "SPEED", "FRAME HASH");
+    uint32_t num_results = 0;
+    for (size_t s = 0; s < sizeof(SCENARIOS) / sizeof(SCENARIOS[0]); s++) {
+        if (only_scenario && strcmp(SCENARIOS[s].NAME, only_scenario)) {
+            continue;
+        }
+        for (size_t r = 0; r < sizeof(RENDERERS) / sizeof(RENDERERS[0]); r++) {
+            if (only_renderer && strcmp(RENDERERS[r].NAME, only_renderer)) {
+                continue;
+            }
+            BENCH_RESULT result = bench_scenario(&RENDERERS[r], &SCENARIOS[s], frames);
+            char hash[17] = "-";
+            if (!RENDERERS[r].SKIP_RENDER) {
+                snprintf(hash, sizeof(hash), "%016llx", (unsigned long long) result.HASH);
+            }
+            //speed relative to a real Game Boy drawing the same frames
+            double speed = result.NS_PER_FRAME ? FRAME_TIME_MS * 1e6 / result.NS_PER_FRAME : 0.0;
+            printf("%-12s %-10s %9.2f %11.2f %8.1fx  %-16s\n", result.SCENARIO->NAME, result.RENDERER->NAME,
+                   result.NS_PER_DOT, result.NS_PER_FRAME / 1000.0, speed, hash);
+            num_results++;
+        }
+    }
+    if (!num_results) {
+        print_usage(argv[0]);
+        free_resources();
+        return 1;
+    }
+
+    free_resources();
+    return 0;
+}
@@ -0,0 +1,290 @@
+#include <common.h>
+#include <profiler.h>
+
+#ifdef GB_PROFILE
+
+#include <SDL3/SDL.h>
+#include <cpu.h>
+#include <memory.h>
+#include <gb.h>
+
+#define NON_ROM_SIZE 0x8000
+#define NOT_ROM UINT16_MAX
+#define INITIAL_NODES 1024
+#define MAX_NODES (1 << 20)
+#define HOT_PC_COUNT 64
+#define INTERRUPT_VECTOR_FIRST 0x40
+#define INTERRUPT_VECTOR_LAST 0x60
+
+static const char* PPU_STATE_NAMES[PROFILE_NUM_PPU_STATES] = {"OAM_SEARCH", "PIXEL_TRANSFER", "H_BLANK", "V_BLANK"};
+static const char* INTERRUPT_NAMES[PROFILE_NUM_INTERRUPTS] = {"vblank", "stat", "timer", "serial", "joypad"};
+
+typedef struct PROFILE_COUNT {
+    uint32_t INDEX;
+    uint64_t COUNT;
+} PROFILE_COUNT;
+
+void profiler_init() {
+    PROFILER = (PROFILER_STRUCT*) calloc(1, sizeof(PROFILER_STRUCT));
+    PROFILER->NUM_PC_COUNTS = CARTRIDGE->NUM_ROM_BANKS * ROM_BANK_SIZE + NON_ROM_SIZE;
+    PROFILER->PC_COUNTS = calloc(PROFILER->NUM_PC_COUNTS, sizeof(uint32_t));
+    PROFILER->NODE_CAPACITY = INITIAL_NODES;
+    PROFILER->NODES = calloc(PROFILER->NODE_CAPACITY, sizeof(PROFILE_NODE));
+    //the root stands for code that was never called, usually the main loop
+    PROFILER->NODES[0].ADDRESS = 0x0100;
+    PROFILER->NODES[0].BANK = 0;
+    PROFILER->NUM_NODES = 1;
+    PROFILER->START_NS = SDL_GetTicksNS();
+}
+
+void profiler_free() {
+    free(PROFILER->PC_COUNTS);
+    free(PROFILER->NODES);
+    free(PROFILER);
+}
+
+static uint16_t rom_bank(uint16_t address) {
+    return address >= 0x8000 ? NOT_ROM : mapped_rom_bank(address);
+}
+
+/*
+ * Called on every opcode fetch with the address it was fetched from
+ */
+void profile_instruction(uint16_t pc, uint8_t opcode) {
+    PROFILER->OPCODES[opcode]++;
+    PROFILER->INSTRUCTIONS++;
+    uint16_t bank = rom_bank(pc);
+    uint32_t index;
+    if (bank == NOT_ROM) {
+        index = CARTRIDGE->NUM_ROM_BANKS * ROM_BANK_SIZE + (pc - 0x8000);
+    }
+    else {
+        index = bank * ROM_BANK_SIZE + (pc & (ROM_BANK_SIZE - 1));
+    }
+    PROFILER->PC_COUNTS[index]++;
+}
+
+static uint32_t find_child(uint32_t parent, uint16_t address, uint16_t bank) {
+    for (uint32_t child = PROFILER->NODES[parent].FIRST_CHILD; child; child = PROFILER->NODES[child].NEXT_SIBLING) {
+        if (PROFILER->NODES[child].ADDRESS == address && PROFILER->NODES[child].BANK == bank) {
+            return child;
+        }
+    }
+    if (PROFILER->NUM_NODES == MAX_NODES) {
+        return parent;
+    }
+    if (PROFILER->NUM_NODES == PROFILER->NODE_CAPACITY) {
+        PROFILER->NODE_CAPACITY *= 2;
+        PROFILER->NODES = realloc(PROFILER->NODES, PROFILER->NODE_CAPACITY * sizeof(PROFILE_NODE));
+    }
+    uint32_t child = PROFILER->NUM_NODES++;
+    PROFILE_NODE* node = &PROFILER->NODES[child];
+    memset(node, 0, sizeof(PROFILE_NODE));
+    node->ADDRESS = address;
+    node->BANK = bank;
+    node->PARENT = parent;
+    node->NEXT_SIBLING = PROFILER->NODES[parent].FIRST_CHILD;
+    PROFILER->NODES[parent].FIRST_CHILD = child;
+    return child;
+}
+
+/*
+ * Called once CALL, RST or an interrupt has pushed the return address and loaded PC
+ */
+void profile_call() {
+    if (PROFILER->DEPTH == PROFILE_MAX_DEPTH) {
+        return;
+    }
+    uint16_t pc = read_16bit_reg(PC);
+    uint32_t node = find_child(PROFILER->CURRENT, pc, rom_bank(pc));
+    PROFILER->STACK[PROFILER->DEPTH].NODE = node;
+    PROFILER->STACK[PROFILER->DEPTH].RETURN_SP = read_16bit_reg(SP) + 2;
+    PROFILER->DEPTH++;
+    PROFILER->CURRENT = node;
+}
+
+/*
+ * Called once RET or RETI has loaded PC. Frames are matched on SP rather than
+ * popped one at a time, so code that drops return addresses or returns through
+ * a pushed address doesn't leave the call tree out of step for good.
+ */
+void profile_return() {
+    uint16_t sp = read_16bit_reg(SP);
+    while (PROFILER->DEPTH && PROFILER->STACK[PROFILER->DEPTH - 1].RETURN_SP <= sp) {
+        PROFILER->DEPTH--;
+    }
+    PROFILER->CURRENT = PROFILER->DEPTH ? PROFILER->STACK[PROFILER->DEPTH - 1].NODE : 0;
+}
+
+static void location_name(char* name, size_t size, uint16_t address, uint16_t bank) {
+    if (bank == NOT_ROM) {
+        const char* region = address >= 0xFF80 ? "hram" : address >= 0xC000 ? "wram" : address >= 0xA000 ? "sram" : "vram";
+        snprintf(name, size, "%s:%04X", region, address);
+    }
+    else {
+        snprintf(name, size, "rom%02X:%04X", bank, address);
+    }
+}
+
+static void node_name(char* name, size_t size, uint32_t index) {
+    const PROFILE_NODE* node = &PROFILER->NODES[index];
+    if (!index) {
+        snprintf(name, size, "main");
+    }
+    else if (node->BANK == 0 && node->ADDRESS >= INTERRUPT_VECTOR_FIRST && node->ADDRESS <= INTERRUPT_VECTOR_LAST && !(node->ADDRESS & 0x07)) {
+        snprintf(name, size, "irq_%s", INTERRUPT_NAMES[(node->ADDRESS - INTERRUPT_VECTOR_FIRST) / 8]);
+    }
+    else {
+        location_name(name, size, node->ADDRESS, node->BANK);
+    }
+}
+
+static int compare_counts(const void* a, const void* b) {
+    uint64_t count_a = ((const PROFILE_COUNT*) a)->COUNT;
+    uint64_t count_b = ((const PROFILE_COUNT*) b)->COUNT;
+    return (count_a < count_b) - (count_a > count_b);
+}
+
+static FILE* open_report(const char* prefix, const char* extension) {
+    size_t length = strlen(prefix) + strlen(extension) + 1;
+    char* path = malloc(length);
+    snprintf(path, length, "%s%s", prefix, extension);
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        perror("Couldn't open profile report");
+    }
+    free(path);
+    return file;
+}
+
+/*
+ * Writes one line per call stack in the folded format flamegraph.pl and speedscope
+ * read, weighted by M-cycles. Cycles spent halted get their own [halted] frame.
+ */
+static void write_folded(FILE* file) {
+    uint32_t path[PROFILE_MAX_DEPTH + 1];
+    char name[32];
+    for (uint32_t index = 0; index < PROFILER->NUM_NODES; index++) {
+        const PROFILE_NODE* node = &PROFILER->NODES[index];
+        if (!node->CYCLES && !node->HALTED_CYCLES) {
+            continue;
+        }
+        uint8_t depth = 0;
+        for (uint32_t walk = index; ; walk = PROFILER->NODES[walk].PARENT) {
+            path[depth++] = walk;
+            if (!walk) {
+                break;
+            }
+        }
+        for (uint8_t i = depth; i > 0; i--) {
+            node_name(name, sizeof(name), path[i - 1]);
+            fprintf(file, i == depth ? "%s" : ";%s", name);
+        }
+        if (node->CYCLES) {
+            fprintf(file, " %llu\n", (unsigned long long) node->CYCLES);
+        }
+        if (node->HALTED_CYCLES) {
+            if (node->CYCLES) {
+                //the stack has to be printed again for the halted frame
+                for (uint8_t i = depth; i > 0; i--) {
+                    node_name(name, sizeof(name), path[i - 1]);
+                    fprintf(file, i == depth ? "%s" : ";%s", name);
+                }
+            }
+            fprintf(file, ";[halted] %llu\n", (unsigned long long) node->HALTED_CYCLES);
+        }
+    }
+}
+
+static void write_report(FILE* file) {
+    double host_s = (SDL_GetTicksNS() - PROFILER->START_NS) / 1e9;
+    double emulated_s = CYCLE_COUNT * 4 / CLOCK_FREQ;
+    double instructions = PROFILER->INSTRUCTIONS ? (double) PROFILER->INSTRUCTIONS : 1.0;
+    fprintf(file, "emulated: %.3f s, %llu M-cycles, %llu instructions\n", emulated_s,
+            (unsigned long long) CYCLE_COUNT, (unsigned long long) PROFILER->INSTRUCTIONS);
+    fprintf(file, "host: %.3f s, %.2fx real time\n", host_s, host_s > 0 ? emulated_s / host_s : 0.0);
+
+    uint64_t dots = 0;
+    for (uint8_t state = 0; state < PROFILE_NUM_PPU_STATES; state++) {
+        dots += PROFILER->PPU_DOTS[state];
+    }
+    fprintf(file, "\nPPU mode           dots      share\n");
+    for (uint8_t state = 0; state < PROFILE_NUM_PPU_STATES; state++) {
+        fprintf(file, "%-15s %12llu %9.2f%%\n", PPU_STATE_NAMES[state], (unsigned long long) PROFILER->PPU_DOTS[state],
+                dots ? 100.0 * PROFILER->PPU_DOTS[state] / dots : 0.0);
+    }
+
+    fprintf(file, "\ninterrupt  vector        taken\n");
+    for (uint8_t i = 0; i < PROFILE_NUM_INTERRUPTS; i++) {
+        fprintf(file, "%-10s 0x%02X %12llu\n", INTERRUPT_NAMES[i], INTERRUPT_VECTOR_FIRST + i * 8,
+                (unsigned long long) PROFILER->INTERRUPTS[i]);
+    }
+    fprintf(file, "\nOAM DMA: %llu M-cycles\n", (unsigned long long) PROFILER->DMA_CYCLES);
+
+    //opcodes, the CB prefix is counted both as 0xCB and as the CBXX opcode that follows
+    PROFILE_COUNT* counts = calloc(PROFILE_NUM_OPCODES, sizeof(PROFILE_COUNT));
+    uint32_t num_counts = 0;
+    for (uint32_t opcode = 0; opcode < PROFILE_NUM_OPCODES; opcode++) {
+        if (PROFILER->OPCODES[opcode]) {
+            counts[num_counts].INDEX = opcode;
+            counts[num_counts++].COUNT = PROFILER->OPCODES[opcode];
+        }
+    }
+    qsort(counts, num_counts, sizeof(PROFILE_COUNT), compare_counts);
+    fprintf(file, "\nopcode        executed      share\n");
+    for (uint32_t i = 0; i < num_counts; i++) {
+        char code[8];
+        if (counts[i].INDEX > 0xFF) {
+            snprintf(code, sizeof(code), "CB%02X", counts[i].INDEX & 0xFF);
+        }
+        else {
+            snprintf(code, sizeof(code), "%02X", counts[i].INDEX);
+        }
+        fprintf(file, "%-6s %15llu %9.2f%%\n", code, (unsigned long long) counts[i].COUNT, 100.0 * counts[i].COUNT / instructions);
+    }
+    free(counts);
+
+    counts = malloc(PROFILER->NUM_PC_COUNTS * sizeof(PROFILE_COUNT));
+    num_counts = 0;
+    for (uint32_t index = 0; index < PROFILER->NUM_PC_COUNTS; index++) {
+        if (PROFILER->PC_COUNTS[index]) {
+            counts[num_counts].INDEX = index;
+            counts[num_counts++].COUNT = PROFILER->PC_COUNTS[index];
+        }
+    }
+    qsort(counts, num_counts, sizeof(PROFILE_COUNT), compare_counts);
+    fprintf(file, "\naddress         executed      share\n");
+    uint32_t rom_counts = CARTRIDGE->NUM_ROM_BANKS * ROM_BANK_SIZE;
+    for (uint32_t i = 0; i < num_counts && i < HOT_PC_COUNT; i++) {
+        char name[32];
+        uint32_t index = counts[i].INDEX;
+        if (index >= rom_counts) {
+            location_name(name, sizeof(name), 0x8000 + (index - rom_counts), NOT_ROM);
+        }
+        else {
+            uint16_t bank = index / ROM_BANK_SIZE;
+            location_name(name, sizeof(name), (bank ? 0x4000 : 0) | (index % ROM_BANK_SIZE), bank);
+        }
+        fprintf(file, "%-10s %15llu %9.2f%%\n", name, (unsigned long long) counts[i].COUNT, 100.0 * counts[i].COUNT / instructions);
+    }
+    free(counts);
+}
+
+/*
+ * Writes the text report to PREFIX.profile and the call stacks to PREFIX.folded
+ */
+void profiler_write_report(const char* prefix) {
+    FILE* report = open_report(prefix, ".profile");
+    if (report) {
+        write_report(report);
+        fclose(report);
+    }
+    FILE* folded = open_report(prefix, ".folded");
+    if (folded) {
+        write_folded(folded);
+        fclose(folded);
+    }
+    printf("Profile written to %s.profile and %s.folded\n", prefix, prefix);
+}
+
+#endif //GB_PROFILE
@@ -4,43 +4,16 @@
 #include <min_heap.h>
 #include <queue.h>
 
-#define QUEUE_CAPACITY 10
-#define PIXEL_FIFO_CAPACITY 8
-
 
 void queue_init() {
-    INSTR_QUEUE = (func_queue*) malloc(sizeof(func_queue));
-    INSTR_QUEUE->functions = (func_and_param_wrapper*) calloc(QUEUE_CAPACITY, sizeof(func_and_param_wrapper));
     INSTR_QUEUE->front = -1;
     INSTR_QUEUE->back = -1;
-
-    PPU->BACKGROUND_FIFO = (PIXEL_FIFO*) malloc(sizeof(PIXEL_FIFO));
-    PPU->BACKGROUND_FIFO->pixel_data = (PIXEL_DATA**)malloc(PIXEL_FIFO_CAPACITY * sizeof(PIXEL_DATA*));
-    for (int i = 0; i < PIXEL_FIFO_CAPACITY; i++) {
-        PPU->BACKGROUND_FIFO->pixel_data[i] = (PIXEL_DATA*)calloc(1, sizeof(PIXEL_DATA));
-    }
-    PPU->BACKGROUND_FIFO->front = -1;
-    PPU->BACKGROUND_FIFO->back = -1;
-    PPU->BACKGROUND_FIFO->size = 0;
-
-    PPU->SPRITE_FIFO = (PIXEL_FIFO*) malloc(sizeof(PIXEL_FIFO));
-    PPU->SPRITE_FIFO->pixel_data = (PIXEL_DATA**)malloc(PIXEL_FIFO_CAPACITY * sizeof(PIXEL_DATA*));
-    for (int i = 0; i < PIXEL_FIFO_CAPACITY; i++) {
-        PPU->SPRITE_FIFO->pixel_data[i] = (PIXEL_DATA*)calloc(1, sizeof(PIXEL_DATA));
-        PPU->SPRITE_FIFO->pixel_data[i]->binary_data = 0xFF;
+    pixel_fifo_clear(&PPU->BACKGROUND_FIFO);
+    pixel_fifo_clear(&PPU->SPRITE_FIFO);
+    //sprite pixels a pushed object may overwrite
+    for (uint8_t i = 0; i < PIXEL_FIFO_CAPACITY; i++) {
+        PPU->SPRITE_FIFO.pixel_data[i].binary_data = 0xFF;
     }
-    PPU->SPRITE_FIFO->front = -1;
-    PPU->SPRITE_FIFO->back = -1;
-    PPU->SPRITE_FIFO->size = 0;
-}
-
-void queue_free() {
-    free(INSTR_QUEUE->functions);
-    free(INSTR_QUEUE);
-    free(PPU->BACKGROUND_FIFO->pixel_data);
-    free(PPU->BACKGROUND_FIFO);
-    free(PPU->SPRITE_FIFO->pixel_data);
-    free(PPU->SPRITE_FIFO);
 }
 
 bool is_empty(const func_queue* queue) {
@@ -74,14 +47,14 @@ void pixel_fifo_clear(PIXEL_FIFO* PIXEL_FIFO) {
 }
 
 void background_fifo_push(const PIXEL_DATA* pixel_data) {
-    PIXEL_FIFO* PIXEL_FIFO = PPU->BACKGROUND_FIFO;
+    PIXEL_FIFO* PIXEL_FIFO = &PPU->BACKGROUND_FIFO;
     for (uint8_t i = 0; i < 8; i++) {
         if (PIXEL_FIFO->front == -1) {
             PIXEL_FIFO->front = 0;
         }
         PIXEL_FIFO->back = (PIXEL_FIFO->back + 1) % PIXEL_FIFO_CAPACITY;
-        PIXEL_FIFO->pixel_data[PIXEL_FIFO->back]->binary_data = pixel_data[i].binary_data;
-        PIXEL_FIFO->pixel_data[PIXEL_FIFO->back]->source = pixel_data[i].source;
+        PIXEL_FIFO->pixel_data[PIXEL_FIFO->back].binary_data = pixel_data[i].binary_data;
+        PIXEL_FIFO->pixel_data[PIXEL_FIFO->back].source = pixel_data[i].source;
         PIXEL_FIFO->size++;
     }
 }
@@ -89,21 +62,21 @@ void background_fifo_push(const PIXEL_DATA* pixel_data) {
 void sprite_fifo_push(const PIXEL_DATA* pixel_data) {
     uint8_t index;
     bool x_flip = pixel_data->x_flip;
-    PIXEL_FIFO* PIXEL_FIFO = PPU->SPRITE_FIFO;
+    PIXEL_FIFO* PIXEL_FIFO = &PPU->SPRITE_FIFO;
     if (PIXEL_FIFO->front == -1) {
         PIXEL_FIFO->front = 0;
     }
     if (x_flip) {
         for (int8_t i = 0, j = 7; i < 8; i++, j--) {
             PIXEL_FIFO->back = index = (PIXEL_FIFO->back + 1) % PIXEL_FIFO_CAPACITY;
-            bool empty_data = PIXEL_FIFO->pixel_data[index]->binary_data == 0xFF;
-            bool lower_address = pixel_data[j].address < PIXEL_FIFO->pixel_data[index]->address;
+            bool empty_data = PIXEL_FIFO->pixel_data[index].binary_data == 0xFF;
+            bool lower_address = pixel_data[j].address < PIXEL_FIFO->pixel_data[index].address;
             if (empty_data || (!empty_data && lower_address)) {
-                PIXEL_FIFO->pixel_data[index]->binary_data = pixel_data[j].binary_data;
-                PIXEL_FIFO->pixel_data[index]->source = pixel_data[j].source;
-                PIXEL_FIFO->pixel_data[index]->palette = pixel_data[j].palette;
-                PIXEL_FIFO->pixel_data[index]->priority = pixel_data[j].priority;
-                PIXEL_FIFO->pixel_data[index]->address = pixel_data[j].address;
+                PIXEL_FIFO->pixel_data[index].binary_data = pixel_data[j].binary_data;
+                PIXEL_FIFO->pixel_data[index].source = pixel_data[j].source;
+                PIXEL_FIFO->pixel_data[index].palette = pixel_data[j].palette;
+                PIXEL_FIFO->pixel_data[index].priority = pixel_data[j].priority;
+                PIXEL_FIFO->pixel_data[index].address = pixel_data[j].address;
                 PIXEL_FIFO->size++;
             }
         }
@@ -111,14 +84,14 @@ void sprite_fifo_push(const PIXEL_DATA* pixel_data) {
     else {
         for (int8_t i = 0; i < 8; i++) {
             PIXEL_FIFO->back = index = (PIXEL_FIFO->back + 1) % PIXEL_FIFO_CAPACITY;
-            bool empty_data = PIXEL_FIFO->pixel_data[PIXEL_FIFO->back]->binary_data == 0xFF;
-            bool lower_address = pixel_data[i].address < PIXEL_FIFO->pixel_data[PIXEL_FIFO->back]->address;
+            bool empty_data = PIXEL_FIFO->pixel_data[PIXEL_FIFO->back].binary_data == 0xFF;
+            bool lower_address = pixel_data[i].address < PIXEL_FIFO->pixel_data[PIXEL_FIFO->back].address;
             if (empty_data || (!empty_data && lower_address)) {
-                PIXEL_FIFO->pixel_data[PIXEL_FIFO->back]->binary_data = pixel_data[i].binary_data;
-                PIXEL_FIFO->pixel_data[PIXEL_FIFO->back]->source = pixel_data[i].source;
-                PIXEL_FIFO->pixel_data[PIXEL_FIFO->back]->palette = pixel_data[i].palette;
-                PIXEL_FIFO->pixel_data[PIXEL_FIFO->back]->priority = pixel_data[i].priority;
-                PIXEL_FIFO->pixel_data[PIXEL_FIFO->back]->address = pixel_data[i].address;
+                PIXEL_FIFO->pixel_data[PIXEL_FIFO->back].binary_data = pixel_data[i].binary_data;
+                PIXEL_FIFO->pixel_data[PIXEL_FIFO->back].source = pixel_data[i].source;
+                PIXEL_FIFO->pixel_data[PIXEL_FIFO->back].palette = pixel_data[i].palette;
+                PIXEL_FIFO->pixel_data[PIXEL_FIFO->back].priority = pixel_data[i].priority;
+                PIXEL_FIFO->pixel_data[PIXEL_FIFO->back].address = pixel_data[i].address;
                 PIXEL_FIFO->size++;
             }
         }
@@ -131,12 +104,12 @@ void pixel_fifo_pop(PIXEL_FIFO* PIXEL_FIFO, PIXEL_DATA* ret) {
         free_resources();
         exit(1);
     }
-    ret->binary_data = PIXEL_FIFO->pixel_data[PIXEL_FIFO->front]->binary_data;
-    ret->source = PIXEL_FIFO->pixel_data[PIXEL_FIFO->front]->source;
-    ret->palette = PIXEL_FIFO->pixel_data[PIXEL_FIFO->front]->palette;
-    ret->priority = PIXEL_FIFO->pixel_data[PIXEL_FIFO->front]->priority;
+    ret->binary_data = PIXEL_FIFO->pixel_data[PIXEL_FIFO->front].binary_data;
+    ret->source = PIXEL_FIFO->pixel_data[PIXEL_FIFO->front].source;
+    ret->palette = PIXEL_FIFO->pixel_data[PIXEL_FIFO->front].palette;
+    ret->priority = PIXEL_FIFO->pixel_data[PIXEL_FIFO->front].priority;
 
-    PIXEL_FIFO->pixel_data[PIXEL_FIFO->front]->binary_data = 0xFF;
+    PIXEL_FIFO->pixel_data[PIXEL_FIFO->front].binary_data = 0xFF;
 
     if (PIXEL_FIFO->front == PIXEL_FIFO->back) {
         PIXEL_FIFO->front = PIXEL_FIFO->back = -1;
@@ -150,4 +123,29 @@ void pixel_fifo_pop(PIXEL_FIFO* PIXEL_FIFO, PIXEL_DATA* ret) {
 
 bool pixel_fifo_is_empty(const PIXEL_FIFO* PIXEL_FIFO) {
     return PIXEL_FIFO->size == 0;
+}
+
+/*
+ * Moves the FIFO indexes and size as if 8 pixels were pushed without copying any pixel data
+ */
+void pixel_fifo_skip_push(PIXEL_FIFO* PIXEL_FIFO) {
+    if (PIXEL_FIFO->front == -1) {
+        PIXEL_FIFO->front = 0;
+    }
+    PIXEL_FIFO->back = (PIXEL_FIFO->back + 8) % PIXEL_FIFO_CAPACITY;
+    PIXEL_FIFO->size += 8;
+}
+
+/*
+ * Moves the FIFO indexes and size as if a pixel was popped without reading any pixel data
+ */
+void pixel_fifo_skip_pop(PIXEL_FIFO* PIXEL_FIFO) {
+    if (PIXEL_FIFO->front == PIXEL_FIFO->back) {
+        PIXEL_FIFO->front = PIXEL_FIFO->back = -1;
+        PIXEL_FIFO->size = 0;
+    }
+    else {
+        PIXEL_FIFO->front = (PIXEL_FIFO->front + 1) % PIXEL_FIFO_CAPACITY;
+        PIXEL_FIFO->size--;
+    }
 }
\ No newline at end of file
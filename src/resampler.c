@@ -0,0 +1,299 @@
+#include <common.h>
+#include <SDL3/SDL.h>
+#include <resampler.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define RESAMPLER_X86
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+#endif
+
+#define CUTOFF 0.9                  //passband edge as a fraction of the output Nyquist frequency
+#define PI 3.14159265358979323846
+
+typedef struct QUALITY_INFO {
+    const char* NAME;
+    uint8_t ZERO_CROSSINGS;         //of the sinc on each side, 0 for the box filter
+    double BETA;                    //Kaiser window shape, higher trades passband width for stopband depth
+} QUALITY_INFO;
+
+static const QUALITY_INFO QUALITIES[RESAMPLE_NUM_QUALITIES] = {
+    {"box", 0, 0.0},
+    {"low", 4, 6.0},
+    {"medium", 8, 8.0},
+    {"high", 16, 10.0},
+};
+
+static const char* KERNEL_NAMES[RESAMPLE_NUM_KERNELS] = {"auto", "scalar", "sse2", "avx2"};
+
+///////////////////////////////////////// DOT PRODUCTS /////////////////////////////////////////
+
+/*
+ * Each kernel writes the left and right sums of TAPS[i] * INPUT[i] to OUTPUT.
+ * NUM_TAPS is always a multiple of RESAMPLER_TAP_ALIGN.
+ */
+
+static void dot_scalar(const float* taps, const float (*input)[2], uint32_t num_taps, float* output) {
+    float left = 0.0f;
+    float right = 0.0f;
+    for (uint32_t i = 0; i < num_taps; i++) {
+        left += taps[i] * input[i][0];
+        right += taps[i] * input[i][1];
+    }
+    output[0] = left;
+    output[1] = right;
+}
+
+#ifdef RESAMPLER_X86
+/*
+ * The input stays interleaved, every tap is duplicated into the left and right
+ * lanes instead so even lanes sum the left channel and odd lanes the right
+ */
+TARGET_SSE2 static void dot_sse2(const float* taps, const float (*input)[2], uint32_t num_taps, float* output) {
+    const float* samples = &input[0][0];
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    for (uint32_t i = 0; i < num_taps; i += 4) {
+        __m128 t = _mm_loadu_ps(&taps[i]);
+        __m128 low = _mm_unpacklo_ps(t, t);     //t0 t0 t1 t1
+        __m128 high = _mm_unpackhi_ps(t, t);    //t2 t2 t3 t3
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(low, _mm_loadu_ps(&samples[2 * i])));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(high, _mm_loadu_ps(&samples[2 * i + 4])));
+    }
+    __m128 sum = _mm_add_ps(sum0, sum1);                //L R L R
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    output[0] = _mm_cvtss_f32(sum);
+    output[1] = _mm_cvtss_f32(_mm_shuffle_ps(sum, sum, 1));
+}
+
+TARGET_AVX2 static void dot_avx2(const float* taps, const float (*input)[2], uint32_t num_taps, float* output) {
+    const float* samples = &input[0][0];
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    for (uint32_t i = 0; i < num_taps; i += 8) {
+        __m256 t = _mm256_loadu_ps(&taps[i]);
+        //unpacking works within 128-bit lanes, the permutes put the taps back in order
+        __m256 low = _mm256_unpacklo_ps(t, t);                  //t0 t0 t1 t1 | t4 t4 t5 t5
+        __m256 high = _mm256_unpackhi_ps(t, t);                 //t2 t2 t3 t3 | t6 t6 t7 t7
+        __m256 first = _mm256_permute2f128_ps(low, high, 0x20); //t0 t0 t1 t1 | t2 t2 t3 t3
+        __m256 second = _mm256_permute2f128_ps(low, high, 0x31);
+        sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(first, _mm256_loadu_ps(&samples[2 * i])));
+        sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(second, _mm256_loadu_ps(&samples[2 * i + 8])));
+    }
+    __m256 sum = _mm256_add_ps(sum0, sum1);
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    output[0] = _mm_cvtss_f32(half);
+    output[1] = _mm_cvtss_f32(_mm_shuffle_ps(half, half, 1));
+}
+#endif
+
+bool resampler_kernel_supported(enum RESAMPLE_KERNEL kernel) {
+    switch (kernel) {
+        case KERNEL_AUTO:
+        case KERNEL_SCALAR:
+            return true;
+#ifdef RESAMPLER_X86
+        case KERNEL_SSE2:
+            return SDL_HasSSE2();
+        case KERNEL_AVX2:
+            return SDL_HasAVX2();
+#endif
+        default:
+            return false;
+    }
+}
+
+static enum RESAMPLE_KERNEL resolve_kernel(enum RESAMPLE_KERNEL kernel) {
+    if (kernel != KERNEL_AUTO && resampler_kernel_supported(kernel)) {
+        return kernel;
+    }
+    if (resampler_kernel_supported(KERNEL_AVX2)) {
+        return KERNEL_AVX2;
+    }
+    if (resampler_kernel_supported(KERNEL_SSE2)) {
+        return KERNEL_SSE2;
+    }
+    return KERNEL_SCALAR;
+}
+
+static RESAMPLE_DOT kernel_function(enum RESAMPLE_KERNEL kernel) {
+#ifdef RESAMPLER_X86
+    if (kernel == KERNEL_AVX2) {
+        return dot_avx2;
+    }
+    if (kernel == KERNEL_SSE2) {
+        return dot_sse2;
+    }
+#endif
+    return dot_scalar;
+}
+
+///////////////////////////////////////// FILTER DESIGN /////////////////////////////////////////
+
+/*
+ * Zeroth order modified Bessel function of the first kind, for the Kaiser window
+ */
+static double bessel_i0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (uint8_t k = 1; k < 64 && term > sum * 1e-12; k++) {
+        double factor = x / (2.0 * k);
+        term *= factor * factor;
+        sum += term;
+    }
+    return sum;
+}
+
+/*
+ * Response at X input frames from the output position, before normalization
+ */
+static double kernel_value(const QUALITY_INFO* info, double x, double step, double half_width) {
+    if (!info->ZERO_CROSSINGS) {
+        //overlap of the frame's [x - 0.5, x + 0.5) with the output period centred on 0
+        double start = x - 0.5 > -step / 2 ? x - 0.5 : -step / 2;
+        double end = x + 0.5 < step / 2 ? x + 0.5 : step / 2;
+        return end > start ? end - start : 0.0;
+    }
+    double r = x / half_width;
+    if (r <= -1.0 || r >= 1.0) {
+        return 0.0;
+    }
+    double window = bessel_i0(info->BETA * SDL_sqrt(1.0 - r * r)) / bessel_i0(info->BETA);
+    double arg = PI * CUTOFF * x / step;
+    return (x == 0.0 ? 1.0 : SDL_sin(arg) / arg) * window;
+}
+
+/*
+ * Tabulates the kernel for every phase, each normalized to unity gain at DC
+ */
+static void design_phases(RESAMPLER* resampler, double step) {
+    const QUALITY_INFO* info = &QUALITIES[resampler->QUALITY];
+    double half_width = info->ZERO_CROSSINGS ? info->ZERO_CROSSINGS * step : step / 2 + 0.5;
+    resampler->HALF = (uint32_t) SDL_ceil(half_width) + 1;
+    resampler->TAPS = (2 * resampler->HALF + RESAMPLER_TAP_ALIGN - 1) / RESAMPLER_TAP_ALIGN * RESAMPLER_TAP_ALIGN;
+    resampler->PHASES = (float*) malloc((size_t) RESAMPLER_PHASES * resampler->TAPS * sizeof(float));
+    double* values = (double*) malloc(resampler->TAPS * sizeof(double));
+    if (!resampler->PHASES || !values) {
+        perror("Couldn't allocate resampler kernel");
+        exit(1);
+    }
+    for (uint32_t phase = 0; phase < RESAMPLER_PHASES; phase++) {
+        //tap k weighs frame floor(position) + 1 - HALF + k
+        double fraction = (double) phase / RESAMPLER_PHASES;
+        double sum = 0.0;
+        for (uint32_t k = 0; k < resampler->TAPS; k++) {
+            double x = (double) k + 1.0 - resampler->HALF - fraction;
+            values[k] = kernel_value(info, x, step, half_width);
+            sum += values[k];
+        }
+        float* taps = &resampler->PHASES[phase * resampler->TAPS];
+        for (uint32_t k = 0; k < resampler->TAPS; k++) {
+            taps[k] = (float) (values[k] / sum);
+        }
+    }
+    free(values);
+}
+
+///////////////////////////////////////// STREAMING /////////////////////////////////////////
+
+/*
+ * RATIO is input frames per output frame. MAX_INPUT is the most frames a
+ * single resampler_process() call will be given.
+ */
+void resampler_init(RESAMPLER* resampler, double ratio, enum RESAMPLE_QUALITY quality,
+                    enum RESAMPLE_KERNEL kernel, uint32_t max_input) {
+    memset(resampler, 0, sizeof(RESAMPLER));
+    resampler->QUALITY = quality;
+    resampler->KERNEL = resolve_kernel(kernel);
+    resampler->DOT = kernel_function(resampler->KERNEL);
+    resampler->STEP = ratio;
+    design_phases(resampler, ratio);
+    resampler->BUFFER_CAPACITY = resampler->TAPS + max_input;
+    resampler->BUFFER = calloc(resampler->BUFFER_CAPACITY, sizeof(resampler->BUFFER[0]));
+    if (!resampler->BUFFER) {
+        perror("Couldn't allocate resampler buffer");
+        exit(1);
+    }
+    //silence before the first frame, which lines up with the first output
+    resampler->BUFFER_SIZE = resampler->HALF - 1;
+    resampler->POSITION = resampler->HALF - 1;
+}
+
+void resampler_free(RESAMPLER* resampler) {
+    free(resampler->PHASES);
+    free(resampler->BUFFER);
+    resampler->PHASES = nullptr;
+    resampler->BUFFER = nullptr;
+}
+
+/*
+ * Changes the ratio without redesigning the kernel, meant for the small
+ * corrections of rate control
+ */
+void resampler_set_step(RESAMPLER* resampler, double step) {
+    resampler->STEP = step;
+}
+
+/*
+ * Appends COUNT input frames and writes every output frame they complete,
+ * returns how many. MAX_OUTPUT has to cover COUNT / STEP + 1 frames or
+ * input backs up in the buffer.
+ */
+uint32_t resampler_process(RESAMPLER* resampler, const float (*input)[2], uint32_t count,
+                           float (*output)[2], uint32_t max_output) {
+    if (resampler->BUFFER_SIZE + count > resampler->BUFFER_CAPACITY) {
+        fprintf(stderr, "Resampler input of %u frames overflows its buffer\n", count);
+        exit(1);
+    }
+    memcpy(&resampler->BUFFER[resampler->BUFFER_SIZE], input, count * sizeof(resampler->BUFFER[0]));
+    resampler->BUFFER_SIZE += count;
+
+    uint32_t produced = 0;
+    while (produced < max_output) {
+        uint32_t base = (uint32_t) resampler->POSITION;
+        uint32_t first = base + 1 - resampler->HALF;
+        if (first + resampler->TAPS > resampler->BUFFER_SIZE) {
+            break;
+        }
+        uint32_t phase = (uint32_t) ((resampler->POSITION - base) * RESAMPLER_PHASES);
+        resampler->DOT(&resampler->PHASES[phase * resampler->TAPS], &resampler->BUFFER[first],
+                       resampler->TAPS, output[produced]);
+        produced++;
+        resampler->POSITION += resampler->STEP;
+    }
+
+    //drop the frames no upcoming output reaches back to
+    uint32_t consumed = (uint32_t) resampler->POSITION + 1 - resampler->HALF;
+    if (consumed > resampler->BUFFER_SIZE) {
+        consumed = resampler->BUFFER_SIZE;
+    }
+    resampler->BUFFER_SIZE -= consumed;
+    memmove(resampler->BUFFER, &resampler->BUFFER[consumed], resampler->BUFFER_SIZE * sizeof(resampler->BUFFER[0]));
+    resampler->POSITION -= consumed;
+    return produced;
+}
+
+const char* resampler_quality_name(enum RESAMPLE_QUALITY quality) {
+    return QUALITIES[quality].NAME;
+}
+
+const char* resampler_kernel_name(enum RESAMPLE_KERNEL kernel) {
+    return KERNEL_NAMES[kernel];
+}
+
+bool resampler_parse_quality(const char* name, enum RESAMPLE_QUALITY* quality) {
+    for (uint8_t i = 0; i < RESAMPLE_NUM_QUALITIES; i++) {
+        if (!strcmp(name, QUALITIES[i].NAME)) {
+            *quality = (enum RESAMPLE_QUALITY) i;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,173 @@
+#include <common.h>
+#include <SDL3/SDL.h>
+#include <apu.h>
+
+#define DEFAULT_SECONDS 5
+#define DEFAULT_RUNS 3
+#define RANDOM_SEED 0x2545F491
+
+/*
+ * Resampler micro-benchmark. Feeds one emulated second of APU-like native
+ * output, square waves with steps and noise at 1 MiHz, through every quality
+ * and every dot product kernel the host supports in APU_BLOCK_SIZE blocks, and
+ * reports throughput on one core. The SIMD kernels are checked against the
+ * scalar reference, which only differs in summation order.
+ */
+
+typedef struct BENCH_RESULT {
+    uint64_t BEST_NS;
+    uint64_t OUTPUT_FRAMES;
+    uint32_t TAPS;
+    float MAX_DIFFERENCE;       //from the scalar kernel over the first second
+} BENCH_RESULT;
+
+static float (*native)[2];
+static float (*reference)[2];
+static float (*resampled)[2];
+static uint32_t max_resampled;
+static uint32_t random_state;
+
+static uint32_t next_random() {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+/*
+ * Fills one second with what the mixer produces: runs of constant values
+ * from two square channels, a decaying envelope and the noise channel
+ */
+static void generate_native() {
+    random_state = RANDOM_SEED;
+    float noise = 0.0f;
+    for (uint32_t i = 0; i < APU_NATIVE_RATE; i++) {
+        float square1 = (i / 1024) % 2 ? 0.25f : -0.25f;           //512 Hz
+        float square2 = (i / 397) % 4 ? 0.125f : -0.125f;          //~660 Hz at 25% duty
+        float envelope = 1.0f - (float) (i % 65536) / 65536.0f;
+        if (!(i % 32)) {
+            noise = next_random() & 1 ? 0.125f : -0.125f;
+        }
+        native[i][0] = (square1 + noise) * envelope;
+        native[i][1] = (square2 + noise) * envelope;
+    }
+}
+
+/*
+ * Runs SECONDS through RESAMPLER, OUTPUT keeps the first second's frames when set
+ */
+static uint64_t run(RESAMPLER* resampler, uint32_t seconds, float (*output)[2], uint64_t* output_frames) {
+    uint64_t produced = 0;
+    uint64_t start = SDL_GetTicksNS();
+    for (uint32_t second = 0; second < seconds; second++) {
+        for (uint32_t offset = 0; offset < APU_NATIVE_RATE; offset += APU_BLOCK_SIZE) {
+            float (*destination)[2] = !second && output ? &output[produced] : resampled;
+            produced += resampler_process(resampler, &native[offset], APU_BLOCK_SIZE, destination, max_resampled);
+        }
+    }
+    *output_frames = produced;
+    return SDL_GetTicksNS() - start;
+}
+
+static void bench(enum RESAMPLE_QUALITY quality, enum RESAMPLE_KERNEL kernel, uint32_t rate, uint32_t seconds,
+                  uint32_t runs, BENCH_RESULT* result) {
+    result->BEST_NS = UINT64_MAX;
+    result->MAX_DIFFERENCE = 0.0f;
+    double ratio = (double) APU_NATIVE_RATE / rate;
+    for (uint32_t i = 0; i < runs; i++) {
+        RESAMPLER resampler;
+        resampler_init(&resampler, ratio, quality, kernel, APU_BLOCK_SIZE);
+        result->TAPS = resampler.TAPS;
+        float (*output)[2] = !i && kernel == KERNEL_SCALAR ? reference : nullptr;
+        uint64_t elapsed_ns = run(&resampler, seconds, output, &result->OUTPUT_FRAMES);
+        if (elapsed_ns < result->BEST_NS) {
+            result->BEST_NS = elapsed_ns;
+        }
+        resampler_free(&resampler);
+    }
+    if (kernel == KERNEL_SCALAR) {
+        return;
+    }
+    //untimed pass over the first second to compare with the reference
+    RESAMPLER resampler;
+    resampler_init(&resampler, ratio, quality, kernel, APU_BLOCK_SIZE);
+    uint64_t frames = 0;
+    for (uint32_t offset = 0; offset < APU_NATIVE_RATE; offset += APU_BLOCK_SIZE) {
+        float chunk[APU_BLOCK_SIZE / 8][2];
+        uint32_t count = resampler_process(&resampler, &native[offset], APU_BLOCK_SIZE, chunk, max_resampled);
+        for (uint32_t j = 0; j < count; j++, frames++) {
+            for (uint8_t side = 0; side < 2; side++) {
+                float difference = SDL_fabs(chunk[j][side] - reference[frames][side]);
+                if (difference > result->MAX_DIFFERENCE) {
+                    result->MAX_DIFFERENCE = difference;
+                }
+            }
+        }
+    }
+    resampler_free(&resampler);
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr, "Usage: %s [options]\n", program);
+    fprintf(stderr, "  --rate <Hz>      output sample rate (default %d)\n", APU_OUTPUT_RATE);
+    fprintf(stderr, "  --seconds <N>    emulated seconds per run (default %d)\n", DEFAULT_SECONDS);
+    fprintf(stderr, "  --runs <N>       runs per quality and kernel, the fastest is kept (default %d)\n", DEFAULT_RUNS);
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t rate = APU_OUTPUT_RATE;
+    uint32_t seconds = DEFAULT_SECONDS;
+    uint32_t runs = DEFAULT_RUNS;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--rate") && i + 1 < argc) {
+            rate = (uint32_t) strtoul(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+            seconds = (uint32_t) strtoul(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--runs") && i + 1 < argc) {
+            runs = (uint32_t) strtoul(argv[++i], nullptr, 10);
+        }
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!seconds || !runs || rate < APU_MIN_OUTPUT_RATE || rate > APU_MAX_OUTPUT_RATE) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    max_resampled = APU_BLOCK_SIZE / 8;
+    native = malloc(APU_NATIVE_RATE * sizeof(native[0]));
+    reference = malloc((rate + 1) * sizeof(reference[0]));
+    resampled = malloc(max_resampled * sizeof(resampled[0]));
+    if (!native || !reference || !resampled) {
+        perror("Couldn't allocate benchmark buffers");
+        return 1;
+    }
+    generate_native();
+
+    printf("1048576 Hz to %u Hz, %u emulated seconds per run, fastest of %u runs\n", rate, seconds, runs);
+    printf("%-8s %-8s %6s %12s %12s %14s %10s\n",
+           "QUALITY", "KERNEL", "TAPS", "NS/OUTPUT", "MSAMPLES/S", "REAL TIME/CORE", "MAX DIFF");
+    for (uint8_t quality = 0; quality < RESAMPLE_NUM_QUALITIES; quality++) {
+        for (uint8_t kernel = KERNEL_SCALAR; kernel < RESAMPLE_NUM_KERNELS; kernel++) {
+            if (!resampler_kernel_supported(kernel)) {
+                continue;
+            }
+            BENCH_RESULT result;
+            bench(quality, kernel, rate, seconds, runs, &result);
+            //native input samples consumed per second on one core, and how many emulated seconds that is
+            double input_per_s = (double) seconds * APU_NATIVE_RATE / (result.BEST_NS / 1e9);
+            printf("%-8s %-8s %6u %12.1f %12.1f %13.1fx %10.2e\n",
+                   resampler_quality_name(quality), resampler_kernel_name(kernel), result.TAPS,
+                   (double) result.BEST_NS / result.OUTPUT_FRAMES, input_per_s / 1e6,
+                   input_per_s / APU_NATIVE_RATE, result.MAX_DIFFERENCE);
+        }
+    }
+    free(native);
+    free(reference);
+    free(resampled);
+    return 0;
+}
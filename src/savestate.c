@@ -0,0 +1,88 @@
+#include <common.h>
+#include <serial.h>
+#include <savestate.h>
+
+#define HASH_PRIME 0x100000001B3ULL
+
+/*
+ * Sizes STATE for the cartridge of the current instance
+ */
+void savestate_init(SAVESTATE* state) {
+    state->RAM = nullptr;
+    if (CARTRIDGE->RAM_SIZE) {
+        state->RAM = malloc(CARTRIDGE->RAM_SIZE);
+        if (!state->RAM) {
+            perror("Couldn't allocate save state");
+            exit(1);
+        }
+    }
+}
+
+void savestate_free(SAVESTATE* state) {
+    free(state->RAM);
+    state->RAM = nullptr;
+}
+
+/*
+ * Copies the current instance into STATE, only between frames or slices
+ */
+void savestate_save(SAVESTATE* state) {
+    gb_save_instance(&state->INSTANCE);
+    state->CPU = *CPU;
+    state->INSTR_QUEUE = *INSTR_QUEUE;
+    state->PPU = *PPU;
+    state->OBJ_HEAP = *OBJ_HEAP;
+    memcpy(state->MEMORY, MEMORY, sizeof(state->MEMORY));
+    state->CARTRIDGE = *CARTRIDGE;
+    if (CARTRIDGE->RAM_SIZE) {
+        memcpy(state->RAM, CARTRIDGE->RAM, CARTRIDGE->RAM_SIZE);
+    }
+    memcpy(state->APU, APU, sizeof(state->APU));
+    state->SERIAL_TRANSFER_END = SERIAL->TRANSFER_END;
+    state->SERIAL_TRANSFERS = SERIAL->TRANSFERS;
+}
+
+/*
+ * Restores STATE into the instance it was saved from
+ */
+void savestate_load(const SAVESTATE* state) {
+    gb_load_instance(&state->INSTANCE);
+    *CPU = state->CPU;
+    *INSTR_QUEUE = state->INSTR_QUEUE;
+    *PPU = state->PPU;
+    *OBJ_HEAP = state->OBJ_HEAP;
+    memcpy(MEMORY, state->MEMORY, sizeof(state->MEMORY));
+    uint8_t* rom = CARTRIDGE->ROM;
+    uint8_t* ram = CARTRIDGE->RAM;
+    *CARTRIDGE = state->CARTRIDGE;
+    CARTRIDGE->ROM = rom;
+    CARTRIDGE->RAM = ram;
+    cartridge_remap();
+    if (CARTRIDGE->RAM_SIZE) {
+        memcpy(CARTRIDGE->RAM, state->RAM, CARTRIDGE->RAM_SIZE);
+    }
+    memcpy(APU, state->APU, sizeof(state->APU));
+    SERIAL->TRANSFER_END = state->SERIAL_TRANSFER_END;
+    SERIAL->TRANSFERS = state->SERIAL_TRANSFERS;
+}
+
+/*
+ * FNV-1a style fingerprint of the memory, registers, cycle count and
+ * cartridge RAM of STATE, continuing from HASH. Two processes that ran the
+ * same inputs get the same value.
+ */
+uint64_t savestate_hash(const SAVESTATE* state, uint64_t hash) {
+    for (size_t i = 0; i < sizeof(state->MEMORY); i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, &state->MEMORY[i], sizeof(word));
+        hash = (hash ^ word) * HASH_PRIME;
+    }
+    for (uint8_t i = 0; i < sizeof(state->CPU.REGS); i++) {
+        hash = (hash ^ state->CPU.REGS[i]) * HASH_PRIME;
+    }
+    hash = (hash ^ state->INSTANCE.CYCLE_COUNT) * HASH_PRIME;
+    for (uint32_t i = 0; i < state->CARTRIDGE.RAM_SIZE; i++) {
+        hash = (hash ^ state->RAM[i]) * HASH_PRIME;
+    }
+    return hash;
+}
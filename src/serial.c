@@ -0,0 +1,105 @@
+#include <common.h>
+#include <memory.h>
+#include <serial.h>
+#include <gb.h>
+
+#define SERIAL_START_CAPACITY 256
+#define SERIAL_INTERRUPT 0x08
+
+static const uint8_t MOONEYE_PASSED[] = {3, 5, 8, 13, 21, 34};
+static const uint8_t MOONEYE_FAILED[] = {0x42, 0x42, 0x42, 0x42, 0x42, 0x42};
+
+void serial_init(bool capture) {
+    SERIAL->CAPTURE = capture;
+    SERIAL->RESULT = SERIAL_RUNNING;
+    SERIAL->CAPACITY = SERIAL_START_CAPACITY;
+    SERIAL->OUTPUT = calloc(SERIAL->CAPACITY, sizeof(char));
+    SERIAL->SIZE = 0;
+    SERIAL->TRANSFER_END = SERIAL_NO_TRANSFER;
+}
+
+void serial_free() {
+    free(SERIAL->OUTPUT);
+    SERIAL->OUTPUT = nullptr;
+}
+
+static bool output_ends_with(const void* pattern, uint32_t length) {
+    return SERIAL->SIZE >= length && !memcmp(SERIAL->OUTPUT + SERIAL->SIZE - length, pattern, length);
+}
+
+/*
+ * Keeps BYTE and checks whether the output now ends in a test result
+ */
+static void append_byte(uint8_t byte) {
+    //one byte is kept free for the terminator
+    if (SERIAL->SIZE + 1 == SERIAL->CAPACITY) {
+        SERIAL->CAPACITY *= 2;
+        SERIAL->OUTPUT = realloc(SERIAL->OUTPUT, SERIAL->CAPACITY);
+    }
+    SERIAL->OUTPUT[SERIAL->SIZE++] = (char) byte;
+    SERIAL->OUTPUT[SERIAL->SIZE] = '\0';
+
+    if (SERIAL->RESULT != SERIAL_RUNNING) {
+        return;
+    }
+    if (output_ends_with("Passed", 6) || output_ends_with(MOONEYE_PASSED, sizeof(MOONEYE_PASSED))) {
+        SERIAL->RESULT = SERIAL_PASSED;
+    }
+    else if (output_ends_with("Failed", 6) || output_ends_with(MOONEYE_FAILED, sizeof(MOONEYE_FAILED))) {
+        SERIAL->RESULT = SERIAL_FAILED;
+    }
+    if (SERIAL->RESULT != SERIAL_RUNNING && SERIAL->STOP_ON_RESULT) {
+        gb_end_slice();
+    }
+}
+
+/*
+ * Called when SC is written. A transfer on the internal clock ends
+ * SERIAL_TRANSFER_CYCLES later, its byte is kept or printed right away so
+ * test ROMs report as they go. Linked instances end their slice on every
+ * write so the link sees the port change at the cycle it happened.
+ */
+void serial_write_control() {
+    SERIAL->TRANSFER_END = SERIAL_NO_TRANSFER;
+    if ((MEMORY[SC] & SERIAL_TRANSFER_START) && (MEMORY[SC] & SERIAL_INTERNAL_CLOCK)) {
+        SERIAL->TRANSFER_END = CYCLE_COUNT + SERIAL_TRANSFER_CYCLES;
+        uint8_t byte = MEMORY[SB];
+        if (SERIAL->CAPTURE) {
+            append_byte(byte);
+        }
+        else {
+            printf("%c", (char) byte);
+        }
+    }
+    if (SERIAL->LINKED) {
+        gb_end_slice();
+    }
+    else {
+        gb_reschedule();
+    }
+}
+
+/*
+ * Completes the transfer in progress with INCOMING as the byte shifted in
+ */
+void serial_finish_transfer(uint8_t incoming) {
+    MEMORY[SB] = incoming;
+    MEMORY[SC] = CLEAR_BIT(SERIAL_TRANSFER_START, MEMORY[SC]);
+    MEMORY[IF] |= SERIAL_INTERRUPT;
+    SERIAL->TRANSFER_END = SERIAL_NO_TRANSFER;
+    SERIAL->TRANSFERS++;
+}
+
+/*
+ * Writes the captured output to PATH
+ */
+bool serial_save(const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        perror("Couldn't open serial output file");
+        return false;
+    }
+    bool ok = fwrite(SERIAL->OUTPUT, 1, SERIAL->SIZE, file) == SERIAL->SIZE;
+    fclose(file);
+    return ok;
+}
@@ -0,0 +1,156 @@
+#include <common.h>
+#include <jobs.h>
+#include <serial.h>
+
+#define DEFAULT_MAX_CYCLES (1048576ULL * 120) //two minutes of emulated time
+#define NAME_WIDTH 40
+#define LAST_LINE_WIDTH 48
+
+/*
+ * Serial test ROM conformance harness. Every ROM in a directory is run headless
+ * in parallel until it reports "Passed" or "Failed" over the serial port or the
+ * cycle limit is reached, then the results are printed as a table.
+ */
+
+enum TEST_RESULT {
+    TEST_PASSED,
+    TEST_FAILED,
+    TEST_TIMEOUT,
+    TEST_CRASHED
+};
+
+static const char* RESULT_NAMES[] = {"PASS", "FAIL", "TIMEOUT", "CRASH"};
+
+static void print_usage(const char* program) {
+    fprintf(stderr, "Usage: %s <rom directory> [options]\n", program);
+    fprintf(stderr, "  --max-cycles <N>      M-cycles before a ROM times out (default %llu)\n", DEFAULT_MAX_CYCLES);
+    fprintf(stderr, "  -j <N>                processes to run at once (default one per core)\n");
+    fprintf(stderr, "  --emulator <path>     gb_emu executable to test\n");
+}
+
+/*
+ * Copies the last non-empty line of the serial OUTPUT into LINE
+ */
+static void last_line(const char* output, char* line, size_t size) {
+    const char* end = output + strlen(output);
+    while (end > output && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ')) {
+        end--;
+    }
+    const char* start = end;
+    while (start > output && start[-1] != '\n') {
+        start--;
+    }
+    size_t length = end - start < (long) size - 1 ? (size_t) (end - start) : size - 1;
+    for (size_t i = 0; i < length; i++) {
+        //mooneye results are raw bytes
+        line[i] = (start[i] >= ' ' && start[i] <= '~') ? start[i] : '.';
+    }
+    line[length] = '\0';
+}
+
+int main(int argc, char* argv[]) {
+    const char* rom_dir = nullptr;
+    char* emulator = nullptr;
+    uint64_t max_cycles = DEFAULT_MAX_CYCLES;
+    uint32_t max_parallel = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--max-cycles") && i + 1 < argc) {
+            const char* value = argv[++i];
+            char* end;
+            max_cycles = strtoull(value, &end, 10);
+            //a typo must not turn into no limit at all
+            if (*value < '0' || *value > '9' || *end) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "-j") && i + 1 < argc) {
+            max_parallel = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--emulator") && i + 1 < argc) {
+            emulator = SDL_strdup(argv[++i]);
+        }
+        else if (argv[i][0] != '-' && !rom_dir) {
+            rom_dir = argv[i];
+        }
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!rom_dir || !max_cycles) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (!emulator) {
+        emulator = jobs_emulator_path();
+    }
+
+    int num_roms;
+    char** roms = SDL_GlobDirectory(rom_dir, "*.gb", SDL_GLOB_CASEINSENSITIVE, &num_roms);
+    if (!roms || !num_roms) {
+        fprintf(stderr, "No ROMs found in %s\n", rom_dir);
+        return 1;
+    }
+
+    JOB* jobs = calloc(num_roms, sizeof(JOB));
+    for (int i = 0; i < num_roms; i++) {
+        JOB* job = &jobs[i];
+        job_init(job, roms[i]);
+        job_add_arg(job, "%s", emulator);
+        job_add_arg(job, "%s/%s", rom_dir, roms[i]);
+        job_add_arg(job, "--headless");
+        job_add_arg(job, "--frameskip");
+        job_add_arg(job, "all");
+        job_add_arg(job, "--serial-out");
+        job_add_arg(job, "%s/%s.serial", rom_dir, roms[i]);
+        job_add_arg(job, "--serial-stop");
+        job_add_arg(job, "--max-cycles");
+        job_add_arg(job, "%llu", (unsigned long long) max_cycles);
+    }
+
+    uint64_t start = SDL_GetTicksNS();
+    jobs_run(jobs, num_roms, max_parallel);
+    double total_ms = (double) (SDL_GetTicksNS() - start) / 1e6;
+
+    uint32_t passed = 0;
+    printf("%-*s %-8s %10s  %s\n", NAME_WIDTH, "ROM", "RESULT", "TIME (ms)", "OUTPUT");
+    for (int i = 0; i < num_roms; i++) {
+        JOB* job = &jobs[i];
+        enum TEST_RESULT result;
+        switch (job->EXIT_CODE) {
+            case SERIAL_EXIT_PASSED:
+                result = TEST_PASSED;
+                passed++;
+                break;
+            case SERIAL_EXIT_FAILED:
+                result = TEST_FAILED;
+                break;
+            case SERIAL_EXIT_TIMEOUT:
+                result = TEST_TIMEOUT;
+                break;
+            default:
+                //exit(1) on an emulator error, a signal or a failed launch
+                result = TEST_CRASHED;
+        }
+
+        char* serial_path;
+        SDL_asprintf(&serial_path, "%s/%s.serial", rom_dir, job->NAME);
+        char* output = SDL_LoadFile(serial_path, nullptr);
+        char line[LAST_LINE_WIDTH] = "";
+        if (output) {
+            last_line(output, line, sizeof(line));
+        }
+        printf("%-*s %-8s %10.1f  %s\n", NAME_WIDTH, job->NAME, RESULT_NAMES[result], job->WALL_MS, line);
+
+        SDL_free(output);
+        SDL_free(serial_path);
+        job_free(job);
+    }
+    printf("%u/%d passed, %.1f ms\n", passed, num_roms, total_ms);
+
+    free(jobs);
+    SDL_free(roms);
+    SDL_free(emulator);
+    return passed == (uint32_t) num_roms ? 0 : 1;
+}
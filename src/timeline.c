@@ -0,0 +1,170 @@
+#include <common.h>
+#include <SDL3/SDL.h>
+#include <gb.h>
+#include <timeline.h>
+
+#define INITIAL_EVENTS 4096
+#define INTERRUPT_DISPATCH_DOTS 20  //5 M-cycles
+#define DMA_LAST_CYCLE 0xDF
+#define NO_PPU_STATE 0xFF
+#define EMULATED_PID 1
+#define HOST_PID 2
+
+static const char* PPU_STATE_NAMES[] = {"OAM search", "pixel transfer", "HBlank", "VBlank"};
+static const char* INTERRUPT_NAMES[] = {"VBlank interrupt", "STAT interrupt", "timer interrupt", "serial interrupt", "joypad interrupt"};
+static const char* TRACK_NAMES[TIMELINE_NUM_TRACKS] = {"PPU", "CPU", "interrupts", "OAM DMA", "frames", "emulation thread", "render thread"};
+
+void timeline_init() {
+    TIMELINE = (TIMELINE_STRUCT*) calloc(1, sizeof(TIMELINE_STRUCT));
+    TIMELINE->PPU_STATE = NO_PPU_STATE;
+    TIMELINE->START_NS = SDL_GetTicksNS();
+}
+
+void timeline_free() {
+    if (!TIMELINE) {
+        return;
+    }
+    for (uint8_t track = 0; track < TIMELINE_NUM_TRACKS; track++) {
+        free(TIMELINE->TRACKS[track].EVENTS);
+    }
+    free(TIMELINE);
+    TIMELINE = nullptr;
+}
+
+void timeline_span(enum TIMELINE_TRACK track, const char* name, uint64_t start, uint64_t end) {
+    TIMELINE_TRACK_STRUCT* events = &TIMELINE->TRACKS[track];
+    if (events->SIZE == events->CAPACITY) {
+        if (events->CAPACITY == TIMELINE_MAX_EVENTS) {
+            events->DROPPED++;
+            return;
+        }
+        events->CAPACITY = events->CAPACITY ? events->CAPACITY * 2 : INITIAL_EVENTS;
+        events->EVENTS = realloc(events->EVENTS, events->CAPACITY * sizeof(TIMELINE_EVENT));
+    }
+    events->EVENTS[events->SIZE].NAME = name;
+    events->EVENTS[events->SIZE].START = start;
+    events->EVENTS[events->SIZE].END = end;
+    events->SIZE++;
+}
+
+/*
+ * Opens a span on TRACK, a span still open on it is ended at TIME first
+ */
+void timeline_begin(enum TIMELINE_TRACK track, const char* name, uint64_t time) {
+    timeline_end(track, time);
+    TIMELINE->TRACKS[track].OPEN_NAME = name;
+    TIMELINE->TRACKS[track].OPEN_START = time;
+}
+
+void timeline_end(enum TIMELINE_TRACK track, uint64_t time) {
+    TIMELINE_TRACK_STRUCT* events = &TIMELINE->TRACKS[track];
+    if (events->OPEN_NAME) {
+        timeline_span(track, events->OPEN_NAME, events->OPEN_START, time);
+        events->OPEN_NAME = nullptr;
+    }
+}
+
+/*
+ * Called before every dot with the mode the PPU is in, also advances the emulated clock
+ */
+void timeline_ppu_dot(uint8_t state) {
+    if (state != TIMELINE->PPU_STATE) {
+        timeline_begin(TRACK_PPU, PPU_STATE_NAMES[state], TIMELINE->DOTS);
+        TIMELINE->PPU_STATE = state;
+    }
+    TIMELINE->DOTS++;
+}
+
+void timeline_cpu_cycle(bool halted) {
+    if (halted == TIMELINE->HALTED) {
+        return;
+    }
+    if (halted) {
+        timeline_begin(TRACK_CPU, "HALT", TIMELINE->DOTS);
+    }
+    else {
+        timeline_end(TRACK_CPU, TIMELINE->DOTS);
+    }
+    TIMELINE->HALTED = halted;
+}
+
+void timeline_interrupt(uint8_t vector) {
+    timeline_span(TRACK_INTERRUPTS, INTERRUPT_NAMES[(vector - 0x40) / 8], TIMELINE->DOTS, TIMELINE->DOTS + INTERRUPT_DISPATCH_DOTS);
+}
+
+/*
+ * Called on every OAM DMA cycle before the byte is copied
+ */
+void timeline_dma(uint8_t dma_cycle) {
+    if (dma_cycle == 0) {
+        timeline_begin(TRACK_DMA, "OAM DMA", TIMELINE->DOTS);
+    }
+    else if (dma_cycle == DMA_LAST_CYCLE) {
+        timeline_end(TRACK_DMA, TIMELINE->DOTS + 4);
+    }
+}
+
+void timeline_frame() {
+    timeline_begin(TRACK_FRAMES, "frame", TIMELINE->DOTS);
+    TIMELINE->FRAMES++;
+}
+
+void timeline_host_begin(enum TIMELINE_TRACK track, const char* name) {
+    timeline_begin(track, name, SDL_GetTicksNS() - TIMELINE->START_NS);
+}
+
+void timeline_host_end(enum TIMELINE_TRACK track) {
+    timeline_end(track, SDL_GetTicksNS() - TIMELINE->START_NS);
+}
+
+static bool is_host_track(uint8_t track) {
+    return track >= TRACK_EMULATION_THREAD;
+}
+
+//timestamps in microseconds, the unit of the Chrome trace format
+static double to_us(uint8_t track, uint64_t time) {
+    return is_host_track(track) ? time / 1000.0 : time * 1e6 / CLOCK_FREQ;
+}
+
+static void write_metadata(FILE* file, const char* kind, uint8_t pid, int tid, const char* name) {
+    fprintf(file, "{\"name\":\"%s\",\"ph\":\"M\",\"pid\":%u,\"tid\":%d,\"args\":{\"name\":\"%s\"}},\n", kind, pid, tid, name);
+}
+
+/*
+ * Writes every track as Chrome trace JSON, which chrome://tracing and Perfetto open.
+ * Emulated tracks start at 0 in Game Boy time and host tracks at 0 in host time,
+ * at full speed both run at the same rate so frames line up side by side.
+ */
+bool timeline_write(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        perror("Couldn't open timeline file");
+        return false;
+    }
+    uint64_t end_dots = TIMELINE->DOTS;
+    uint64_t end_ns = SDL_GetTicksNS() - TIMELINE->START_NS;
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    write_metadata(file, "process_name", EMULATED_PID, 0, "Game Boy (emulated time)");
+    write_metadata(file, "process_name", HOST_PID, 0, "host");
+    uint64_t dropped = 0;
+    for (uint8_t track = 0; track < TIMELINE_NUM_TRACKS; track++) {
+        uint8_t pid = is_host_track(track) ? HOST_PID : EMULATED_PID;
+        write_metadata(file, "thread_name", pid, track, TRACK_NAMES[track]);
+        timeline_end(track, is_host_track(track) ? end_ns : end_dots);
+        const TIMELINE_TRACK_STRUCT* events = &TIMELINE->TRACKS[track];
+        for (uint32_t i = 0; i < events->SIZE; i++) {
+            const TIMELINE_EVENT* event = &events->EVENTS[i];
+            fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f},\n", event->NAME, pid, track,
+                    to_us(track, event->START), to_us(track, event->END - event->START));
+        }
+        dropped += events->DROPPED;
+    }
+    //the format allows no trailing comma, close with one more metadata event
+    fprintf(file, "{\"name\":\"timeline\",\"ph\":\"M\",\"pid\":%u,\"args\":{\"frames\":%llu,\"dropped_events\":%llu}}\n]}\n",
+            EMULATED_PID, (unsigned long long) TIMELINE->FRAMES, (unsigned long long) dropped);
+    fclose(file);
+    if (dropped) {
+        fprintf(stderr, "Timeline dropped %llu events, tracks are capped at %d events\n", (unsigned long long) dropped, TIMELINE_MAX_EVENTS);
+    }
+    return true;
+}
@@ -0,0 +1,286 @@
+#include <common.h>
+#include <SDL3/SDL.h>
+#include <cpu.h>
+#include <memory.h>
+#include <gb.h>
+#include <trace.h>
+
+#define MAGIC_SIZE (sizeof(TRACE_MAGIC) - 1)
+#define MAX_ENCODED_SIZE 32
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+/*
+ * Encoded record layout, all integers are LEB128 varints:
+ *   changed field mask, opcode byte, zigzag PC delta, cycle delta,
+ *   then every changed field in mask order, SP as two bytes little endian.
+ * The mask puts the registers that change most often in its first 7 bits.
+ */
+enum TRACE_FIELD {
+    FIELD_A,
+    FIELD_F,
+    FIELD_B,
+    FIELD_C,
+    FIELD_H,
+    FIELD_L,
+    FIELD_LY,
+    FIELD_D,
+    FIELD_E,
+    FIELD_SP,
+    FIELD_IME,
+    NUM_FIELDS
+};
+
+//index into TRACE_RECORD.REGS of each 8-bit register field, -1 for the rest
+static const int8_t FIELD_REGS[NUM_FIELDS] = {A, F, B, C, H, L, -1, D, E, -1, -1};
+
+static int writer_thread(void* UNUSED);
+
+void trace_init(const char* path) {
+    TRACE = (TRACE_STRUCT*) calloc(1, sizeof(TRACE_STRUCT));
+    TRACE->OUTPUT = fopen(path, "wb");
+    if (!TRACE->OUTPUT) {
+        perror("Couldn't open trace file");
+        exit(1);
+    }
+    setvbuf(TRACE->OUTPUT, nullptr, _IOFBF, OUTPUT_BUFFER_SIZE);
+    fwrite(TRACE_MAGIC, 1, MAGIC_SIZE, TRACE->OUTPUT);
+    TRACE->BYTES_WRITTEN = MAGIC_SIZE;
+
+    TRACE->FREE_BLOCKS = SDL_CreateSemaphore(TRACE_NUM_BLOCKS);
+    TRACE->FULL_BLOCKS = SDL_CreateSemaphore(0);
+    TRACE->WRITER = SDL_CreateThread(writer_thread, "trace", nullptr);
+    if (!TRACE->FREE_BLOCKS || !TRACE->FULL_BLOCKS || !TRACE->WRITER) {
+        fprintf(stderr, "Error starting trace: %s\n", SDL_GetError());
+        exit(1);
+    }
+}
+
+/*
+ * Hands the last partly filled block to the writer, waits for everything to be
+ * written and closes the output. Must be called after the emulation thread has finished.
+ */
+void trace_finish() {
+    if (!TRACE->WRITER) {
+        return;
+    }
+    if (TRACE->HEAD % TRACE_BLOCK_SIZE) {
+        SDL_SignalSemaphore(TRACE->FULL_BLOCKS);
+    }
+    //one extra signal with nothing queued tells the writer to stop
+    SDL_SignalSemaphore(TRACE->FULL_BLOCKS);
+    SDL_WaitThread(TRACE->WRITER, nullptr);
+    TRACE->WRITER = nullptr;
+    fclose(TRACE->OUTPUT);
+}
+
+void trace_free() {
+    if (!TRACE) {
+        return;
+    }
+    trace_finish();
+    SDL_DestroySemaphore(TRACE->FREE_BLOCKS);
+    SDL_DestroySemaphore(TRACE->FULL_BLOCKS);
+    free(TRACE);
+    TRACE = nullptr;
+}
+
+/*
+ * Emulation thread side, called on every opcode fetch. Never drops a record,
+ * waits for the writer when the whole ring is full.
+ */
+void trace_push() {
+    uint32_t slot = TRACE->HEAD % TRACE_RING_SIZE;
+    if (slot % TRACE_BLOCK_SIZE == 0 && !SDL_TryWaitSemaphore(TRACE->FREE_BLOCKS)) {
+        uint64_t block_start = SDL_GetTicksNS();
+        SDL_WaitSemaphore(TRACE->FREE_BLOCKS);
+        TRACE->BLOCKS++;
+        TRACE->BLOCKED_NS += SDL_GetTicksNS() - block_start;
+    }
+    TRACE_RECORD* record = &TRACE->RING[slot];
+    record->CYCLE = CYCLE_COUNT;
+    //the opcode has just been fetched, ADDRESS_BUS still holds its address
+    record->PC = CPU->ADDRESS_BUS;
+    record->SP = read_16bit_reg(SP);
+    memcpy(record->REGS, CPU->REGS, sizeof(record->REGS));
+    record->OPCODE = CPU->DATA_BUS;
+    record->IME = CPU->IME;
+    record->SCANLINE = MEMORY[LY];
+    TRACE->HEAD++;
+    if (TRACE->HEAD % TRACE_BLOCK_SIZE == 0) {
+        SDL_SignalSemaphore(TRACE->FULL_BLOCKS);
+    }
+}
+
+static uint8_t write_varint(uint8_t* out, uint64_t value) {
+    uint8_t size = 0;
+    while (value >= 0x80) {
+        out[size++] = (uint8_t) value | 0x80;
+        value >>= 7;
+    }
+    out[size++] = (uint8_t) value;
+    return size;
+}
+
+static uint8_t field_value(const TRACE_RECORD* record, uint8_t field) {
+    if (FIELD_REGS[field] >= 0) {
+        return record->REGS[FIELD_REGS[field]];
+    }
+    return field == FIELD_LY ? record->SCANLINE : record->IME;
+}
+
+/*
+ * Encodes RECORD as its changes from PREVIOUS into OUT and returns the size
+ */
+static uint8_t encode_record(uint8_t* out, const TRACE_RECORD* record, const TRACE_RECORD* previous) {
+    uint32_t mask = 0;
+    for (uint8_t field = 0; field < NUM_FIELDS; field++) {
+        bool changed = field == FIELD_SP ? record->SP != previous->SP : field_value(record, field) != field_value(previous, field);
+        if (changed) {
+            mask |= 1 << field;
+        }
+    }
+    int32_t pc_delta = (int32_t) record->PC - (int32_t) previous->PC;
+    uint8_t size = write_varint(out, mask);
+    out[size++] = record->OPCODE;
+    size += write_varint(out + size, ((uint32_t) pc_delta << 1) ^ (uint32_t) (pc_delta >> 31));
+    size += write_varint(out + size, record->CYCLE - previous->CYCLE);
+    for (uint8_t field = 0; field < NUM_FIELDS; field++) {
+        if (!(mask & (1 << field))) {
+            continue;
+        }
+        if (field == FIELD_SP) {
+            out[size++] = (uint8_t) record->SP;
+            out[size++] = (uint8_t) (record->SP >> 8);
+        }
+        else {
+            out[size++] = field_value(record, field);
+        }
+    }
+    return size;
+}
+
+/*
+ * Encodes every record the emulation thread has handed over, one block per signal
+ */
+static int writer_thread(void* UNUSED) {
+    (void)UNUSED;
+    uint8_t encoded[MAX_ENCODED_SIZE];
+    while (true) {
+        SDL_WaitSemaphore(TRACE->FULL_BLOCKS);
+        uint64_t head = TRACE->HEAD;
+        if (TRACE->TAIL == head) {
+            return 0;
+        }
+        uint64_t block_end = (TRACE->TAIL / TRACE_BLOCK_SIZE + 1) * TRACE_BLOCK_SIZE;
+        uint64_t end = head < block_end ? head : block_end;
+        for (; TRACE->TAIL < end; TRACE->TAIL++) {
+            const TRACE_RECORD* record = &TRACE->RING[TRACE->TAIL % TRACE_RING_SIZE];
+            uint8_t size = encode_record(encoded, record, &TRACE->PREVIOUS);
+            fwrite(encoded, 1, size, TRACE->OUTPUT);
+            TRACE->BYTES_WRITTEN += size;
+            TRACE->PREVIOUS = *record;
+        }
+        if (TRACE->TAIL == block_end) {
+            SDL_SignalSemaphore(TRACE->FREE_BLOCKS);
+        }
+    }
+}
+
+void trace_print_stats() {
+    uint64_t records = TRACE->HEAD ? TRACE->HEAD : 1;
+    printf("Trace: %llu instructions, %llu bytes (%.2f bytes/instruction), waited on the writer %llu times for %.2f ms\n",
+           (unsigned long long) TRACE->HEAD, (unsigned long long) TRACE->BYTES_WRITTEN,
+           (double) TRACE->BYTES_WRITTEN / records, (unsigned long long) TRACE->BLOCKS, TRACE->BLOCKED_NS / 1e6);
+}
+
+bool trace_reader_open(TRACE_READER* reader, const char* path) {
+    memset(reader, 0, sizeof(TRACE_READER));
+    reader->INPUT = fopen(path, "rb");
+    if (!reader->INPUT) {
+        return false;
+    }
+    char magic[MAGIC_SIZE];
+    if (fread(magic, 1, MAGIC_SIZE, reader->INPUT) != MAGIC_SIZE || memcmp(magic, TRACE_MAGIC, MAGIC_SIZE) != 0) {
+        fclose(reader->INPUT);
+        reader->INPUT = nullptr;
+        return false;
+    }
+    return true;
+}
+
+static bool read_varint(FILE* input, uint64_t* value) {
+    *value = 0;
+    for (uint8_t shift = 0; shift < 64; shift += 7) {
+        int byte = fgetc(input);
+        if (byte == EOF) {
+            return false;
+        }
+        *value |= (uint64_t) (byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Decodes the next record on top of the previous one, returns false at the end
+ * of the trace or on a truncated record
+ */
+bool trace_read_next(TRACE_READER* reader) {
+    uint64_t mask;
+    uint64_t pc_delta;
+    uint64_t cycle_delta;
+    if (!read_varint(reader->INPUT, &mask)) {
+        return false;
+    }
+    int opcode = fgetc(reader->INPUT);
+    if (opcode == EOF || !read_varint(reader->INPUT, &pc_delta) || !read_varint(reader->INPUT, &cycle_delta)) {
+        return false;
+    }
+    TRACE_RECORD* record = &reader->RECORD;
+    record->OPCODE = (uint8_t) opcode;
+    record->PC += (uint16_t) ((pc_delta >> 1) ^ -(pc_delta & 1));
+    record->CYCLE += cycle_delta;
+    for (uint8_t field = 0; field < NUM_FIELDS; field++) {
+        if (!(mask & (1 << field))) {
+            continue;
+        }
+        int low = fgetc(reader->INPUT);
+        if (low == EOF) {
+            return false;
+        }
+        if (field == FIELD_SP) {
+            int high = fgetc(reader->INPUT);
+            if (high == EOF) {
+                return false;
+            }
+            record->SP = (uint16_t) (low | (high << 8));
+        }
+        else if (FIELD_REGS[field] >= 0) {
+            record->REGS[FIELD_REGS[field]] = (uint8_t) low;
+        }
+        else if (field == FIELD_LY) {
+            record->SCANLINE = (uint8_t) low;
+        }
+        else {
+            record->IME = (uint8_t) low;
+        }
+    }
+    reader->INDEX++;
+    return true;
+}
+
+void trace_reader_close(TRACE_READER* reader) {
+    if (reader->INPUT) {
+        fclose(reader->INPUT);
+        reader->INPUT = nullptr;
+    }
+}
+
+void trace_format_record(const TRACE_RECORD* record, char* text, size_t size) {
+    snprintf(text, size, "%12llu PC:%04X OP:%02X A:%02X F:%02X B:%02X C:%02X D:%02X E:%02X H:%02X L:%02X SP:%04X IME:%u LY:%3u",
+             (unsigned long long) record->CYCLE, record->PC, record->OPCODE, record->REGS[A], record->REGS[F],
+             record->REGS[B], record->REGS[C], record->REGS[D], record->REGS[E], record->REGS[H], record->REGS[L],
+             record->SP, record->IME, record->SCANLINE);
+}
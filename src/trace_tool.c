@@ -0,0 +1,170 @@
+#include <common.h>
+#include <SDL3/SDL.h>
+#include <cpu.h>
+#include <trace.h>
+
+#define DEFAULT_CONTEXT 8
+#define MAX_CONTEXT 256
+#define LINE_SIZE 160
+
+/*
+ * Reads traces written by gb_emu --trace. dump prints records as text, diff runs
+ * two traces side by side and stops at the first instruction where they disagree.
+ */
+
+static void print_usage(const char* program) {
+    fprintf(stderr, "Usage: %s dump <trace> [--from N] [--count N]\n", program);
+    fprintf(stderr, "       %s diff <trace a> <trace b> [--context N]\n", program);
+    fprintf(stderr, "  --from <N>      skip the first N instructions\n");
+    fprintf(stderr, "  --count <N>     only print N instructions\n");
+    fprintf(stderr, "  --context <N>   instructions shown before the first difference (default %d)\n", DEFAULT_CONTEXT);
+}
+
+static void open_or_exit(TRACE_READER* reader, const char* path) {
+    if (!trace_reader_open(reader, path)) {
+        fprintf(stderr, "Couldn't open %s as a trace\n", path);
+        exit(2);
+    }
+}
+
+static int dump(const char* path, uint64_t from, uint64_t count) {
+    TRACE_READER reader;
+    open_or_exit(&reader, path);
+    char line[LINE_SIZE];
+    uint64_t printed = 0;
+    while ((!count || printed < count) && trace_read_next(&reader)) {
+        if (reader.INDEX <= from) {
+            continue;
+        }
+        trace_format_record(&reader.RECORD, line, sizeof(line));
+        printf("%10llu %s\n", (unsigned long long) reader.INDEX - 1, line);
+        printed++;
+    }
+    trace_reader_close(&reader);
+    return 0;
+}
+
+static void append_field(char* text, size_t size, const char* name) {
+    size_t used = strlen(text);
+    snprintf(text + used, size - used, "%s%s", used ? " " : "", name);
+}
+
+/*
+ * Lists the names of every field that differs between A and B into TEXT,
+ * TEXT is left empty when the records match
+ */
+static void describe_difference(const TRACE_RECORD* a, const TRACE_RECORD* b, char* text, size_t size) {
+    static const char* REG_NAMES[8] = {"A", "F", "B", "C", "D", "E", "H", "L"};
+    text[0] = '\0';
+    if (a->CYCLE != b->CYCLE) {
+        append_field(text, size, "cycle");
+    }
+    if (a->PC != b->PC) {
+        append_field(text, size, "PC");
+    }
+    if (a->OPCODE != b->OPCODE) {
+        append_field(text, size, "opcode");
+    }
+    for (uint8_t reg = 0; reg < 8; reg++) {
+        if (a->REGS[reg] != b->REGS[reg]) {
+            append_field(text, size, REG_NAMES[reg]);
+        }
+    }
+    if (a->SP != b->SP) {
+        append_field(text, size, "SP");
+    }
+    if (a->IME != b->IME) {
+        append_field(text, size, "IME");
+    }
+    if (a->SCANLINE != b->SCANLINE) {
+        append_field(text, size, "LY");
+    }
+}
+
+static int diff(const char* path_a, const char* path_b, uint32_t context) {
+    TRACE_READER a;
+    TRACE_READER b;
+    open_or_exit(&a, path_a);
+    open_or_exit(&b, path_b);
+    //last CONTEXT matching records, both traces agree on them
+    TRACE_RECORD* history = calloc(context ? context : 1, sizeof(TRACE_RECORD));
+    int result = 0;
+    char line[LINE_SIZE];
+    char fields[LINE_SIZE];
+    while (true) {
+        bool more_a = trace_read_next(&a);
+        bool more_b = trace_read_next(&b);
+        if (!more_a && !more_b) {
+            printf("Traces match for all %llu instructions\n", (unsigned long long) a.INDEX);
+            break;
+        }
+        describe_difference(&a.RECORD, &b.RECORD, fields, sizeof(fields));
+        if (more_a == more_b && !fields[0]) {
+            if (context) {
+                history[(a.INDEX - 1) % context] = a.RECORD;
+            }
+            continue;
+        }
+        uint64_t index = (more_a ? a.INDEX : b.INDEX) - 1;
+        uint64_t first = index > context ? index - context : 0;
+        for (uint64_t i = first; i < index; i++) {
+            trace_format_record(&history[i % context], line, sizeof(line));
+            printf("  %10llu %s\n", (unsigned long long) i, line);
+        }
+        if (!more_a || !more_b) {
+            printf("%s ends after %llu instructions\n", more_a ? path_b : path_a, (unsigned long long) index);
+        }
+        else {
+            trace_format_record(&a.RECORD, line, sizeof(line));
+            printf("a %10llu %s\n", (unsigned long long) index, line);
+            trace_format_record(&b.RECORD, line, sizeof(line));
+            printf("b %10llu %s\n", (unsigned long long) index, line);
+            printf("First difference at instruction %llu: %s\n", (unsigned long long) index, fields);
+        }
+        result = 1;
+        break;
+    }
+    free(history);
+    trace_reader_close(&a);
+    trace_reader_close(&b);
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    bool is_diff = !strcmp(argv[1], "diff");
+    if (!is_diff && strcmp(argv[1], "dump")) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    int first_option = is_diff ? 4 : 3;
+    if (argc < first_option) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    uint64_t from = 0;
+    uint64_t count = 0;
+    uint32_t context = DEFAULT_CONTEXT;
+    for (int i = first_option; i < argc; i++) {
+        if (!strcmp(argv[i], "--from") && i + 1 < argc && !is_diff) {
+            from = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--count") && i + 1 < argc && !is_diff) {
+            count = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--context") && i + 1 < argc && is_diff) {
+            context = (uint32_t) strtoul(argv[++i], nullptr, 10);
+            if (context > MAX_CONTEXT) {
+                context = MAX_CONTEXT;
+            }
+        }
+        else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    return is_diff ? diff(argv[2], argv[3], context) : dump(argv[2], from, count);
+}
@@ -0,0 +1,97 @@
+#include <common.h>
+#include <SDL3/SDL.h>
+#include <framebuffer.h>
+#include <triple_buffer.h>
+#include <gb.h>
+
+#define FRESH_FRAME 0x04
+#define SLOT_INDEX_MASK 0x03
+#define FRAME_TIME_NS ((uint64_t) CYCLES_PER_FRAME * 1000000000ULL / (uint64_t) CLOCK_FREQ)
+
+static SDL_Semaphore* frame_ready;
+
+void triple_buffer_init() {
+    FRAME_HANDOFF = (TRIPLE_BUFFER_STRUCT*) calloc(1, sizeof(TRIPLE_BUFFER_STRUCT));
+    FRAME_HANDOFF->WRITE_INDEX = 0;
+    FRAME_HANDOFF->MIDDLE = 1;
+    FRAME_HANDOFF->READ_INDEX = 2;
+    frame_ready = SDL_CreateSemaphore(0);
+}
+
+void triple_buffer_free() {
+    SDL_DestroySemaphore(frame_ready);
+    free(FRAME_HANDOFF);
+}
+
+/*
+ * Emulation thread side, copies FRAME into the write slot and swaps it into the middle
+ */
+void triple_buffer_publish(const INDEXED_FRAME* frame) {
+    FRAME_SLOT* slot = &FRAME_HANDOFF->SLOTS[FRAME_HANDOFF->WRITE_INDEX];
+    memcpy(&slot->FRAME, frame, sizeof(INDEXED_FRAME));
+    slot->PUBLISH_TIME_NS = SDL_GetTicksNS();
+
+    //the render thread only reads the middle slot, so its damage can be merged while it is shared
+    uint8_t middle = atomic_load_explicit(&FRAME_HANDOFF->MIDDLE, memory_order_acquire);
+    if (middle & FRESH_FRAME) {
+        frame_merge_damage(&slot->FRAME, &FRAME_HANDOFF->SLOTS[middle & SLOT_INDEX_MASK].FRAME);
+    }
+    middle = atomic_exchange_explicit(&FRAME_HANDOFF->MIDDLE, FRAME_HANDOFF->WRITE_INDEX | FRESH_FRAME, memory_order_acq_rel);
+    FRAME_HANDOFF->WRITE_INDEX = middle & SLOT_INDEX_MASK;
+    //a frame replacing an unread one needs no wakeup, the render thread was already told about that one
+    if (middle & FRESH_FRAME) {
+        FRAME_HANDOFF->FRAMES_DROPPED++;
+    }
+    else {
+        SDL_SignalSemaphore(frame_ready);
+    }
+    FRAME_HANDOFF->FRAMES_PUBLISHED++;
+}
+
+/*
+ * Render thread side, returns the newest unread frame or nullptr if none
+ * was published within TIMEOUT_MS
+ */
+const FRAME_SLOT* triple_buffer_acquire(int32_t timeout_ms) {
+    if (!(atomic_load_explicit(&FRAME_HANDOFF->MIDDLE, memory_order_acquire) & FRESH_FRAME)) {
+        SDL_WaitSemaphoreTimeout(frame_ready, timeout_ms);
+        if (!(atomic_load_explicit(&FRAME_HANDOFF->MIDDLE, memory_order_acquire) & FRESH_FRAME)) {
+            return nullptr;
+        }
+    }
+    uint8_t middle = atomic_exchange_explicit(&FRAME_HANDOFF->MIDDLE, FRAME_HANDOFF->READ_INDEX, memory_order_acq_rel);
+    FRAME_HANDOFF->READ_INDEX = middle & SLOT_INDEX_MASK;
+    //a frame taken without waiting leaves its wakeup behind, which would end the next wait early with nothing to show
+    SDL_TryWaitSemaphore(frame_ready);
+    return &FRAME_HANDOFF->SLOTS[FRAME_HANDOFF->READ_INDEX];
+}
+
+/*
+ * Render thread side, records latency and stalls once SLOT has been presented
+ */
+void triple_buffer_presented(const FRAME_SLOT* slot, uint64_t present_start_ns) {
+    uint64_t now = SDL_GetTicksNS();
+    uint64_t present_ns = now - present_start_ns;
+    uint64_t latency_ns = now - slot->PUBLISH_TIME_NS;
+    FRAME_HANDOFF->FRAMES_PRESENTED++;
+    FRAME_HANDOFF->LATENCY_TOTAL_NS += latency_ns;
+    if (latency_ns > FRAME_HANDOFF->LATENCY_MAX_NS) {
+        FRAME_HANDOFF->LATENCY_MAX_NS = latency_ns;
+    }
+    if (present_ns > FRAME_TIME_NS) {
+        FRAME_HANDOFF->PRESENT_STALLS++;
+        FRAME_HANDOFF->PRESENT_STALL_NS += present_ns - FRAME_TIME_NS;
+    }
+}
+
+void triple_buffer_print_stats() {
+    uint64_t presented = FRAME_HANDOFF->FRAMES_PRESENTED;
+    printf("Frames published: %llu, presented: %llu, dropped: %llu\n",
+           (unsigned long long) FRAME_HANDOFF->FRAMES_PUBLISHED, (unsigned long long) presented,
+           (unsigned long long) FRAME_HANDOFF->FRAMES_DROPPED);
+    printf("Frame latency avg: %.3f ms, max: %.3f ms\n",
+           presented ? (double) FRAME_HANDOFF->LATENCY_TOTAL_NS / presented / 1e6 : 0.0,
+           (double) FRAME_HANDOFF->LATENCY_MAX_NS / 1e6);
+    printf("Present stalls: %llu (%.3f ms over budget)\n",
+           (unsigned long long) FRAME_HANDOFF->PRESENT_STALLS, (double) FRAME_HANDOFF->PRESENT_STALL_NS / 1e6);
+}
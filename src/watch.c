@@ -0,0 +1,81 @@
+#include <common.h>
+#include <cpu.h>
+#include <gb.h>
+#include <watch.h>
+
+static void rebuild_pages() {
+    memset(WATCH_PAGES, 0, sizeof(WATCH_PAGES));
+    for (uint8_t id = 0; id < WATCH_MAX; id++) {
+        const WATCHPOINT* watch = &WATCHPOINTS[id];
+        if (!watch->ACTIVE) {
+            continue;
+        }
+        for (uint16_t page = watch->START >> 8; page <= watch->END >> 8; page++) {
+            WATCH_PAGES[page] |= watch->TYPES;
+        }
+    }
+}
+
+/*
+ * Calls CALLBACK on every TYPES access to START-END, returns the watchpoint id
+ * or -1 when all WATCH_MAX are in use
+ */
+int watch_add(uint16_t start, uint16_t end, uint8_t types, watch_callback callback, void* user_data) {
+    if (end < start) {
+        uint16_t swap = start;
+        start = end;
+        end = swap;
+    }
+    for (uint8_t id = 0; id < WATCH_MAX; id++) {
+        WATCHPOINT* watch = &WATCHPOINTS[id];
+        if (watch->ACTIVE) {
+            continue;
+        }
+        watch->START = start;
+        watch->END = end;
+        watch->TYPES = types;
+        watch->CALLBACK = callback;
+        watch->USER_DATA = user_data;
+        watch->HITS = 0;
+        watch->ACTIVE = true;
+        rebuild_pages();
+        return id;
+    }
+    return -1;
+}
+
+void watch_remove(int id) {
+    if (id < 0 || id >= WATCH_MAX) {
+        return;
+    }
+    WATCHPOINTS[id].ACTIVE = false;
+    rebuild_pages();
+}
+
+void watch_clear() {
+    memset(WATCHPOINTS, 0, sizeof(WATCHPOINTS));
+    memset(WATCH_PAGES, 0, sizeof(WATCH_PAGES));
+}
+
+/*
+ * Slow path, taken for every access of TYPE to a trapped page. Pages are coarse
+ * so the exact ranges are checked here.
+ */
+void watch_hit(enum WATCH_TYPE type, uint16_t address, uint8_t value) {
+    WATCH_HIT hit = {
+        .CYCLE = CYCLE_COUNT,
+        .PC = CPU->INSTRUCTION_PC,
+        .ADDRESS = address,
+        .VALUE = value,
+        .TYPE = type
+    };
+    for (uint8_t id = 0; id < WATCH_MAX; id++) {
+        WATCHPOINT* watch = &WATCHPOINTS[id];
+        if (watch->ACTIVE && (watch->TYPES & type) && address >= watch->START && address <= watch->END) {
+            watch->HITS++;
+            if (watch->CALLBACK) {
+                watch->CALLBACK(&hit, watch->USER_DATA);
+            }
+        }
+    }
+}